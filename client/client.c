@@ -101,11 +101,14 @@ void sql_prompt(int sock) {
             printf("  UPDATE name SET col = 'value'\n");
             printf("  DELETE FROM name\n");
             printf("  SELECT * FROM name\n");
+            printf("  SELECT * FROM name [LIMIT n] FOR UPDATE [NOWAIT | SKIP LOCKED]\n");
             printf("  CREATE INDEX idx_name ON table (column) USING BTREE\n");
             printf("  DROP INDEX idx_name\n");
             printf("  DESCRIBE table_name\n");
             printf("  SHOW TABLES\n");
-            printf("  COMMIT, ROLLBACK\n");
+            printf("  SHOW CONCURRENCY\n");
+            printf("  BEGIN, COMMIT, ROLLBACK\n");
+            printf("  SAVEPOINT name, ROLLBACK TO name, RELEASE name\n");
             printf("  shutdown - Shutdown server\n");
             printf("  quit - Exit client\n\n");
             continue;
@@ -9,11 +9,17 @@
  * ===============================
  * 
  * DATA ROW FORMAT:
- * +--------+--------+--------+--------+--------+--------+
- * | FLAGS  | FIELD1 | FIELD2 | ...    | FIELDN | PADDING|
- * +--------+--------+--------+--------+--------+--------+
- * |   1B   |   4B   |   8B   |  ...   |  VAR   |   VAR  |
- * +--------+--------+--------+--------+--------+--------+
+ * +--------+--------+--------+--------+--------+--------+--------+
+ * | FLAGS  | XMIN   | XMAX   | FIELD1 | ...    | FIELDN | PADDING|
+ * +--------+--------+--------+--------+--------+--------+--------+
+ * |   1B   |   4B   |   4B   |   4B   |  ...   |  VAR   |   VAR  |
+ * +--------+--------+--------+--------+--------+--------+--------+
+ * 
+ * XMIN/XMAX (MVCC): the transaction that created this row version and
+ * the one that deleted or replaced it (0 = still current). Readers see
+ * the versions their snapshot allows; DELETE only sets XMAX, and UPDATE
+ * sets XMAX and appends the new version. DELETE_FLAG marks a version no
+ * transaction can see (e.g. an insert rolled back by recovery).
  * 
  * INDEX ROW FORMAT (B-Tree):
  * +--------+--------+--------+--------+
@@ -69,6 +75,15 @@ typedef struct {
 // Get pointer to row data (after header)
 #define ROW_DATA_PTR(row_ptr) ((char*)(row_ptr) + sizeof(RowHeader))
 
+// MVCC version stamp following the flags of a data row (not index rows)
+typedef struct {
+    uint32_t xmin;          // Transaction that created this version
+    uint32_t xmax;          // Transaction that deleted or replaced it (0 = none)
+} __attribute__((packed)) RowVersion;
+
+#define ROW_VERSION_PTR(row_ptr) ((RowVersion*)((char*)(row_ptr) + sizeof(RowHeader)))
+#define DATA_ROW_HEADER_SIZE ((int)(sizeof(RowHeader) + sizeof(RowVersion)))
+
 // Get row header from row pointer
 #define ROW_HEADER_PTR(row_ptr) ((RowHeader*)(row_ptr))
 
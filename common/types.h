@@ -26,6 +26,7 @@
 #define MAX_QUERY_LEN 2048
 #define MAX_RESULT_ROWS 1000
 #define MAX_STRING_LEN 255
+#define MAX_INDEX_COLUMNS 4
 
 typedef enum {
     TYPE_INT,
@@ -46,10 +47,86 @@ typedef enum {
     TXN_ABORTED
 } TransactionState;
 
+// Lock modes, weakest first (see lock_manager.c for the compatibility matrix)
+typedef enum {
+    LOCK_IS,        // Intention shared
+    LOCK_IX,        // Intention exclusive
+    LOCK_S,         // Shared
+    LOCK_SIX,       // Shared + intention exclusive
+    LOCK_X,         // Exclusive
+    LOCK_MODE_COUNT
+} LockMode;
+
+// Lockable resource: a whole table (page_id = -1) or one row, by its TID
 typedef struct {
-    uint32_t txn_id;
+    int table_id;
+    int page_id;
+    int slot;
+} LockTag;
+
+#define LOCK_DEADLOCK (-2)  // Lock request withdrawn to break a deadlock; abort the transaction
+#define SERIALIZATION_FAILURE (-3)  // Row changed by a concurrent transaction (REPEATABLE READ, OCC)
+#define LOCK_TIMEOUT (-4)           // Lock wait exceeded the session's lock_timeout; fails the statement
+#define LOCK_NOT_AVAILABLE (-5)     // FOR UPDATE NOWAIT found a row locked; fails the statement
+
+// Row locking clause of SELECT ... FOR UPDATE
+typedef enum {
+    ROW_LOCK_NONE,
+    ROW_LOCK_WAIT,          // FOR UPDATE: wait for locked rows (up to lock_timeout)
+    ROW_LOCK_NOWAIT,        // FOR UPDATE NOWAIT: fail at the first locked row
+    ROW_LOCK_SKIP_LOCKED    // FOR UPDATE SKIP LOCKED: leave locked rows out
+} RowLockPolicy;
+
+// Concurrency control of a transaction (SET concurrency_control, see transaction_manager.c)
+typedef enum {
+    CC_LOCKING,     // Two-phase locking: writers lock rows and wait for each other
+    CC_OPTIMISTIC,  // OCC: no row locks; conflicts fail at once or at commit validation
+    CC_MODE_COUNT
+} ConcurrencyControl;
+
+// Per-mode counters for SHOW CONCURRENCY
+typedef struct {
+    uint64_t commits;               // Committed transactions that wrote something
+    uint64_t conflicts;             // Aborted by a deadlock or serialization failure
+    uint64_t validation_failures;   // OCC: conflicts found by validation at commit
+    uint64_t retries;               // OCC: auto-commit statements run again after a conflict
+} ConcurrencyStats;
+
+// OCC read set entry: a row version the transaction read
+typedef struct {
+    int page_id;
+    int slot;
+    int record_size;
+    uint32_t xmin;              // Identifies the version in its slot
+} OccRead;
+
+// MVCC snapshot: which transactions' changes a reader sees (see transaction_manager.c)
+typedef struct {
+    uint32_t xmin;              // Every transaction below this had finished
+    uint32_t xmax;              // First id not yet assigned; it and later ones are invisible
+    uint32_t* active;           // Running when the snapshot was taken, all in [xmin, xmax)
+    int active_count;
+} Snapshot;
+
+#define TXN_SLOTS_PER_CHUNK 64       // Transaction table growth step
+#define TXN_TABLE_CHUNKS 1024         // At most 65536 transactions at once
+
+typedef struct {
+    uint32_t txn_id;            // Transaction table slot: 0 while free (see transaction_manager.c)
+    int slot;                   // Index in the transaction table, fixed when its chunk is added
     TransactionState state;
     IsolationLevel isolation;
+    bool async_commit;          // synchronous_commit = off: commit does not wait for the WAL flush
+    bool has_snapshot;          // READ COMMITTED drops it at each statement
+    bool explicit_block;        // BEGIN ... COMMIT/ROLLBACK: statements do not auto-commit
+    int lock_timeout_ms;        // SET lock_timeout: longest wait for one lock (0 = no limit)
+    Snapshot snapshot;
+    int snapshot_count;         // Snapshots taken so far
+    ConcurrencyControl concurrency;
+    OccRead* read_set;          // OCC: versions read, validated at commit
+    int read_count;
+    int read_capacity;
+    int write_count;            // OCC: row versions created or stamped (the write set)
     pthread_mutex_t txn_mutex;
 } Transaction;
 
@@ -71,11 +148,20 @@ typedef struct {
     int index_id;
     char name[MAX_NAME_LEN];
     int table_id;
-    char column_name[MAX_NAME_LEN];
-    enum { INDEX_BTREE, INDEX_HASH } type;
+    char key_columns[MAX_INDEX_COLUMNS][MAX_NAME_LEN];     // Key columns, compared in order
+    int key_count;
+    char include_columns[MAX_INDEX_COLUMNS][MAX_NAME_LEN]; // Covering (non-key) columns
+    int include_count;
+    enum { INDEX_BTREE, INDEX_HASH, INDEX_ART } type;
     int root_page_id;
 } Index;
 
+// Physical row address: data page plus slot within the page
+typedef struct {
+    int page_id;
+    int slot;
+} RecordId;
+
 typedef struct {
     int page_id;
     char data[PAGE_SIZE];
@@ -83,6 +169,9 @@ typedef struct {
     bool in_use;
     int pin_count;
     pthread_mutex_t page_mutex;
+    uint64_t version;       // Optimistic latch for B+tree nodes (odd = write-locked)
+    uint64_t rec_lsn;       // First WAL record not yet on disk for this page (0 = clean)
+    bool unlogged;          // Dirty with changes the WAL cannot redo (catalog, indexes, links)
 } Page;
 
 typedef union {
@@ -92,6 +181,29 @@ typedef union {
     char string_val[MAX_STRING_LEN];
 } Value;
 
+// Index scan bound on a key prefix: the first `count` key columns are compared
+typedef struct {
+    const Value* values;
+    int count;          // 0 = unbounded
+    bool inclusive;
+} IndexBound;
+
+#define MAX_PREDICATES 8
+
+// WHERE predicate: column op literal (predicates are AND-ed together)
+typedef struct {
+    char column[MAX_NAME_LEN];
+    char op[3];
+    char value[MAX_STRING_LEN];
+} Predicate;
+
+// Predicate resolved against a table: column ordinal and typed literal
+typedef struct {
+    int column;
+    const char* op;
+    Value literal;
+} BoundPredicate;
+
 typedef struct {
     Column columns[MAX_COLUMNS];
     Value data[MAX_RESULT_ROWS][MAX_COLUMNS];
@@ -1,10 +1,29 @@
 #ifndef WAL_TYPES_H
 #define WAL_TYPES_H
 
+#include <stddef.h>
+#include <time.h>
 #include "types.h"
 
-#define WAL_RECORD_SIZE 512
-#define WAL_BUFFER_SIZE 4096
+#define WAL_BUFFER_SIZE (64 * 1024)   // Records staged before write(); flushed by commits
+#define WAL_MAX_IMAGE_SIZE PAGE_SIZE  // Largest before/after image in one record
+#define WAL_MAX_PAYLOAD (2 * WAL_MAX_IMAGE_SIZE)
+#define WAL_MAGIC "MDBWAL"
+#define WAL_FORMAT_VERSION 7
+#ifndef WAL_SEGMENT_SIZE
+#define WAL_SEGMENT_SIZE (16 * 1024 * 1024)   // Log bytes per segment file
+#endif
+#define WAL_RECYCLE_SEGMENTS 4      // Spare segments kept (renamed) for reuse
+#define WAL_CHECKPOINT_SEGMENTS 4   // Request a checkpoint after this many new segments
+#define WAL_CHECKPOINT_INTERVAL 300 // ... or after this many seconds with new WAL
+#ifndef WAL_ACTIVE_TXNS_INITIAL
+#define WAL_ACTIVE_TXNS_INITIAL 64  // Active transaction table slots at first; doubles when full
+#endif
+#define WAL_CONTROL_MAGIC "MDBCTL"
+#ifndef WAL_WRITER_DELAY_MS
+#define WAL_WRITER_DELAY_MS 200     // WAL writer flush interval for asynchronous commits
+#endif
+#define WAL_WRITER_MAX_DELAY_MS 10000
 
 typedef enum {
     WAL_BEGIN,
@@ -14,34 +33,147 @@ typedef enum {
     WAL_UPDATE,
     WAL_DELETE,
     WAL_DDL,
-    WAL_CHECKPOINT
+    WAL_CHECKPOINT,
+    WAL_CLR             // Compensation: undoes one INSERT/UPDATE/DELETE
 } WALRecordType;
 
+/*
+ * The log is a sequence of WAL_SEGMENT_SIZE segment files named
+ * <wal>.<segment number, 12 digits>, each laid out as
+ * [WALSegmentHeader][record][record]...
+ * A record is its header (every field up to payload) followed by
+ * before_len + after_len payload bytes, so BEGIN/COMMIT records carry no
+ * payload at all. A record's LSN is its byte position in the whole log
+ * (segment * WAL_SEGMENT_SIZE + offset), which makes LSN 0 invalid and
+ * lets a reader find the next record at lsn + length. Records never span
+ * two segments.
+ *
+ * A compensation log record (CLR) is written for every change a rollback
+ * undoes. Its before image is the row as the change left it and its after
+ * image the row put back, so REDO replays it like an UPDATE. Its prev_lsn
+ * is the compensated record's prev_lsn (ARIES' UndoNxtLSN): a chain never
+ * leads back into undone work, and CLRs themselves are never undone.
+ */
 typedef struct {
-    WALRecordType type;
-    uint32_t txn_id;
-    uint64_t lsn;          // Log Sequence Number
+    char magic[8];                // WAL_MAGIC
+    uint32_t version;             // WAL_FORMAT_VERSION
+    uint32_t reserved;
+    uint64_t segment;             // Segment number this file holds
+} __attribute__((packed)) WALSegmentHeader;
+
+#define WAL_SEGMENT_OF(lsn) ((uint64_t)(lsn) / WAL_SEGMENT_SIZE)
+#define WAL_SEGMENT_START(segment) ((uint64_t)(segment) * WAL_SEGMENT_SIZE)
+#define WAL_FIRST_RECORD_LSN(segment) (WAL_SEGMENT_START(segment) + sizeof(WALSegmentHeader))
+
+typedef struct {
+    uint32_t length;       // Header + payload bytes
+    uint32_t checksum;     // CRC32C over header + payload, excluding this field
+    uint64_t lsn;          // Log Sequence Number (byte offset in the log)
     uint64_t prev_lsn;     // Previous LSN for this transaction
-    int page_id;
-    int record_size;
-    char before_image[256]; // For UNDO
-    char after_image[256];  // For REDO
-    uint32_t checksum;
-} 
-#ifdef MACOS
-__attribute__((packed, aligned(PLATFORM_ALIGNMENT)))
-#else
-__attribute__((packed))
-#endif
-WALRecord;
+    uint32_t txn_id;
+    int32_t page_id;
+    uint8_t type;          // WALRecordType
+    uint16_t before_len;   // For UNDO
+    uint16_t after_len;    // For REDO
+    char payload[WAL_MAX_PAYLOAD]; // before image, then after image
+} __attribute__((packed)) WALRecord;
+
+#define WAL_HEADER_SIZE ((int)offsetof(WALRecord, payload))
+
+static inline const char* wal_before_image(const WALRecord* record) {
+    return record->payload;
+}
+
+static inline const char* wal_after_image(const WALRecord* record) {
+    return record->payload + record->before_len;
+}
+
+/*
+ * A checkpoint is logged as one or more WAL_CHECKPOINT records, each
+ * carrying this header followed by txn_count WALCheckpointTxn entries and
+ * page_count WALCheckpointPage entries in its after image. Together they
+ * hold the active transaction table (ATT) and dirty page table (DPT) as of
+ * begin_lsn; the first record has WAL_CHECKPOINT_FIRST set and the last
+ * WAL_CHECKPOINT_LAST. A checkpoint without its last record is ignored.
+ */
+#define WAL_CHECKPOINT_FIRST 0x01
+#define WAL_CHECKPOINT_LAST 0x02
+
+typedef struct {
+    uint64_t begin_lsn;     // End of the log when the checkpoint started
+    uint64_t redo_lsn;      // Where REDO starts: min(begin_lsn, recLSNs in the DPT)
+    uint16_t txn_count;
+    uint16_t page_count;
+    uint8_t flags;
+    uint32_t next_txn_id;   // First transaction id not yet handed out (row versions stay below it)
+} __attribute__((packed)) WALCheckpointHeader;
+
+typedef struct {
+    uint32_t txn_id;
+    uint64_t first_lsn;     // First record the transaction logged
+    uint64_t last_lsn;      // Head of its prev_lsn chain
+} __attribute__((packed)) WALCheckpointTxn;
+
+typedef struct {
+    int32_t page_id;
+    uint64_t rec_lsn;       // First change to the page that may not be on disk
+} __attribute__((packed)) WALCheckpointPage;
+
+/*
+ * Control file <wal>.control: locates the last complete checkpoint so
+ * recovery does not have to search the log for it. Replaced atomically
+ * (write temp file, fsync, rename) after every checkpoint.
+ */
+typedef struct {
+    char magic[8];            // WAL_CONTROL_MAGIC
+    uint32_t version;         // WAL_FORMAT_VERSION
+    uint32_t checksum;        // CRC32C of the file with this field zeroed
+    uint64_t checkpoint_lsn;  // First record of the checkpoint
+    uint64_t redo_lsn;        // Its redo point
+} __attribute__((packed)) WALControlFile;
+
+// Sequential reader over the log; see wal_reader_next_ref()
+typedef struct {
+    uint64_t next_lsn;     // LSN of the record the next call returns
+    uint64_t end_lsn;      // End of the log when the reader was opened
+    const char* map;       // Mapped segment file (NULL if none)
+    size_t map_size;
+    uint64_t map_segment;
+} WALReader;
 
 typedef struct {
-    uint64_t current_lsn;
-    uint64_t checkpoint_lsn;
+    uint64_t current_lsn;       // LSN of the last record appended (may still be in buffer)
+    uint64_t insert_lsn;        // End of the log: where the next record goes
+    uint64_t written_lsn;       // End of the bytes handed to write()
+    uint64_t flushed_lsn;       // End of the bytes known durable (fsync'd)
+    uint64_t checkpoint_lsn;    // First record of the last complete checkpoint (0 = none)
+    uint64_t checkpoint_end_lsn; // End of the log right after it was taken
+    uint64_t redo_lsn;          // Redo point of the last checkpoint
+    time_t checkpoint_time;
+    char base_path[256];        // Segment files are <base_path>.<segment>
+    uint64_t segment;           // Segment being appended to (wal_fd)
+    uint64_t oldest_segment;    // Oldest segment still holding needed records
+    uint64_t last_segment;      // Highest segment file, including recycled spares
+    bool checkpoint_requested;
     int wal_fd;
     char buffer[WAL_BUFFER_SIZE];
     int buffer_pos;
     pthread_mutex_t wal_mutex;
+    // Group commit: one committer fsyncs on behalf of everyone waiting
+    pthread_cond_t flush_cond;
+    bool flush_in_progress;
+    int flush_waiters;
+    uint64_t fsync_count;
+    // Asynchronous commit: the WAL writer flushes commits nobody waited for
+    uint64_t async_commit_lsn;  // Latest commit record returned before it was durable
+    int writer_delay_ms;
+    bool writer_running;
+    pthread_t writer_thread;
+    pthread_cond_t writer_cond;
+    // Active transaction table: transactions with records but no COMMIT/ABORT yet
+    WALCheckpointTxn* active_txns;
+    int active_txn_count;
+    int active_txn_capacity;
 } WALManager;
 
 #endif
\ No newline at end of file
@@ -3,7 +3,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <sys/mman.h>
-#include "../../common/types.h"
+#include "../../common/wal_types.h"
 
 #define BUFFER_POOL_SIZE 100
 
@@ -19,6 +19,8 @@ static SharedBufferPool* shared_buffer = NULL;
 
 extern int read_page_from_disk(int page_id, char* data);
 extern int write_page_to_disk(int page_id, const char* data);
+extern void flush_wal();
+extern uint64_t wal_end_lsn();
 
 int init_buffer_manager() {
     // Create shared memory for buffer pool
@@ -43,6 +45,9 @@ int init_buffer_manager() {
         shared_buffer->buffer_pool[i].dirty = false;
         shared_buffer->buffer_pool[i].in_use = false;
         shared_buffer->buffer_pool[i].pin_count = 0;
+        shared_buffer->buffer_pool[i].version = 0;
+        shared_buffer->buffer_pool[i].rec_lsn = 0;
+        shared_buffer->buffer_pool[i].unlogged = false;
         
         pthread_mutexattr_init(&attr);
         pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
@@ -55,86 +60,188 @@ int init_buffer_manager() {
     return 0;
 }
 
+/*
+ * Pinning protocol:
+ * - pin_count, page_id and in_use are accessed atomically so that pin_page()
+ *   can pin a resident page without taking buffer_mutex.
+ * - A lock-free pinner increments pin_count and then re-checks that the
+ *   frame still holds its page; an evictor claims a frame by moving
+ *   pin_count 0 -> 1, clears in_use and then re-checks that nobody else
+ *   pinned it. With sequentially consistent atomics at least one side sees
+ *   the other and backs off.
+ * - Nobody waits for a frame's page_mutex while holding buffer_mutex: a
+ *   thread holding one page latch may need buffer_mutex for its next page
+ *   (a new heap page, an index page), so get_page() pins first, releases
+ *   buffer_mutex and only then latches the frame.
+ */
 int find_lru_page() {
-    int lru_idx = -1;
-    int min_counter = shared_buffer->global_counter + 1;
-    
-    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        // Page must not be in use and not pinned to be replaceable
-        if (shared_buffer->buffer_pool[i].pin_count == 0) {
-            if (shared_buffer->lru_counter[i] < min_counter) {
-                min_counter = shared_buffer->lru_counter[i];
-                lru_idx = i;
+    for (;;) {
+        int lru_idx = -1;
+        int min_counter = shared_buffer->global_counter + 1;
+
+        for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+            // Page must not be pinned to be replaceable
+            if (__atomic_load_n(&shared_buffer->buffer_pool[i].pin_count, __ATOMIC_RELAXED) == 0) {
+                if (shared_buffer->lru_counter[i] < min_counter) {
+                    min_counter = shared_buffer->lru_counter[i];
+                    lru_idx = i;
+                }
             }
         }
+        if (lru_idx == -1) return -1;
+
+        Page* frame = &shared_buffer->buffer_pool[lru_idx];
+        int expected = 0;
+        if (!__atomic_compare_exchange_n(&frame->pin_count, &expected, 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            continue;   // Pinned meanwhile, pick again
+        }
+        bool was_in_use = frame->in_use;
+        __atomic_store_n(&frame->in_use, false, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&frame->pin_count, __ATOMIC_SEQ_CST) == 1) {
+            return lru_idx;   // Claimed with pin_count 1
+        }
+
+        // A lock-free pinner got in first: give the frame back
+        __atomic_store_n(&frame->in_use, was_in_use, __ATOMIC_SEQ_CST);
+        __atomic_sub_fetch(&frame->pin_count, 1, __ATOMIC_SEQ_CST);
+        shared_buffer->lru_counter[lru_idx] = ++shared_buffer->global_counter;
     }
-    return lru_idx;
 }
 
-Page* get_page(int page_id, uint32_t txn_id) {
-    if (!shared_buffer) return NULL;
-    
-    pthread_mutex_lock(&shared_buffer->buffer_mutex);
-    
-    // Check if page is already in buffer
+// Pin a resident frame without buffer_mutex; returns NULL if not resident
+static Page* pin_resident(int page_id) {
     for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (shared_buffer->buffer_pool[i].page_id == page_id && shared_buffer->buffer_pool[i].in_use) {
-            pthread_mutex_lock(&shared_buffer->buffer_pool[i].page_mutex);
-            shared_buffer->buffer_pool[i].pin_count++;
-            shared_buffer->lru_counter[i] = ++shared_buffer->global_counter;
-            pthread_mutex_unlock(&shared_buffer->buffer_mutex);
-            return &shared_buffer->buffer_pool[i];
+        Page* frame = &shared_buffer->buffer_pool[i];
+        if (__atomic_load_n(&frame->page_id, __ATOMIC_RELAXED) != page_id) continue;
+
+        __atomic_add_fetch(&frame->pin_count, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&frame->in_use, __ATOMIC_SEQ_CST) &&
+            __atomic_load_n(&frame->page_id, __ATOMIC_SEQ_CST) == page_id) {
+            // Only touch the shared LRU state when it is stale, to keep hits read-mostly
+            int now = __atomic_load_n(&shared_buffer->global_counter, __ATOMIC_RELAXED);
+            if (shared_buffer->lru_counter[i] != now) {
+                __atomic_store_n(&shared_buffer->lru_counter[i], now, __ATOMIC_RELAXED);
+            }
+            return frame;
         }
+        __atomic_sub_fetch(&frame->pin_count, 1, __ATOMIC_SEQ_CST);
     }
-    
-    // Find LRU page to replace
+    return NULL;
+}
+
+// Pin page_id, reading it from disk if needed. Caller holds buffer_mutex.
+static Page* pin_locked(int page_id) {
+    Page* frame = pin_resident(page_id);
+    if (frame) {
+        shared_buffer->lru_counter[frame - shared_buffer->buffer_pool] = ++shared_buffer->global_counter;
+        return frame;
+    }
+
+    // Find LRU page to replace (returned already pinned)
     int idx = find_lru_page();
     if (idx == -1) {
-        pthread_mutex_unlock(&shared_buffer->buffer_mutex);
         printf("No available buffer pages - all pinned\n");
         return NULL;
     }
-    
-    // If page is dirty and valid, write to disk
-    if (shared_buffer->buffer_pool[idx].dirty && shared_buffer->buffer_pool[idx].page_id != -1) {
-        write_page_to_disk(shared_buffer->buffer_pool[idx].page_id, shared_buffer->buffer_pool[idx].data);
-        printf("Wrote dirty page %d to disk\n", shared_buffer->buffer_pool[idx].page_id);
+    frame = &shared_buffer->buffer_pool[idx];
+
+    // If page is dirty and valid, write to disk (log first: write-ahead rule)
+    if (frame->dirty && frame->page_id != -1) {
+        flush_wal();
+        write_page_to_disk(frame->page_id, frame->data);
+        printf("Wrote dirty page %d to disk\n", frame->page_id);
     }
-    
+
     // Load new page
-    shared_buffer->buffer_pool[idx].page_id = page_id;
-    if (read_page_from_disk(page_id, shared_buffer->buffer_pool[idx].data) != 0) {
-        memset(shared_buffer->buffer_pool[idx].data, 0, PAGE_SIZE);
+    __atomic_store_n(&frame->page_id, page_id, __ATOMIC_SEQ_CST);
+    if (read_page_from_disk(page_id, frame->data) != 0) {
+        memset(frame->data, 0, PAGE_SIZE);
     }
-    
-    pthread_mutex_lock(&shared_buffer->buffer_pool[idx].page_mutex);
-    
-    shared_buffer->buffer_pool[idx].dirty = false;
-    shared_buffer->buffer_pool[idx].in_use = true;
-    shared_buffer->buffer_pool[idx].pin_count = 1;
+    frame->dirty = false;
+    frame->rec_lsn = 0;
+    frame->unlogged = false;
     shared_buffer->lru_counter[idx] = ++shared_buffer->global_counter;
+    __atomic_store_n(&frame->in_use, true, __ATOMIC_SEQ_CST);
+    return frame;
+}
+
+Page* get_page(int page_id, uint32_t txn_id) {
+    (void)txn_id;
+    if (!shared_buffer) return NULL;
     
-    pthread_mutex_unlock(&shared_buffer->buffer_mutex);
+    Page* page = pin_resident(page_id);
+    if (!page) {
+        pthread_mutex_lock(&shared_buffer->buffer_mutex);
+        page = pin_locked(page_id);
+        pthread_mutex_unlock(&shared_buffer->buffer_mutex);
+    }
     
-    return &shared_buffer->buffer_pool[idx];
+    // Latch only once buffer_mutex is released (see the pinning protocol);
+    // the pin keeps the frame from being evicted meanwhile
+    if (page) {
+        pthread_mutex_lock(&page->page_mutex);
+    }
+    return page;
 }
 
 void unpin_page(Page* page) {
-    if (page && page->pin_count > 0) {
-        page->pin_count--;
+    if (page && __atomic_load_n(&page->pin_count, __ATOMIC_SEQ_CST) > 0) {
         pthread_mutex_unlock(&page->page_mutex);
+        __atomic_sub_fetch(&page->pin_count, 1, __ATOMIC_SEQ_CST);
     }
 }
 
-void mark_dirty(Page* page) {
+/*
+ * Pin a page without taking its page_mutex. Used by the B+tree, which
+ * synchronizes on Page.version instead so that readers never block each
+ * other. Resident pages are pinned without touching buffer_mutex.
+ */
+Page* pin_page(int page_id) {
+    if (!shared_buffer) return NULL;
+
+    Page* page = pin_resident(page_id);
+    if (page) return page;
+
+    pthread_mutex_lock(&shared_buffer->buffer_mutex);
+    page = pin_locked(page_id);
+    pthread_mutex_unlock(&shared_buffer->buffer_mutex);
+    return page;
+}
+
+void release_page(Page* page) {
+    if (page && __atomic_load_n(&page->pin_count, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_sub_fetch(&page->pin_count, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/*
+ * Dirty page tracking for fuzzy checkpoints: a page's rec_lsn is the first
+ * WAL record whose change may not be on disk yet. It is set when a clean
+ * page is dirtied and cleared when the page is written out. lsn is the
+ * record describing the change; 0 means the change is not logged, and the
+ * page is then written at the next checkpoint since REDO cannot rebuild it.
+ */
+void mark_dirty_lsn(Page* page, uint64_t lsn) {
     if (page) {
+        if (!page->dirty || page->rec_lsn == 0 || (lsn != 0 && lsn < page->rec_lsn)) {
+            page->rec_lsn = lsn != 0 ? lsn : wal_end_lsn();
+        }
+        if (lsn == 0) page->unlogged = true;
         page->dirty = true;
     }
 }
 
+// Dirty a page with a change that is not WAL-logged
+void mark_dirty(Page* page) {
+    mark_dirty_lsn(page, 0);
+}
+
 void flush_all_pages() {
     if (!shared_buffer) return;
     
+    // Write-ahead rule: log records reach disk before the pages they describe
+    flush_wal();
     pthread_mutex_lock(&shared_buffer->buffer_mutex);
     
     int flushed = 0;
@@ -142,6 +249,8 @@ void flush_all_pages() {
         if (shared_buffer->buffer_pool[i].dirty && shared_buffer->buffer_pool[i].page_id != -1) {
             write_page_to_disk(shared_buffer->buffer_pool[i].page_id, shared_buffer->buffer_pool[i].data);
             shared_buffer->buffer_pool[i].dirty = false;
+            shared_buffer->buffer_pool[i].rec_lsn = 0;
+            shared_buffer->buffer_pool[i].unlogged = false;
             flushed++;
         }
     }
@@ -150,6 +259,74 @@ void flush_all_pages() {
     printf("Flushed %d dirty pages to disk\n", flushed);
 }
 
+/*
+ * Write a pinned page through to disk now (log first). Used for changes
+ * that must not wait for a checkpoint, such as linking a new page into a
+ * table's chain.
+ */
+void flush_page(Page* page) {
+    if (!page || !page->dirty) return;
+    flush_wal();
+    write_page_to_disk(page->page_id, page->data);
+    page->dirty = false;
+    page->rec_lsn = 0;
+    page->unlogged = false;
+}
+
+/*
+ * Checkpoint writes: pages with unlogged changes, and pages that have
+ * stayed dirty since before lsn so that the redo point keeps advancing
+ * even for pages that are never evicted. Returns the number written.
+ */
+int flush_checkpoint_pages(uint64_t lsn) {
+    if (!shared_buffer) return 0;
+    
+    flush_wal();
+    pthread_mutex_lock(&shared_buffer->buffer_mutex);
+    
+    int flushed = 0;
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        Page* frame = &shared_buffer->buffer_pool[i];
+        if (frame->dirty && frame->page_id != -1 && (frame->unlogged || frame->rec_lsn < lsn)) {
+            write_page_to_disk(frame->page_id, frame->data);
+            frame->dirty = false;
+            frame->rec_lsn = 0;
+            frame->unlogged = false;
+            flushed++;
+        }
+    }
+    
+    pthread_mutex_unlock(&shared_buffer->buffer_mutex);
+    return flushed;
+}
+
+/*
+ * Snapshot the dirty page table for a checkpoint. Nothing is written; the
+ * caller frees *pages. Returns the number of entries.
+ */
+int collect_dirty_pages(WALCheckpointPage** pages) {
+    *pages = NULL;
+    if (!shared_buffer) return 0;
+    
+    WALCheckpointPage* table = malloc(BUFFER_POOL_SIZE * sizeof(WALCheckpointPage));
+    if (!table) return -1;
+    
+    pthread_mutex_lock(&shared_buffer->buffer_mutex);
+    int count = 0;
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+        Page* frame = &shared_buffer->buffer_pool[i];
+        if (frame->dirty && frame->page_id != -1) {
+            table[count].page_id = frame->page_id;
+            table[count].rec_lsn = frame->rec_lsn;
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&shared_buffer->buffer_mutex);
+    
+    *pages = table;
+    return count;
+}
+
 void cleanup_buffer_manager() {
     if (shared_buffer) {
         flush_all_pages();
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <pthread.h>
 #include <sys/mman.h>
 #include "../../common/types.h"
@@ -10,7 +11,9 @@ typedef struct {
     int record_count;
     int next_page;
     int deleted_count;
-    char records[PAGE_SIZE - 12];
+    int reserved;
+    uint64_t page_lsn;      // LSN of the last WAL record applied to this page
+    char records[PAGE_SIZE - 24];
 } DataPage;
 
 // Shared catalog structure
@@ -27,6 +30,12 @@ typedef struct {
 static SharedCatalog* shared_catalog = NULL;
 
 extern int write_system_table_record(int table_id, const void* record, int record_size);
+extern Page* get_page(int page_id, uint32_t txn_id);
+extern void unpin_page(Page* page);
+extern void mark_dirty(Page* page);
+extern void flush_all_pages();
+
+void load_index_catalog();
 
 int init_system_catalog() {
     // Create shared memory for catalog
@@ -123,9 +132,6 @@ int init_system_catalog() {
     shared_catalog->table_count = 4;
     
     // Load existing tables from disk - simplified approach
-    extern Page* get_page(int page_id, uint32_t txn_id);
-    extern void unpin_page(Page* page);
-    
     Page* sys_tables_page = get_page(1, 1); // System transaction
     if (sys_tables_page) {
         typedef struct {
@@ -200,6 +206,8 @@ int init_system_catalog() {
     pthread_mutex_unlock(&shared_catalog->catalog_mutex);
     printf("Shared system catalog initialized with %d tables (including %d user tables)\n", 
            shared_catalog->table_count, shared_catalog->table_count - 4);
+    
+    load_index_catalog();
     return 0;
 }
 
@@ -211,7 +219,12 @@ void cleanup_catalog() {
     }
 }
 
-int create_table_catalog(const char* table_name, Column* columns, int column_count) {
+/*
+ * Register a table. The table_id is the page id of the table's first data
+ * page, so heap access can start from table->table_id without colliding with
+ * pages handed out later to other tables or indexes.
+ */
+int create_table_catalog(const char* table_name, Column* columns, int column_count, int table_id) {
     if (!shared_catalog) return -1;
     
     pthread_mutex_lock(&shared_catalog->catalog_mutex);
@@ -223,7 +236,9 @@ int create_table_catalog(const char* table_name, Column* columns, int column_cou
         }
     }
     
-    int table_id = shared_catalog->next_table_id++;
+    if (table_id >= shared_catalog->next_table_id) {
+        shared_catalog->next_table_id = table_id + 1;
+    }
     
     strcpy(shared_catalog->tables[shared_catalog->table_count].name, table_name);
     shared_catalog->tables[shared_catalog->table_count].table_id = table_id;
@@ -266,10 +281,246 @@ Table* find_table_by_name(const char* name) {
 
 // Minimal implementations for other functions
 int drop_table_catalog(const char* table_name) { return 0; }
-int create_index_catalog(const char* index_name, int table_id, const char* column_name, int index_type, int root_page_id) { return 0; }
-int drop_index_catalog(const char* index_name) { return 0; }
 Table* find_table_by_id(int table_id) { return NULL; }
-Index* find_index_by_name(const char* name) { return NULL; }
+
+/*
+ * Index metadata persistence
+ * ==========================
+ * Index definitions are stored in sys_indexes (page 3). Columns are saved by
+ * ordinal rather than name so that a definition survives the simplified
+ * schema restore in init_system_catalog(). Dropped indexes are tombstoned
+ * in place (index_id = -1) because system pages are append-only.
+ */
+typedef struct {
+    int index_id;
+    char index_name[MAX_NAME_LEN];
+    int table_id;
+    int index_type;
+    int root_page_id;
+    int key_count;
+    int key_columns[MAX_INDEX_COLUMNS];
+    int include_count;
+    int include_columns[MAX_INDEX_COLUMNS];
+} SysIndexRecord;
+
+static int column_ordinal(const Table* table, const char* column_name) {
+    for (int i = 0; i < table->column_count; i++) {
+        if (strcasecmp(table->columns[i].name, column_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static Table* find_table_by_id_locked(int table_id) {
+    for (int i = 0; i < shared_catalog->table_count; i++) {
+        if (shared_catalog->tables[i].table_id == table_id) {
+            return &shared_catalog->tables[i];
+        }
+    }
+    return NULL;
+}
+
+void load_index_catalog() {
+    if (!shared_catalog) return;
+    
+    Page* sys_indexes_page = get_page(SYS_INDEXES_ID, 1);
+    if (!sys_indexes_page) return;
+    
+    pthread_mutex_lock(&shared_catalog->catalog_mutex);
+    
+    DataPage* data_page = (DataPage*)sys_indexes_page->data;
+    int record_count = data_page->record_count;
+    if (record_count < 0 || record_count * (int)sizeof(SysIndexRecord) > (int)sizeof(data_page->records)) {
+        record_count = 0;
+    }
+    
+    for (int i = 0; i < record_count && shared_catalog->index_count < 100; i++) {
+        SysIndexRecord* record = (SysIndexRecord*)(data_page->records + i * sizeof(SysIndexRecord));
+        if (record->index_id <= 0) continue; // Dropped
+        
+        Table* table = find_table_by_id_locked(record->table_id);
+        if (!table || record->key_count <= 0 || record->key_count > MAX_INDEX_COLUMNS) {
+            continue;
+        }
+        
+        Index* index = &shared_catalog->indexes[shared_catalog->index_count];
+        memset(index, 0, sizeof(Index));
+        index->index_id = record->index_id;
+        strcpy(index->name, record->index_name);
+        index->table_id = record->table_id;
+        index->type = record->index_type;
+        index->root_page_id = record->root_page_id;
+        for (int c = 0; c < record->key_count; c++) {
+            int ordinal = record->key_columns[c];
+            if (ordinal >= 0 && ordinal < table->column_count) {
+                strcpy(index->key_columns[index->key_count++], table->columns[ordinal].name);
+            }
+        }
+        if (index->key_count != record->key_count) {
+            continue; // Key column no longer exists
+        }
+        for (int c = 0; c < record->include_count && c < MAX_INDEX_COLUMNS; c++) {
+            int ordinal = record->include_columns[c];
+            if (ordinal >= 0 && ordinal < table->column_count) {
+                strcpy(index->include_columns[index->include_count++], table->columns[ordinal].name);
+            }
+        }
+        
+        printf("Restoring index: %s on table %d (%d key columns, %d included)\n",
+               index->name, index->table_id, index->key_count, index->include_count);
+        shared_catalog->index_count++;
+        if (record->index_id >= shared_catalog->next_index_id) {
+            shared_catalog->next_index_id = record->index_id + 1;
+        }
+    }
+    
+    pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+    unpin_page(sys_indexes_page);
+}
+
+int create_index_catalog(const char* index_name, int table_id,
+                         char key_columns[][MAX_NAME_LEN], int key_count,
+                         char include_columns[][MAX_NAME_LEN], int include_count,
+                         int index_type, int root_page_id) {
+    if (!shared_catalog) return -1;
+    if (key_count <= 0 || key_count > MAX_INDEX_COLUMNS) return -1;
+    if (include_count < 0 || include_count > MAX_INDEX_COLUMNS) return -1;
+    
+    pthread_mutex_lock(&shared_catalog->catalog_mutex);
+    
+    Table* table = find_table_by_id_locked(table_id);
+    if (!table || shared_catalog->index_count >= 100) {
+        pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+        return -1;
+    }
+    
+    for (int i = 0; i < shared_catalog->index_count; i++) {
+        if (strcasecmp(shared_catalog->indexes[i].name, index_name) == 0) {
+            pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+            return -1;
+        }
+    }
+    
+    SysIndexRecord record;
+    memset(&record, 0, sizeof(record));
+    for (int i = 0; i < key_count; i++) {
+        record.key_columns[i] = column_ordinal(table, key_columns[i]);
+        if (record.key_columns[i] < 0) {
+            pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+            return -1;
+        }
+    }
+    for (int i = 0; i < include_count; i++) {
+        record.include_columns[i] = column_ordinal(table, include_columns[i]);
+        if (record.include_columns[i] < 0) {
+            pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+            return -1;
+        }
+    }
+    
+    Index* index = &shared_catalog->indexes[shared_catalog->index_count];
+    memset(index, 0, sizeof(Index));
+    index->index_id = shared_catalog->next_index_id++;
+    strcpy(index->name, index_name);
+    index->table_id = table_id;
+    index->type = index_type;
+    index->root_page_id = root_page_id;
+    for (int i = 0; i < key_count; i++) {
+        strcpy(index->key_columns[i], table->columns[record.key_columns[i]].name);
+    }
+    index->key_count = key_count;
+    for (int i = 0; i < include_count; i++) {
+        strcpy(index->include_columns[i], table->columns[record.include_columns[i]].name);
+    }
+    index->include_count = include_count;
+    shared_catalog->index_count++;
+    
+    record.index_id = index->index_id;
+    strcpy(record.index_name, index_name);
+    record.table_id = table_id;
+    record.index_type = index_type;
+    record.root_page_id = root_page_id;
+    record.key_count = key_count;
+    record.include_count = include_count;
+    write_system_table_record(2, &record, sizeof(record)); // Save to sys_indexes (page 3)
+    
+    int index_id = index->index_id;
+    pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+    return index_id;
+}
+
+int drop_index_catalog(const char* index_name) {
+    if (!shared_catalog) return -1;
+    
+    pthread_mutex_lock(&shared_catalog->catalog_mutex);
+    
+    int pos = -1;
+    for (int i = 0; i < shared_catalog->index_count; i++) {
+        if (strcasecmp(shared_catalog->indexes[i].name, index_name) == 0) {
+            pos = i;
+            break;
+        }
+    }
+    if (pos == -1) {
+        pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+        return -1;
+    }
+    
+    int index_id = shared_catalog->indexes[pos].index_id;
+    for (int i = pos; i < shared_catalog->index_count - 1; i++) {
+        shared_catalog->indexes[i] = shared_catalog->indexes[i + 1];
+    }
+    shared_catalog->index_count--;
+    
+    // Tombstone the persisted definition
+    Page* page = get_page(SYS_INDEXES_ID, 1);
+    if (page) {
+        DataPage* data_page = (DataPage*)page->data;
+        for (int i = 0; i < data_page->record_count; i++) {
+            SysIndexRecord* record = (SysIndexRecord*)(data_page->records + i * sizeof(SysIndexRecord));
+            if (record->index_id == index_id) {
+                record->index_id = -1;
+                mark_dirty(page);
+                break;
+            }
+        }
+        unpin_page(page);
+        flush_all_pages();
+    }
+    
+    pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+    return 0;
+}
+
+Index* find_index_by_name(const char* name) {
+    if (!shared_catalog) return NULL;
+    
+    pthread_mutex_lock(&shared_catalog->catalog_mutex);
+    for (int i = 0; i < shared_catalog->index_count; i++) {
+        if (strcasecmp(shared_catalog->indexes[i].name, name) == 0) {
+            pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+            return &shared_catalog->indexes[i];
+        }
+    }
+    pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+    return NULL;
+}
+
+int get_table_indexes(int table_id, Index* result_indexes, int max_indexes) {
+    if (!shared_catalog) return 0;
+    
+    pthread_mutex_lock(&shared_catalog->catalog_mutex);
+    int count = 0;
+    for (int i = 0; i < shared_catalog->index_count && count < max_indexes; i++) {
+        if (shared_catalog->indexes[i].table_id == table_id) {
+            result_indexes[count++] = shared_catalog->indexes[i];
+        }
+    }
+    pthread_mutex_unlock(&shared_catalog->catalog_mutex);
+    return count;
+}
+
 int get_all_tables(Table* result_tables, int max_tables) {
     if (!shared_catalog) return 0;
     
@@ -13,7 +13,9 @@
 
 static int db_fd = -1;
 static pthread_mutex_t disk_mutex = PTHREAD_MUTEX_INITIALIZER;
-static int next_page_id = 10;
+#define FIRST_USER_PAGE_ID 10 // Pages 1-5 hold the system catalog
+
+static int next_page_id = FIRST_USER_PAGE_ID;
 
 int init_disk_manager(const char* db_file) {
     pthread_mutex_lock(&disk_mutex);
@@ -29,6 +31,10 @@ int init_disk_manager(const char* db_file) {
     if (file_size > 0) {
         next_page_id = (file_size / PAGE_SIZE) + 1;
     }
+    // Table ids are first data page ids; user pages never overlap the catalog range
+    if (next_page_id < FIRST_USER_PAGE_ID) {
+        next_page_id = FIRST_USER_PAGE_ID;
+    }
     
     pthread_mutex_unlock(&disk_mutex);
     printf("Disk manager initialized, file: %s, next_page_id: %d\n", 
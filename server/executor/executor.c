@@ -26,9 +26,20 @@
  *    - Hash: Supports equality queries, fastest for exact matches
  *    - Cost: O(log n + k) where k = result size
  * 
- * 3. Index-Only Scan (Future):
- *    - Returns data directly from index without table access
- *    - Requires covering indexes
+ * 3. Index-Only Scan:
+ *    - Returns column values from B-Tree leaf entries; each matching entry
+ *      still probes its row version in the heap for MVCC visibility
+ *    - Requires a covering index: every WHERE column and every projected
+ *      column must be a key or INCLUDE column
+ *    - Predicates on a key prefix: range scan; otherwise full leaf scan
+ *      with filter
+ * 
+ * COMPOSITE KEYS:
+ * - '=' predicates on leading key columns plus one range predicate on the
+ *   next key column become a single prefix range scan, e.g. index
+ *   (tenant, ts) serves WHERE tenant = X AND ts > Y
+ * - All WHERE predicates are re-checked on each row, so bounds only
+ *   narrow the scan
  * 
  * EXECUTION PIPELINE:
  * 1. Receive query plan from optimizer
@@ -39,8 +50,14 @@
  * 
  * TRANSACTION INTEGRATION:
  * - All operations respect transaction isolation levels
- * - Acquires appropriate locks (shared for reads, exclusive for writes)
+ * - Acquires appropriate locks: shared table locks for reads; DML takes an
+ *   intention-exclusive table lock and storage X-locks each row it writes
+ *   (OCC transactions lock no rows and are validated at commit)
+ * - SELECT ... FOR UPDATE locks the rows it returns like UPDATE does;
+ *   NOWAIT and SKIP LOCKED never wait for a row lock
  * - Participates in two-phase commit protocol
+ * - DML auto-commits honour the session's synchronous_commit setting; DDL
+ *   always waits for its commit record to be durable
  */
 
 extern int create_table_storage(const char* table_name, Column* columns, int column_count, uint32_t txn_id);
@@ -49,24 +66,124 @@ extern int insert_record(const char* table_name, Value* values, int value_count,
 extern int update_record(const char* table_name, const char* column, Value* value, const char* where_clause, uint32_t txn_id);
 extern int delete_record(const char* table_name, const char* where_clause, uint32_t txn_id);
 extern int scan_table(const char* table_name, QueryResult* result, uint32_t txn_id);
-extern int create_btree_index(const char* index_name, const char* table_name, const char* column_name, uint32_t txn_id);
+extern int scan_table_where(const char* table_name, const BoundPredicate* predicates, int predicate_count,
+                            QueryResult* result, uint32_t txn_id);
+extern int create_btree_index(const char* index_name, const char* table_name,
+                              char key_columns[][MAX_NAME_LEN], int key_count,
+                              char include_columns[][MAX_NAME_LEN], int include_count, uint32_t txn_id);
+extern int create_art_index(const char* index_name, const char* table_name,
+                            char key_columns[][MAX_NAME_LEN], int key_count,
+                            char include_columns[][MAX_NAME_LEN], int include_count, uint32_t txn_id);
 extern int create_hash_index(const char* index_name, const char* table_name, const char* column_name, uint32_t txn_id);
 extern int drop_index_storage(const char* index_name, uint32_t txn_id);
 extern Table* find_table_by_name(const char* name);
 extern int get_all_tables(Table* result_tables, int max_tables);
+extern int get_table_indexes(int table_id, Index* result_indexes, int max_indexes);
+extern int fetch_record(Table* table, RecordId rid, Value* values, uint32_t txn_id);
+extern int compare_values(DataType type, const Value* a, const Value* b);
+extern int btree_scan(const Index* index, const Table* table, const IndexBound* low, const IndexBound* high,
+                      int (*visitor)(const Value* entry_values, RecordId rid, void* ctx),
+                      void* ctx, uint32_t txn_id);
+extern int art_scan(const Index* index, const Table* table, const IndexBound* low, const IndexBound* high,
+                    int (*visitor)(const Value* entry_values, RecordId rid, void* ctx), void* ctx);
+
+#define MAX_TABLE_INDEXES 8
 
-// Simple index existence check (stub implementation)
+// Index existence check against the catalog (leading key column); returns the index type or -1
 int check_index_exists(const char* table_name, const char* column_name) {
-    // For testing: assume dept column has B-Tree index, salary has Hash index
-    if (strcasecmp(column_name, "dept") == 0) {
-        return INDEX_BTREE;
-    } else if (strcasecmp(column_name, "salary") == 0) {
-        return INDEX_HASH;
+    Table* table = find_table_by_name(table_name);
+    if (!table) return -1;
+    
+    Index indexes[MAX_TABLE_INDEXES];
+    int index_count = get_table_indexes(table->table_id, indexes, MAX_TABLE_INDEXES);
+    for (int i = 0; i < index_count; i++) {
+        if (strcasecmp(indexes[i].key_columns[0], column_name) == 0) {
+            return indexes[i].type;
+        }
     }
     return -1; // No index
 }
 extern int acquire_read_lock(uint32_t txn_id, int resource_id);
 extern int acquire_write_lock(uint32_t txn_id, int resource_id);
+extern int acquire_table_lock(uint32_t txn_id, int table_id, LockMode mode);
+
+/*
+ * Report a lock the statement could not get, or a write conflict
+ * (REPEATABLE READ, OCC). Deadlocks and conflicts abort the whole
+ * transaction, not just the statement: a deadlock victim's locks go at
+ * once, so the transactions it blocked can proceed, and a retry under the
+ * same snapshot would fail again. A lock_timeout or NOWAIT failure only
+ * fails the statement.
+ */
+static int concurrency_error(QueryResult* result, int ret, uint32_t txn_id) {
+    extern int abort_conflicted_transaction(uint32_t txn_id);
+    
+    result->column_count = 1;
+    strcpy(result->columns[0].name, "Error");
+    result->columns[0].type = TYPE_VARCHAR;
+    result->row_count = 1;
+    if (ret == LOCK_DEADLOCK) {
+        snprintf(result->data[0][0].string_val, MAX_STRING_LEN,
+                 "Deadlock detected: transaction %u aborted", txn_id);
+        abort_conflicted_transaction(txn_id);
+    } else if (ret == SERIALIZATION_FAILURE) {
+        strcpy(result->data[0][0].string_val,
+               "Could not serialize access due to concurrent update");
+        abort_conflicted_transaction(txn_id);
+    } else if (ret == LOCK_TIMEOUT) {
+        strcpy(result->data[0][0].string_val, "Lock wait timed out (lock_timeout)");
+    } else if (ret == LOCK_NOT_AVAILABLE) {
+        strcpy(result->data[0][0].string_val, "Could not obtain lock on row (NOWAIT)");
+    } else {
+        strcpy(result->data[0][0].string_val, "Failed to acquire lock");
+    }
+    return -1;
+}
+
+static bool concurrency_failure(int ret) {
+    return ret == LOCK_DEADLOCK || ret == SERIALIZATION_FAILURE || ret == LOCK_TIMEOUT;
+}
+
+/*
+ * Auto-commit a DML statement. With synchronous_commit off the statement
+ * returns once the commit record is buffered and the WAL writer flushes it.
+ * Inside BEGIN ... COMMIT the statement's changes wait for the COMMIT.
+ * Returns 0, or SERIALIZATION_FAILURE if OCC validation aborted it.
+ */
+static int auto_commit_dml(uint32_t txn_id, const char* operation) {
+    extern int commit_transaction(uint32_t txn_id);
+    extern bool transaction_synchronous_commit(uint32_t txn_id);
+    extern bool transaction_in_block(uint32_t txn_id);
+    
+    if (transaction_in_block(txn_id)) {
+        printf("DML: %s deferred to the commit of transaction %u\n", operation, txn_id);
+        return 0;
+    }
+    bool synchronous = transaction_synchronous_commit(txn_id);
+    if (commit_transaction(txn_id) == SERIALIZATION_FAILURE) {
+        printf("DML: %s failed validation\n", operation);
+        return SERIALIZATION_FAILURE;
+    }
+    printf("DML: %s auto-committed %s\n", operation, synchronous ? "and flushed" : "(asynchronous)");
+    return 0;
+}
+
+// DDL always commits synchronously, whatever synchronous_commit says. It
+// cannot be rolled back, so inside a transaction block it commits the block
+static void auto_commit_ddl(uint32_t txn_id, const char* operation) {
+    extern void set_synchronous_commit(uint32_t txn_id, bool on);
+    extern int commit_transaction(uint32_t txn_id);
+    extern bool transaction_in_block(uint32_t txn_id);
+    
+    bool in_block = transaction_in_block(txn_id);
+    set_synchronous_commit(txn_id, true);
+    commit_transaction(txn_id);
+    if (in_block) {
+        printf("DDL: %s implicitly committed transaction %u and flushed\n", operation, txn_id);
+    } else {
+        printf("DDL: %s auto-committed and flushed\n", operation);
+    }
+}
 
 const char* datatype_to_string(DataType type) {
     switch (type) {
@@ -81,7 +198,8 @@ const char* datatype_to_string(DataType type) {
 
 int execute_create_table(const char* table_name, Column* columns, int column_count, uint32_t txn_id, QueryResult* result) {
     // Acquire write lock for DDL operation
-    acquire_write_lock(txn_id, 1); // System catalog lock
+    int lock = acquire_write_lock(txn_id, 1); // System catalog lock
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Log DDL operation to WAL
     extern uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_name);
@@ -91,11 +209,7 @@ int execute_create_table(const char* table_name, Column* columns, int column_cou
     
     // Auto-commit DDL operation
     if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal(); // Ensure DDL is durable
-        printf("DDL: CREATE TABLE auto-committed and flushed\n");
+        auto_commit_ddl(txn_id, "CREATE TABLE");
     }
     
     result->column_count = 1;
@@ -113,7 +227,8 @@ int execute_create_table(const char* table_name, Column* columns, int column_cou
 }
 
 int execute_drop_table(const char* table_name, uint32_t txn_id, QueryResult* result) {
-    acquire_write_lock(txn_id, 1);
+    int lock = acquire_write_lock(txn_id, 1);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Log DDL operation to WAL
     extern uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_name);
@@ -123,11 +238,7 @@ int execute_drop_table(const char* table_name, uint32_t txn_id, QueryResult* res
     
     // Auto-commit DDL operation
     if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DDL: DROP TABLE auto-committed and flushed\n");
+        auto_commit_ddl(txn_id, "DROP TABLE");
     }
     
     result->column_count = 1;
@@ -155,18 +266,16 @@ int execute_insert(const char* table_name, Value* values, int value_count, uint3
         return -1;
     }
     
-    // Acquire write lock for the table
-    acquire_write_lock(txn_id, table->table_id);
+    // Intention lock on the table; storage locks the new row
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IX);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     int ret = insert_record(table_name, values, value_count, txn_id);
+    if (concurrency_failure(ret)) return concurrency_error(result, ret, txn_id);
     
     // Auto-commit INSERT operation for durability
-    if (ret == 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DML: INSERT auto-committed and flushed\n");
+    if (ret == 0 && auto_commit_dml(txn_id, "INSERT") != 0) {
+        return concurrency_error(result, SERIALIZATION_FAILURE, txn_id);
     }
     
     result->column_count = 1;
@@ -194,18 +303,16 @@ int execute_update(const char* table_name, const char* column, Value* value, con
         return -1;
     }
     
-    acquire_write_lock(txn_id, table->table_id);
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IX);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Call actual update_record function
     int ret = update_record(table_name, column, value, where_clause, txn_id);
+    if (concurrency_failure(ret)) return concurrency_error(result, ret, txn_id);
     
     // Auto-commit UPDATE operation for durability
-    if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DML: UPDATE auto-committed and flushed\n");
+    if (ret >= 0 && auto_commit_dml(txn_id, "UPDATE") != 0) {
+        return concurrency_error(result, SERIALIZATION_FAILURE, txn_id);
     }
     
     result->column_count = 1;
@@ -233,18 +340,16 @@ int execute_delete(const char* table_name, const char* where_clause, uint32_t tx
         return -1;
     }
     
-    acquire_write_lock(txn_id, table->table_id);
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IX);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Call actual delete_record function
     int ret = delete_record(table_name, where_clause, txn_id);
+    if (concurrency_failure(ret)) return concurrency_error(result, ret, txn_id);
     
     // Auto-commit DELETE operation for durability
-    if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DML: DELETE auto-committed and flushed\n");
+    if (ret >= 0 && auto_commit_dml(txn_id, "DELETE") != 0) {
+        return concurrency_error(result, SERIALIZATION_FAILURE, txn_id);
     }
     
     result->column_count = 1;
@@ -261,28 +366,280 @@ int execute_delete(const char* table_name, const char* where_clause, uint32_t tx
     return ret >= 0 ? 0 : -1;
 }
 
+static int find_column_index(Table* table, const char* column_name) {
+    for (int i = 0; i < table->column_count; i++) {
+        if (strcasecmp(table->columns[i].name, column_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Convert a WHERE literal to a Value of the column's type
+static void parse_literal(DataType type, const char* text, Value* value) {
+    memset(value, 0, sizeof(Value));
+    switch (type) {
+        case TYPE_INT:
+            value->int_val = atoi(text);
+            break;
+        case TYPE_BIGINT:
+            value->bigint_val = atoll(text);
+            break;
+        case TYPE_FLOAT:
+            value->float_val = (float)atof(text);
+            break;
+        case TYPE_CHAR:
+        case TYPE_VARCHAR:
+            strncpy(value->string_val, text, MAX_STRING_LEN - 1);
+            break;
+    }
+}
+
+static bool predicate_matches(DataType type, const Value* row_value, const char* op, const Value* literal) {
+    int cmp = compare_values(type, row_value, literal);
+    if (strcmp(op, "=") == 0) return cmp == 0;
+    if (strcmp(op, ">") == 0) return cmp > 0;
+    if (strcmp(op, "<") == 0) return cmp < 0;
+    if (strcmp(op, ">=") == 0) return cmp >= 0;
+    if (strcmp(op, "<=") == 0) return cmp <= 0;
+    return false;
+}
+
+// Position of a table column in an index entry (keys, then INCLUDE columns), -1 if absent
+static int index_column_source(const Index* index, const char* column_name) {
+    for (int i = 0; i < index->key_count; i++) {
+        if (strcasecmp(index->key_columns[i], column_name) == 0) return i;
+    }
+    for (int i = 0; i < index->include_count; i++) {
+        if (strcasecmp(index->include_columns[i], column_name) == 0) return index->key_count + i;
+    }
+    return -1;
+}
+
+typedef struct {
+    Table* table;
+    int projection[MAX_COLUMNS];    // Table column ordinal per output column
+    int projection_count;
+    BoundPredicate predicates[MAX_PREDICATES];
+    int predicate_count;
+    int sources[MAX_COLUMNS];       // Index entry position per output column (index-only scan)
+    int predicate_sources[MAX_PREDICATES]; // Index entry position per predicate (index-only scan)
+    QueryResult* result;
+    uint32_t txn_id;
+} IndexScanContext;
+
+// Key range derived from the predicates for one index
+typedef struct {
+    const Index* index;
+    int eq_count;                   // Leading key columns fixed by '='
+    bool has_range;                 // Range predicate on the key column after them
+    bool covers;
+    Value low_values[MAX_INDEX_COLUMNS];
+    Value high_values[MAX_INDEX_COLUMNS];
+    IndexBound low;
+    IndexBound high;
+} IndexPlan;
+
+static int plan_score(const IndexPlan* plan) {
+    return plan->eq_count * 2 + (plan->has_range ? 1 : 0);
+}
+
+static void plan_index(const Index* index, const IndexScanContext* ctx, IndexPlan* plan) {
+    memset(plan, 0, sizeof(IndexPlan));
+    plan->index = index;
+    plan->low.values = plan->low_values;
+    plan->high.values = plan->high_values;
+    plan->low.inclusive = plan->high.inclusive = true;
+    
+    // Equality prefix
+    for (int k = 0; k < index->key_count; k++) {
+        const BoundPredicate* eq = NULL;
+        for (int p = 0; p < ctx->predicate_count && !eq; p++) {
+            const BoundPredicate* pred = &ctx->predicates[p];
+            if (strcmp(pred->op, "=") == 0 &&
+                strcasecmp(ctx->table->columns[pred->column].name, index->key_columns[k]) == 0) {
+                eq = pred;
+            }
+        }
+        if (!eq) break;
+        plan->low_values[k] = plan->high_values[k] = eq->literal;
+        plan->eq_count++;
+    }
+    plan->low.count = plan->high.count = plan->eq_count;
+    
+    // Range on the next key column
+    if (plan->eq_count < index->key_count) {
+        int k = plan->eq_count;
+        bool have_low = false, have_high = false;
+        for (int p = 0; p < ctx->predicate_count; p++) {
+            const BoundPredicate* pred = &ctx->predicates[p];
+            if (strcasecmp(ctx->table->columns[pred->column].name, index->key_columns[k]) != 0) continue;
+            
+            if (!have_low && (strcmp(pred->op, ">") == 0 || strcmp(pred->op, ">=") == 0)) {
+                plan->low_values[k] = pred->literal;
+                plan->low.count = k + 1;
+                plan->low.inclusive = strcmp(pred->op, ">=") == 0;
+                have_low = true;
+            } else if (!have_high && (strcmp(pred->op, "<") == 0 || strcmp(pred->op, "<=") == 0)) {
+                plan->high_values[k] = pred->literal;
+                plan->high.count = k + 1;
+                plan->high.inclusive = strcmp(pred->op, "<=") == 0;
+                have_high = true;
+            }
+        }
+        plan->has_range = have_low || have_high;
+    }
+    
+    plan->covers = true;
+    for (int p = 0; p < ctx->predicate_count && plan->covers; p++) {
+        plan->covers = index_column_source(index, ctx->table->columns[ctx->predicates[p].column].name) >= 0;
+    }
+    for (int col = 0; col < ctx->projection_count && plan->covers; col++) {
+        plan->covers = index_column_source(index, ctx->table->columns[ctx->projection[col]].name) >= 0;
+    }
+}
+
+/*
+ * Index-only scan: predicates and output columns come from the leaf entry.
+ * Entries outlive the row versions they point to (MVCC keeps old versions
+ * indexed), so a matching entry still checks the version's visibility.
+ */
+static int index_only_visitor(const Value* entry_values, RecordId rid, void* arg) {
+    IndexScanContext* ctx = (IndexScanContext*)arg;
+    
+    for (int p = 0; p < ctx->predicate_count; p++) {
+        const BoundPredicate* pred = &ctx->predicates[p];
+        if (!predicate_matches(ctx->table->columns[pred->column].type,
+                               &entry_values[ctx->predicate_sources[p]], pred->op, &pred->literal)) {
+            return 0;
+        }
+    }
+    if (fetch_record(ctx->table, rid, NULL, ctx->txn_id) != 0) return 0;
+    
+    QueryResult* result = ctx->result;
+    for (int col = 0; col < ctx->projection_count; col++) {
+        result->data[result->row_count][col] = entry_values[ctx->sources[col]];
+    }
+    result->row_count++;
+    return result->row_count >= MAX_RESULT_ROWS;
+}
+
+static bool row_matches(const IndexScanContext* ctx, const Value* values) {
+    for (int p = 0; p < ctx->predicate_count; p++) {
+        const BoundPredicate* pred = &ctx->predicates[p];
+        if (!predicate_matches(ctx->table->columns[pred->column].type,
+                               &values[pred->column], pred->op, &pred->literal)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void project_row(IndexScanContext* ctx, const Value* values) {
+    QueryResult* result = ctx->result;
+    for (int col = 0; col < ctx->projection_count; col++) {
+        result->data[result->row_count][col] = values[ctx->projection[col]];
+    }
+    result->row_count++;
+}
+
+// Index scan: the key range selects rows, the heap supplies the columns
+static int index_fetch_visitor(const Value* entry_values, RecordId rid, void* arg) {
+    IndexScanContext* ctx = (IndexScanContext*)arg;
+    (void)entry_values;
+    
+    Value values[MAX_COLUMNS];
+    if (fetch_record(ctx->table, rid, values, ctx->txn_id) != 0) {
+        return 0; // Version not visible to our snapshot
+    }
+    if (!row_matches(ctx, values)) return 0;
+    
+    project_row(ctx, values);
+    return ctx->result->row_count >= MAX_RESULT_ROWS;
+}
+
 /**
  * Execute SELECT query with WHERE clause
  * 
  * EXECUTION STRATEGY:
  * 1. Determine optimal scan method (index vs table scan)
- * 2. Acquire shared locks for read consistency
+ * 2. Read from the transaction's MVCC snapshot (no shared locks)
  * 3. Perform scan with predicate pushdown
  * 4. Apply WHERE clause filtering
  * 5. Project requested columns
  * 6. Return formatted results
  * 
  * SCAN SELECTION:
- * - Check for indexes on WHERE column
- * - Use index scan if available and selective
- * - Fall back to table scan with filter
+ * - Each B-Tree index is scored by how many leading key columns the
+ *   predicates fix ('=' counts double, a trailing range counts once)
+ * - Highest score wins; a covering index wins ties and is read with an
+ *   index-only scan: values come from the leaves, and only entries that
+ *   pass the predicates probe the heap to check visibility
+ * - With no usable key prefix, a covering index is still scanned leaf by
+ *   leaf; otherwise fall back to table scan with filter
  * 
  * FILTERING:
  * - Applies WHERE predicates as early as possible
  * - Reduces I/O by filtering at storage layer
- * - Supports equality and range predicates
+ * - Supports AND-ed equality and range predicates (=, >, <, >=, <=)
+ */
+// Ordered index scan for either index kind; both share the key-prefix bound contract
+static int scan_index(const Index* index, Table* table, const IndexBound* low, const IndexBound* high,
+                      int (*visitor)(const Value* entry_values, RecordId rid, void* ctx),
+                      void* ctx, uint32_t txn_id) {
+    if (index->type == INDEX_ART) {
+        return art_scan(index, table, low, high, visitor, ctx);
+    }
+    return btree_scan(index, table, low, high, visitor, ctx, txn_id);
+}
+
+/*
+ * Resolve the projection and WHERE predicates to table column ordinals in
+ * ctx and set up result's columns. Returns false if a WHERE column does
+ * not exist (the result stays empty).
  */
-int execute_select_with_where(const char* table_name, const char* where_column, const char* where_value, uint32_t txn_id, QueryResult* result) {
+static bool bind_select(Table* table, bool select_all, char columns[][MAX_NAME_LEN], int column_count,
+                        Predicate* predicates, int predicate_count, uint32_t txn_id,
+                        IndexScanContext* ctx, QueryResult* result) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->table = table;
+    ctx->result = result;
+    ctx->txn_id = txn_id;
+    
+    if (select_all || column_count <= 0) {
+        for (int i = 0; i < table->column_count; i++) {
+            ctx->projection[ctx->projection_count++] = i;
+        }
+    } else {
+        for (int i = 0; i < column_count && ctx->projection_count < MAX_COLUMNS; i++) {
+            int col = find_column_index(table, columns[i]);
+            if (col >= 0) {
+                ctx->projection[ctx->projection_count++] = col;
+            }
+        }
+    }
+    
+    result->column_count = ctx->projection_count;
+    for (int i = 0; i < ctx->projection_count; i++) {
+        result->columns[i] = table->columns[ctx->projection[i]];
+    }
+    result->row_count = 0;
+    
+    for (int p = 0; p < predicate_count && p < MAX_PREDICATES; p++) {
+        BoundPredicate* pred = &ctx->predicates[ctx->predicate_count++];
+        pred->column = find_column_index(table, predicates[p].column);
+        if (pred->column == -1) {
+            printf("EXECUTOR: WHERE column '%s' not found\n", predicates[p].column);
+            return false;
+        }
+        pred->op = predicates[p].op;
+        parse_literal(table->columns[pred->column].type, predicates[p].value, &pred->literal);
+    }
+    return true;
+}
+
+int execute_select_with_where(const char* table_name, bool select_all, char columns[][MAX_NAME_LEN], int column_count,
+                              Predicate* predicates, int predicate_count, uint32_t txn_id, QueryResult* result) {
     Table* table = find_table_by_name(table_name);
     if (!table) {
         result->column_count = 1;
@@ -293,97 +650,98 @@ int execute_select_with_where(const char* table_name, const char* where_column,
         return -1;
     }
     
-    acquire_read_lock(txn_id, table->table_id);
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IS);  // Snapshot read, see execute_select()
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
-    printf("EXECUTOR: Starting WHERE query execution\n");
+    printf("EXECUTOR: Starting WHERE query execution (%d predicates)\n", predicate_count);
     fflush(stdout);
     
-    // Get all records first
-    QueryResult temp_result;
-    memset(&temp_result, 0, sizeof(temp_result));
-    printf("EXECUTOR: About to scan table '%s'\n", table_name);
-    fflush(stdout);
-    
-    int ret = scan_table(table_name, &temp_result, txn_id);
-    printf("EXECUTOR: scan_table returned %d\n", ret);
-    fflush(stdout);
-    
-    if (ret < 0) {
-        printf("EXECUTOR: Table scan failed\n");
-        result->column_count = 1;
-        strcpy(result->columns[0].name, "Error");
-        result->columns[0].type = TYPE_VARCHAR;
-        result->row_count = 1;
-        strcpy(result->data[0][0].string_val, "Failed to scan table");
-        return -1;
+    IndexScanContext ctx;
+    if (!bind_select(table, select_all, columns, column_count, predicates, predicate_count, txn_id, &ctx, result)) {
+        return 0;
     }
     
-    printf("EXECUTOR: Table scan completed, %d rows found\n", temp_result.row_count);
-    fflush(stdout);
+    // Choose access path: best key prefix match, then covering, then in-memory ART on ties
+    Index indexes[MAX_TABLE_INDEXES];
+    int index_count = get_table_indexes(table->table_id, indexes, MAX_TABLE_INDEXES);
+    IndexPlan best, candidate;
+    bool have_plan = false;
     
-    // Find WHERE column index
-    int where_col_idx = -1;
-    printf("EXECUTOR: Looking for column '%s' in %d columns\n", where_column, temp_result.column_count);
-    fflush(stdout);
+    for (int i = 0; i < index_count; i++) {
+        if (indexes[i].type != INDEX_BTREE && indexes[i].type != INDEX_ART) continue;
+        
+        plan_index(&indexes[i], &ctx, &candidate);
+        if (plan_score(&candidate) == 0 && !candidate.covers) continue;
+        
+        if (!have_plan || plan_score(&candidate) > plan_score(&best) ||
+            (plan_score(&candidate) == plan_score(&best) && candidate.covers && !best.covers) ||
+            (plan_score(&candidate) == plan_score(&best) && candidate.covers == best.covers &&
+             indexes[i].type == INDEX_ART && best.index->type != INDEX_ART)) {
+            best = candidate;
+            best.low.values = best.low_values;
+            best.high.values = best.high_values;
+            have_plan = true;
+        }
+    }
     
-    for (int i = 0; i < temp_result.column_count; i++) {
-        printf("EXECUTOR: Checking column %d: '%s'\n", i, temp_result.columns[i].name);
-        fflush(stdout);
-        if (strcasecmp(temp_result.columns[i].name, where_column) == 0) {
-            where_col_idx = i;
-            printf("EXECUTOR: Found WHERE column at index %d\n", where_col_idx);
-            fflush(stdout);
-            break;
+    if (have_plan) {
+        const Index* index = best.index;
+        int visited;
+        
+        if (best.covers) {
+            for (int col = 0; col < ctx.projection_count; col++) {
+                ctx.sources[col] = index_column_source(index, table->columns[ctx.projection[col]].name);
+            }
+            for (int p = 0; p < ctx.predicate_count; p++) {
+                ctx.predicate_sources[p] = index_column_source(index, table->columns[ctx.predicates[p].column].name);
+            }
+            if (plan_score(&best) > 0) {
+                printf("OPTIMIZER: ✅ CHOSE Index-only scan on '%s' (key range, %d equality + %s)\n",
+                       index->name, best.eq_count, best.has_range ? "range" : "no range");
+            } else {
+                printf("OPTIMIZER: ✅ CHOSE Index-only scan on '%s' (leaf scan with filter)\n", index->name);
+            }
+            visited = scan_index(index, table, &best.low, &best.high, index_only_visitor, &ctx, txn_id);
+        } else {
+            printf("OPTIMIZER: ✅ CHOSE %s index scan on '%s' (%d equality + %s)\n",
+                   index->type == INDEX_ART ? "ART" : "B-Tree",
+                   index->name, best.eq_count, best.has_range ? "range" : "no range");
+            visited = scan_index(index, table, &best.low, &best.high, index_fetch_visitor, &ctx, txn_id);
         }
+        
+        if (visited >= 0) {
+            printf("EXECUTOR: 🏁 Index scan completed - %d entries visited, %d rows returned\n",
+                   visited, result->row_count);
+            return 0;
+        }
+        printf("EXECUTOR: Index scan failed, falling back to table scan\n");
+        result->row_count = 0;
     }
     
-    if (where_col_idx == -1) {
+    printf("OPTIMIZER: ⚠️ CHOSE table scan (no usable index on '%s')\n", table->name);
+    
+    QueryResult* temp_result = malloc(sizeof(QueryResult));
+    if (!temp_result) return -1;
+    memset(temp_result, 0, sizeof(QueryResult));
+    
+    int ret = scan_table_where(table_name, ctx.predicates, ctx.predicate_count, temp_result, txn_id);
+    if (ret < 0) {
+        free(temp_result);
         result->column_count = 1;
         strcpy(result->columns[0].name, "Error");
         result->columns[0].type = TYPE_VARCHAR;
         result->row_count = 1;
-        strcpy(result->data[0][0].string_val, "Column does not exist");
+        strcpy(result->data[0][0].string_val, "Failed to scan table");
         return -1;
     }
     
-    // Copy column definitions
-    result->column_count = temp_result.column_count;
-    for (int i = 0; i < temp_result.column_count; i++) {
-        result->columns[i] = temp_result.columns[i];
-    }
-    
-    // Filter rows based on WHERE clause
-    printf("EXECUTOR: 🔍 Filtering %d rows where %s = '%s'\n", temp_result.row_count, where_column, where_value);
-    result->row_count = 0;
-    int matches_found = 0;
-    
-    for (int row = 0; row < temp_result.row_count && result->row_count < MAX_RESULT_ROWS; row++) {
-        bool match = false;
-        
-        if (temp_result.columns[where_col_idx].type == TYPE_INT) {
-            int where_int = atoi(where_value);
-            if (temp_result.data[row][where_col_idx].int_val == where_int) {
-                match = true;
-                matches_found++;
-                printf("EXECUTOR: ✅ Match found - Row %d: %d = %d\n", row, temp_result.data[row][where_col_idx].int_val, where_int);
-            }
-        } else if (temp_result.columns[where_col_idx].type == TYPE_VARCHAR) {
-            if (strcmp(temp_result.data[row][where_col_idx].string_val, where_value) == 0) {
-                match = true;
-                matches_found++;
-                printf("EXECUTOR: ✅ Match found - Row %d: '%s' = '%s'\n", row, temp_result.data[row][where_col_idx].string_val, where_value);
-            }
-        }
-        
-        if (match) {
-            for (int col = 0; col < temp_result.column_count; col++) {
-                result->data[result->row_count][col] = temp_result.data[row][col];
-            }
-            result->row_count++;
-        }
+    // Rows were filtered by the scan (with zone map page skipping)
+    for (int row = 0; row < temp_result->row_count; row++) {
+        project_row(&ctx, temp_result->data[row]);
     }
     
-    printf("EXECUTOR: 🏁 Query completed - Found %d matching rows out of %d total\n", matches_found, temp_result.row_count);
+    printf("EXECUTOR: 🏁 Query completed - Found %d matching rows\n", result->row_count);
+    free(temp_result);
     return 0;
 }
 
@@ -398,8 +756,9 @@ int execute_select(const char* table_name, bool select_all, char columns[][MAX_N
         return -1;
     }
     
-    // Acquire read lock for read committed isolation
-    acquire_read_lock(txn_id, table->table_id);
+    // MVCC reads from a snapshot: the intention lock only keeps DDL out
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IS);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     printf("EXECUTOR: execute_select called with select_all=%s, column_count=%d\n", 
            select_all ? "true" : "false", column_count);
@@ -445,9 +804,68 @@ int execute_select(const char* table_name, bool select_all, char columns[][MAX_N
     }
 }
 
-int execute_create_index(const char* index_name, const char* table_name, const char* column_name, 
+/*
+ * SELECT ... FOR UPDATE [NOWAIT | SKIP LOCKED] [LIMIT n]: X-lock the
+ * matching rows as UPDATE would, without changing them, and return them.
+ * Always a table scan, so each row is locked where it lies, on its latest
+ * committed version (not the snapshot's). The locks last until the
+ * transaction ends: outside BEGIN ... COMMIT that is the end of the
+ * statement. With SKIP LOCKED and LIMIT, concurrent queue consumers each
+ * claim different rows instead of waiting for one another.
+ */
+int execute_select_for_update(const char* table_name, bool select_all, char columns[][MAX_NAME_LEN], int column_count,
+                              Predicate* predicates, int predicate_count, RowLockPolicy policy, int limit,
+                              uint32_t txn_id, QueryResult* result) {
+    extern int lock_rows_where(const char* table_name, const BoundPredicate* predicates, int predicate_count,
+                               RowLockPolicy policy, int limit, QueryResult* result, uint32_t txn_id);
+    Table* table = find_table_by_name(table_name);
+    if (!table) {
+        result->column_count = 1;
+        strcpy(result->columns[0].name, "Error");
+        result->columns[0].type = TYPE_VARCHAR;
+        result->row_count = 1;
+        strcpy(result->data[0][0].string_val, "Table does not exist");
+        return -1;
+    }
+    
+    int lock = acquire_table_lock(txn_id, table->table_id, LOCK_IX);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
+    
+    IndexScanContext ctx;
+    if (!bind_select(table, select_all, columns, column_count, predicates, predicate_count, txn_id, &ctx, result)) {
+        return 0;
+    }
+    
+    QueryResult* temp_result = malloc(sizeof(QueryResult));
+    if (!temp_result) return -1;
+    memset(temp_result, 0, sizeof(QueryResult));
+    
+    int ret = lock_rows_where(table_name, ctx.predicates, ctx.predicate_count, policy, limit, temp_result, txn_id);
+    if (ret < 0) {
+        free(temp_result);
+        if (concurrency_failure(ret) || ret == LOCK_NOT_AVAILABLE) return concurrency_error(result, ret, txn_id);
+        result->column_count = 1;
+        strcpy(result->columns[0].name, "Error");
+        result->columns[0].type = TYPE_VARCHAR;
+        result->row_count = 1;
+        strcpy(result->data[0][0].string_val, "Failed to lock rows");
+        return -1;
+    }
+    
+    for (int row = 0; row < temp_result->row_count; row++) {
+        project_row(&ctx, temp_result->data[row]);
+    }
+    printf("EXECUTOR: FOR UPDATE locked %d rows\n", result->row_count);
+    free(temp_result);
+    return 0;
+}
+
+int execute_create_index(const char* index_name, const char* table_name,
+                        char key_columns[][MAX_NAME_LEN], int key_count,
+                        char include_columns[][MAX_NAME_LEN], int include_count,
                         int index_type, uint32_t txn_id, QueryResult* result) {
-    acquire_write_lock(txn_id, 1); // System catalog lock
+    int lock = acquire_write_lock(txn_id, 1); // System catalog lock
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Log DDL operation to WAL
     extern uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_name);
@@ -456,18 +874,18 @@ int execute_create_index(const char* index_name, const char* table_name, const c
     int ret = -1;
     
     if (index_type == INDEX_BTREE) {
-        ret = create_btree_index(index_name, table_name, column_name, txn_id);
-    } else if (index_type == INDEX_HASH) {
-        ret = create_hash_index(index_name, table_name, column_name, txn_id);
+        ret = create_btree_index(index_name, table_name, key_columns, key_count,
+                                 include_columns, include_count, txn_id);
+    } else if (index_type == INDEX_ART) {
+        ret = create_art_index(index_name, table_name, key_columns, key_count,
+                               include_columns, include_count, txn_id);
+    } else if (index_type == INDEX_HASH && key_count == 1 && include_count == 0) {
+        ret = create_hash_index(index_name, table_name, key_columns[0], txn_id);
     }
     
     // Auto-commit DDL operation
     if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DDL: CREATE INDEX auto-committed and flushed\n");
+        auto_commit_ddl(txn_id, "CREATE INDEX");
     }
     
     result->column_count = 1;
@@ -485,7 +903,8 @@ int execute_create_index(const char* index_name, const char* table_name, const c
 }
 
 int execute_drop_index(const char* index_name, uint32_t txn_id, QueryResult* result) {
-    acquire_write_lock(txn_id, 1);
+    int lock = acquire_write_lock(txn_id, 1);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     // Log DDL operation to WAL
     extern uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_name);
@@ -495,11 +914,7 @@ int execute_drop_index(const char* index_name, uint32_t txn_id, QueryResult* res
     
     // Auto-commit DDL operation
     if (ret >= 0) {
-        extern uint64_t wal_log_commit(uint32_t txn_id);
-        extern void flush_wal();
-        wal_log_commit(txn_id);
-        flush_wal();
-        printf("DDL: DROP INDEX auto-committed and flushed\n");
+        auto_commit_ddl(txn_id, "DROP INDEX");
     }
     
     result->column_count = 1;
@@ -527,7 +942,8 @@ int execute_describe(const char* table_name, uint32_t txn_id, QueryResult* resul
         return -1;
     }
     
-    acquire_read_lock(txn_id, 1); // System catalog read lock
+    int lock = acquire_read_lock(txn_id, 1); // System catalog read lock
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     result->column_count = 4;
     strcpy(result->columns[0].name, "Column");
@@ -552,7 +968,8 @@ int execute_describe(const char* table_name, uint32_t txn_id, QueryResult* resul
 }
 
 int execute_show_tables(uint32_t txn_id, QueryResult* result) {
-    acquire_read_lock(txn_id, 1);
+    int lock = acquire_read_lock(txn_id, 1);
+    if (lock != 0) return concurrency_error(result, lock, txn_id);
     
     result->column_count = 1;
     strcpy(result->columns[0].name, "Tables");
@@ -573,4 +990,37 @@ int execute_show_tables(uint32_t txn_id, QueryResult* result) {
     }
     
     return 0;
-}
\ No newline at end of file
+}
+/*
+ * SHOW CONCURRENCY: commits and conflict aborts per concurrency control
+ * mode since startup. AbortRate is conflicts per attempted writing
+ * transaction, in percent; OCC pays off while it stays low.
+ */
+int execute_show_concurrency(uint32_t txn_id, QueryResult* result) {
+    extern void transaction_concurrency_stats(ConcurrencyControl mode, ConcurrencyStats* stats);
+    static const char* columns[] = { "Mode", "Commits", "Conflicts", "Validation", "Retries", "AbortRate" };
+    (void)txn_id;
+    
+    result->column_count = 6;
+    for (int i = 0; i < result->column_count; i++) {
+        strcpy(result->columns[i].name, columns[i]);
+        result->columns[i].type = TYPE_BIGINT;
+    }
+    result->columns[0].type = TYPE_VARCHAR;
+    result->columns[5].type = TYPE_FLOAT;
+    
+    for (int mode = 0; mode < CC_MODE_COUNT; mode++) {
+        ConcurrencyStats stats;
+        transaction_concurrency_stats((ConcurrencyControl)mode, &stats);
+        Value* row = result->data[mode];
+        strcpy(row[0].string_val, mode == CC_OPTIMISTIC ? "occ" : "2pl");
+        row[1].bigint_val = (int64_t)stats.commits;
+        row[2].bigint_val = (int64_t)stats.conflicts;
+        row[3].bigint_val = (int64_t)stats.validation_failures;
+        row[4].bigint_val = (int64_t)stats.retries;
+        uint64_t attempts = stats.commits + stats.conflicts;
+        row[5].float_val = attempts ? 100.0f * stats.conflicts / attempts : 0.0f;
+    }
+    result->row_count = CC_MODE_COUNT;
+    return 0;
+}
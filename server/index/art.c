@@ -0,0 +1,840 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include "../../common/types.h"
+
+/**
+ * MiniDB Adaptive Radix Tree (ART) Index
+ * ======================================
+ *
+ * An in-memory index for small, hot lookup tables. Nothing is stored in
+ * pages: the tree is built from the heap at startup (after crash recovery)
+ * and kept current by INSERT/UPDATE/DELETE, so it needs no WAL.
+ *
+ * TREE KEY:
+ *   [ENCODED KEY COLUMNS][RECORD_ID (page_id, slot)]
+ * - Key columns use the order-preserving encoding from key_codec.c, so
+ *   byte order is key order. Appending the record id makes duplicate keys
+ *   unique and keeps every tree key prefix-free.
+ *
+ * NODES (chosen by fan-out, grown and shrunk as children come and go):
+ *   NODE4    up to 4 children,   sorted key bytes
+ *   NODE16   up to 16 children,  sorted key bytes
+ *   NODE48   up to 48 children,  256-entry byte -> slot map
+ *   NODE256  up to 256 children, indexed directly by key byte
+ * - Path compression: a node stores the bytes shared by its whole subtree.
+ *   Up to ART_MAX_PREFIX bytes are kept inline; longer prefixes are read
+ *   back from the subtree's minimum leaf.
+ * - Leaves are tagged pointers (low bit set) to the full tree key plus the
+ *   encoded INCLUDE columns, so covering queries read their values from the
+ *   leaf and go to the heap only to check the row version's visibility.
+ *
+ * SCANS:
+ * - art_scan() has the same contract as btree_scan(): key-prefix bounds and
+ *   a visitor called in key order. Subtrees whose path is already outside a
+ *   bound are pruned; a point lookup follows a single path.
+ *
+ * CONCURRENCY:
+ * - Trees are private to the server process and guarded by a per-index
+ *   mutex.
+ * - Inserts take the mutex while holding a heap page latch, so nothing
+ *   that latches pages runs under it: art_scan() copies the matching
+ *   leaves under the mutex and calls the visitor after releasing it.
+ */
+
+extern int key_encode_value(DataType type, const Value* value, uint8_t* out);
+extern int key_encode_values(const DataType* types, const Value* values, int count, uint8_t* out);
+extern int key_decode_values(const DataType* types, const uint8_t* in, int count, Value* values);
+
+#define ART_MAX_PREFIX 10
+#define ART_MAX_INDEXES 100
+#define ART_RID_BYTES 8
+#define ART_MAX_KEY_BYTES (MAX_INDEX_COLUMNS * MAX_STRING_LEN + ART_RID_BYTES)
+
+#define ART_IS_LEAF(p) (((uintptr_t)(p)) & 1)
+#define ART_LEAF(p) ((ArtLeaf*)(((uintptr_t)(p)) & ~(uintptr_t)1))
+#define ART_TAG_LEAF(l) ((void*)(((uintptr_t)(l)) | 1))
+
+enum { ART_NODE4 = 1, ART_NODE16, ART_NODE48, ART_NODE256 };
+enum { ART_CONTINUE, ART_STOP, ART_SKIP };
+
+typedef struct {
+    uint8_t type;
+    uint16_t num_children;
+    uint32_t prefix_len;
+    uint8_t prefix[ART_MAX_PREFIX];
+} ArtNode;
+
+typedef struct {
+    ArtNode n;
+    uint8_t keys[4];
+    void* children[4];
+} ArtNode4;
+
+typedef struct {
+    ArtNode n;
+    uint8_t keys[16];
+    void* children[16];
+} ArtNode16;
+
+typedef struct {
+    ArtNode n;
+    uint8_t child_index[256];   // Slot + 1 per key byte, 0 = no child
+    void* children[48];
+} ArtNode48;
+
+typedef struct {
+    ArtNode n;
+    void* children[256];
+} ArtNode256;
+
+typedef struct {
+    RecordId rid;
+    uint16_t key_len;           // Tree key bytes (key columns + record id)
+    uint16_t rest_len;          // Encoded INCLUDE columns
+    uint8_t data[];             // Tree key, then INCLUDE columns
+} ArtLeaf;
+
+typedef struct {
+    bool in_use;
+    int index_id;
+    void* root;
+    int entries;
+    pthread_mutex_t mutex;
+} ArtTree;
+
+// Per-index layout derived from the catalog definition
+typedef struct {
+    int key_count;
+    int key_column[MAX_INDEX_COLUMNS];
+    DataType key_type[MAX_INDEX_COLUMNS];
+    int include_count;
+    int include_column[MAX_INDEX_COLUMNS];
+    DataType include_type[MAX_INDEX_COLUMNS];
+} ArtDesc;
+
+typedef int (*ArtVisitor)(const Value* entry_values, RecordId rid, void* ctx);
+
+static ArtTree art_trees[ART_MAX_INDEXES];
+static pthread_mutex_t art_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int find_column(const Table* table, const char* name) {
+    for (int i = 0; i < table->column_count; i++) {
+        if (strcasecmp(table->columns[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int art_describe(const Index* index, const Table* table, ArtDesc* desc) {
+    memset(desc, 0, sizeof(ArtDesc));
+    desc->key_count = index->key_count;
+    desc->include_count = index->include_count;
+    if (desc->key_count <= 0 || desc->key_count > MAX_INDEX_COLUMNS) return -1;
+
+    for (int i = 0; i < index->key_count; i++) {
+        desc->key_column[i] = find_column(table, index->key_columns[i]);
+        if (desc->key_column[i] < 0) return -1;
+        desc->key_type[i] = table->columns[desc->key_column[i]].type;
+    }
+    for (int i = 0; i < index->include_count; i++) {
+        desc->include_column[i] = find_column(table, index->include_columns[i]);
+        if (desc->include_column[i] < 0) return -1;
+        desc->include_type[i] = table->columns[desc->include_column[i]].type;
+    }
+    return 0;
+}
+
+static ArtTree* find_tree(int index_id) {
+    for (int i = 0; i < ART_MAX_INDEXES; i++) {
+        if (art_trees[i].in_use && art_trees[i].index_id == index_id) return &art_trees[i];
+    }
+    return NULL;
+}
+
+/* ---------------- Nodes ---------------- */
+
+static ArtNode* alloc_node(uint8_t type) {
+    size_t size;
+    switch (type) {
+        case ART_NODE4: size = sizeof(ArtNode4); break;
+        case ART_NODE16: size = sizeof(ArtNode16); break;
+        case ART_NODE48: size = sizeof(ArtNode48); break;
+        default: size = sizeof(ArtNode256); break;
+    }
+    ArtNode* node = calloc(1, size);
+    if (node) node->type = type;
+    return node;
+}
+
+static void free_subtree(void* node) {
+    if (!node) return;
+    if (ART_IS_LEAF(node)) {
+        free(ART_LEAF(node));
+        return;
+    }
+    ArtNode* n = node;
+    switch (n->type) {
+        case ART_NODE4:
+            for (int i = 0; i < n->num_children; i++) free_subtree(((ArtNode4*)n)->children[i]);
+            break;
+        case ART_NODE16:
+            for (int i = 0; i < n->num_children; i++) free_subtree(((ArtNode16*)n)->children[i]);
+            break;
+        case ART_NODE48:
+            for (int i = 0; i < 48; i++) free_subtree(((ArtNode48*)n)->children[i]);
+            break;
+        case ART_NODE256:
+            for (int i = 0; i < 256; i++) free_subtree(((ArtNode256*)n)->children[i]);
+            break;
+    }
+    free(n);
+}
+
+static void copy_header(ArtNode* dst, const ArtNode* src) {
+    dst->num_children = src->num_children;
+    dst->prefix_len = src->prefix_len;
+    memcpy(dst->prefix, src->prefix, ART_MAX_PREFIX);
+}
+
+static void** find_child(ArtNode* n, uint8_t byte) {
+    switch (n->type) {
+        case ART_NODE4: {
+            ArtNode4* n4 = (ArtNode4*)n;
+            for (int i = 0; i < n->num_children; i++) {
+                if (n4->keys[i] == byte) return &n4->children[i];
+            }
+            return NULL;
+        }
+        case ART_NODE16: {
+            ArtNode16* n16 = (ArtNode16*)n;
+            for (int i = 0; i < n->num_children; i++) {
+                if (n16->keys[i] == byte) return &n16->children[i];
+            }
+            return NULL;
+        }
+        case ART_NODE48: {
+            ArtNode48* n48 = (ArtNode48*)n;
+            return n48->child_index[byte] ? &n48->children[n48->child_index[byte] - 1] : NULL;
+        }
+        default: {
+            ArtNode256* n256 = (ArtNode256*)n;
+            return n256->children[byte] ? &n256->children[byte] : NULL;
+        }
+    }
+}
+
+// Leftmost leaf of a subtree
+static ArtLeaf* minimum(const void* node) {
+    while (node && !ART_IS_LEAF(node)) {
+        const ArtNode* n = node;
+        switch (n->type) {
+            case ART_NODE4:
+                node = ((const ArtNode4*)n)->children[0];
+                break;
+            case ART_NODE16:
+                node = ((const ArtNode16*)n)->children[0];
+                break;
+            case ART_NODE48: {
+                const ArtNode48* n48 = (const ArtNode48*)n;
+                int c = 0;
+                while (!n48->child_index[c]) c++;
+                node = n48->children[n48->child_index[c] - 1];
+                break;
+            }
+            default: {
+                const ArtNode256* n256 = (const ArtNode256*)n;
+                int c = 0;
+                while (!n256->children[c]) c++;
+                node = n256->children[c];
+                break;
+            }
+        }
+    }
+    return node ? ART_LEAF(node) : NULL;
+}
+
+// Insert into sorted key/child arrays of a Node4 or Node16 with room
+static void insert_sorted(uint8_t* keys, void** children, int count, uint8_t byte, void* child) {
+    int pos = 0;
+    while (pos < count && keys[pos] < byte) pos++;
+    memmove(keys + pos + 1, keys + pos, count - pos);
+    memmove(children + pos + 1, children + pos, (count - pos) * sizeof(void*));
+    keys[pos] = byte;
+    children[pos] = child;
+}
+
+// Add a child under a new key byte, growing the node (and updating *ref) when full
+static int add_child(ArtNode* n, void** ref, uint8_t byte, void* child) {
+    switch (n->type) {
+        case ART_NODE4: {
+            ArtNode4* n4 = (ArtNode4*)n;
+            if (n->num_children < 4) {
+                insert_sorted(n4->keys, n4->children, n->num_children, byte, child);
+                n->num_children++;
+                return 0;
+            }
+            ArtNode16* grown = (ArtNode16*)alloc_node(ART_NODE16);
+            if (!grown) return -1;
+            copy_header(&grown->n, n);
+            memcpy(grown->keys, n4->keys, 4);
+            memcpy(grown->children, n4->children, 4 * sizeof(void*));
+            *ref = grown;
+            free(n4);
+            return add_child(&grown->n, ref, byte, child);
+        }
+        case ART_NODE16: {
+            ArtNode16* n16 = (ArtNode16*)n;
+            if (n->num_children < 16) {
+                insert_sorted(n16->keys, n16->children, n->num_children, byte, child);
+                n->num_children++;
+                return 0;
+            }
+            ArtNode48* grown = (ArtNode48*)alloc_node(ART_NODE48);
+            if (!grown) return -1;
+            copy_header(&grown->n, n);
+            for (int i = 0; i < 16; i++) {
+                grown->children[i] = n16->children[i];
+                grown->child_index[n16->keys[i]] = i + 1;
+            }
+            *ref = grown;
+            free(n16);
+            return add_child(&grown->n, ref, byte, child);
+        }
+        case ART_NODE48: {
+            ArtNode48* n48 = (ArtNode48*)n;
+            if (n->num_children < 48) {
+                int slot = 0;
+                while (n48->children[slot]) slot++;
+                n48->children[slot] = child;
+                n48->child_index[byte] = slot + 1;
+                n->num_children++;
+                return 0;
+            }
+            ArtNode256* grown = (ArtNode256*)alloc_node(ART_NODE256);
+            if (!grown) return -1;
+            copy_header(&grown->n, n);
+            for (int c = 0; c < 256; c++) {
+                if (n48->child_index[c]) grown->children[c] = n48->children[n48->child_index[c] - 1];
+            }
+            *ref = grown;
+            free(n48);
+            return add_child(&grown->n, ref, byte, child);
+        }
+        default: {
+            ArtNode256* n256 = (ArtNode256*)n;
+            n256->children[byte] = child;
+            n->num_children++;
+            return 0;
+        }
+    }
+}
+
+// Remove the child at *slot, shrinking the node (and updating *ref) when sparse
+static void remove_child(ArtNode* n, void** ref, uint8_t byte, void** slot) {
+    switch (n->type) {
+        case ART_NODE256: {
+            ArtNode256* n256 = (ArtNode256*)n;
+            n256->children[byte] = NULL;
+            if (--n->num_children > 37) return;
+
+            ArtNode48* shrunk = (ArtNode48*)alloc_node(ART_NODE48);
+            if (!shrunk) return;   // Keep the sparse node
+            copy_header(&shrunk->n, n);
+            int pos = 0;
+            for (int c = 0; c < 256; c++) {
+                if (n256->children[c]) {
+                    shrunk->children[pos] = n256->children[c];
+                    shrunk->child_index[c] = ++pos;
+                }
+            }
+            *ref = shrunk;
+            free(n256);
+            return;
+        }
+        case ART_NODE48: {
+            ArtNode48* n48 = (ArtNode48*)n;
+            n48->children[n48->child_index[byte] - 1] = NULL;
+            n48->child_index[byte] = 0;
+            if (--n->num_children > 12) return;
+
+            ArtNode16* shrunk = (ArtNode16*)alloc_node(ART_NODE16);
+            if (!shrunk) return;
+            copy_header(&shrunk->n, n);
+            int pos = 0;
+            for (int c = 0; c < 256; c++) {
+                if (n48->child_index[c]) {
+                    shrunk->keys[pos] = c;
+                    shrunk->children[pos++] = n48->children[n48->child_index[c] - 1];
+                }
+            }
+            *ref = shrunk;
+            free(n48);
+            return;
+        }
+        case ART_NODE16: {
+            ArtNode16* n16 = (ArtNode16*)n;
+            int pos = slot - n16->children;
+            memmove(n16->keys + pos, n16->keys + pos + 1, n->num_children - 1 - pos);
+            memmove(n16->children + pos, n16->children + pos + 1, (n->num_children - 1 - pos) * sizeof(void*));
+            if (--n->num_children > 3) return;
+
+            ArtNode4* shrunk = (ArtNode4*)alloc_node(ART_NODE4);
+            if (!shrunk) return;
+            copy_header(&shrunk->n, n);
+            memcpy(shrunk->keys, n16->keys, n->num_children);
+            memcpy(shrunk->children, n16->children, n->num_children * sizeof(void*));
+            *ref = shrunk;
+            free(n16);
+            return;
+        }
+        default: {
+            ArtNode4* n4 = (ArtNode4*)n;
+            int pos = slot - n4->children;
+            memmove(n4->keys + pos, n4->keys + pos + 1, n->num_children - 1 - pos);
+            memmove(n4->children + pos, n4->children + pos + 1, (n->num_children - 1 - pos) * sizeof(void*));
+            if (--n->num_children > 1) return;
+
+            // One child left: merge this node's path into it
+            void* child = n4->children[0];
+            if (!ART_IS_LEAF(child)) {
+                ArtNode* c = child;
+                uint32_t prefix = n->prefix_len;
+                if (prefix < ART_MAX_PREFIX) {
+                    n->prefix[prefix++] = n4->keys[0];
+                }
+                if (prefix < ART_MAX_PREFIX) {
+                    uint32_t take = c->prefix_len < ART_MAX_PREFIX - prefix ? c->prefix_len : ART_MAX_PREFIX - prefix;
+                    memcpy(n->prefix + prefix, c->prefix, take);
+                    prefix += take;
+                }
+                memcpy(c->prefix, n->prefix, prefix < ART_MAX_PREFIX ? prefix : ART_MAX_PREFIX);
+                c->prefix_len += n->prefix_len + 1;
+            }
+            *ref = child;
+            free(n4);
+            return;
+        }
+    }
+}
+
+// Number of leading prefix bytes of n that match key at depth
+static uint32_t prefix_mismatch(const ArtNode* n, const uint8_t* key, int key_len, int depth) {
+    uint32_t inline_len = n->prefix_len < ART_MAX_PREFIX ? n->prefix_len : ART_MAX_PREFIX;
+    uint32_t max = (uint32_t)(key_len - depth) < inline_len ? (uint32_t)(key_len - depth) : inline_len;
+    uint32_t i = 0;
+    for (; i < max; i++) {
+        if (n->prefix[i] != key[depth + i]) return i;
+    }
+    if (n->prefix_len > ART_MAX_PREFIX) {
+        // The rest of the prefix lives in every leaf below; use the minimum
+        const ArtLeaf* leaf = minimum(n);
+        uint32_t limit = n->prefix_len;
+        if ((uint32_t)(leaf->key_len - depth) < limit) limit = leaf->key_len - depth;
+        if ((uint32_t)(key_len - depth) < limit) limit = key_len - depth;
+        for (; i < limit; i++) {
+            if (leaf->data[depth + i] != key[depth + i]) return i;
+        }
+    }
+    return i;
+}
+
+static bool leaf_matches(const ArtLeaf* leaf, const uint8_t* key, int key_len) {
+    return leaf->key_len == key_len && memcmp(leaf->data, key, key_len) == 0;
+}
+
+/* ---------------- Insert and delete ---------------- */
+
+static int insert_rec(void** ref, const uint8_t* key, int key_len, int depth, ArtLeaf* leaf) {
+    void* node = *ref;
+    if (!node) {
+        *ref = ART_TAG_LEAF(leaf);
+        return 0;
+    }
+
+    if (ART_IS_LEAF(node)) {
+        ArtLeaf* existing = ART_LEAF(node);
+        if (leaf_matches(existing, key, key_len)) return -1;   // Entry already indexed
+
+        // Split the leaf: a Node4 holding the shared path and both leaves
+        int lcp = 0;
+        int max = (existing->key_len < key_len ? existing->key_len : key_len) - depth;
+        while (lcp < max && existing->data[depth + lcp] == key[depth + lcp]) lcp++;
+        if (lcp == max) return -1;   // Tree keys are prefix-free
+
+        ArtNode4* n4 = (ArtNode4*)alloc_node(ART_NODE4);
+        if (!n4) return -1;
+        n4->n.prefix_len = lcp;
+        memcpy(n4->n.prefix, key + depth, lcp < ART_MAX_PREFIX ? lcp : ART_MAX_PREFIX);
+        add_child(&n4->n, NULL, existing->data[depth + lcp], node);
+        add_child(&n4->n, NULL, key[depth + lcp], ART_TAG_LEAF(leaf));
+        *ref = n4;
+        return 0;
+    }
+
+    ArtNode* n = node;
+    if (n->prefix_len) {
+        uint32_t diff = prefix_mismatch(n, key, key_len, depth);
+        if (diff < n->prefix_len) {
+            // The key leaves the compressed path: split it at the mismatch
+            ArtNode4* n4 = (ArtNode4*)alloc_node(ART_NODE4);
+            if (!n4) return -1;
+            n4->n.prefix_len = diff;
+            memcpy(n4->n.prefix, n->prefix, diff < ART_MAX_PREFIX ? diff : ART_MAX_PREFIX);
+
+            if (n->prefix_len <= ART_MAX_PREFIX) {
+                add_child(&n4->n, NULL, n->prefix[diff], n);
+                n->prefix_len -= diff + 1;
+                memmove(n->prefix, n->prefix + diff + 1, n->prefix_len);
+            } else {
+                const ArtLeaf* min_leaf = minimum(n);
+                add_child(&n4->n, NULL, min_leaf->data[depth + diff], n);
+                n->prefix_len -= diff + 1;
+                memcpy(n->prefix, min_leaf->data + depth + diff + 1,
+                       n->prefix_len < ART_MAX_PREFIX ? n->prefix_len : ART_MAX_PREFIX);
+            }
+            add_child(&n4->n, NULL, key[depth + diff], ART_TAG_LEAF(leaf));
+            *ref = n4;
+            return 0;
+        }
+        depth += n->prefix_len;
+    }
+    if (depth >= key_len) return -1;
+
+    void** child = find_child(n, key[depth]);
+    if (child) return insert_rec(child, key, key_len, depth + 1, leaf);
+    return add_child(n, ref, key[depth], ART_TAG_LEAF(leaf));
+}
+
+static ArtLeaf* delete_rec(void** ref, const uint8_t* key, int key_len, int depth) {
+    void* node = *ref;
+    if (!node) return NULL;
+
+    if (ART_IS_LEAF(node)) {
+        ArtLeaf* leaf = ART_LEAF(node);
+        if (!leaf_matches(leaf, key, key_len)) return NULL;
+        *ref = NULL;
+        return leaf;
+    }
+
+    ArtNode* n = node;
+    if (n->prefix_len) {
+        if (prefix_mismatch(n, key, key_len, depth) < n->prefix_len) return NULL;
+        depth += n->prefix_len;
+    }
+    if (depth >= key_len) return NULL;
+
+    void** child = find_child(n, key[depth]);
+    if (!child) return NULL;
+    if (ART_IS_LEAF(*child)) {
+        ArtLeaf* leaf = ART_LEAF(*child);
+        if (!leaf_matches(leaf, key, key_len)) return NULL;
+        remove_child(n, ref, key[depth], child);
+        return leaf;
+    }
+    return delete_rec(child, key, key_len, depth + 1);
+}
+
+/* ---------------- Ordered scan ---------------- */
+
+typedef struct {
+    const ArtDesc* desc;
+    const uint8_t* low;         // Encoded key-prefix bounds (NULL = unbounded)
+    int low_len;
+    bool low_inclusive;
+    const uint8_t* high;
+    int high_len;
+    bool high_inclusive;
+    uint8_t* matches;           // Copies of the matching leaves, in key order
+    size_t match_bytes;
+    size_t match_capacity;
+    bool failed;                // Out of memory while collecting
+} ArtScan;
+
+// Matching leaves are copied at this alignment (ArtLeaf starts with a RecordId)
+#define ART_LEAF_COPY_SIZE(l) \
+    ((sizeof(ArtLeaf) + (l)->key_len + (l)->rest_len + 7) & ~(size_t)7)
+
+/*
+ * Advance the bound state by one path byte at position pos. A "tight" bound
+ * means the path so far equals the bound's prefix. Returns ART_SKIP when the
+ * whole subtree is below the low bound and ART_STOP when it (and everything
+ * after it) is above the high bound.
+ */
+static int step_bounds(const ArtScan* scan, int pos, uint8_t byte, bool* low_tight, bool* high_tight) {
+    if (*low_tight) {
+        if (pos >= scan->low_len) {
+            if (!scan->low_inclusive) return ART_SKIP;   // Starts with an exclusive bound
+            *low_tight = false;
+        } else if (byte < scan->low[pos]) {
+            return ART_SKIP;
+        } else if (byte > scan->low[pos]) {
+            *low_tight = false;
+        }
+    }
+    if (*high_tight) {
+        if (pos >= scan->high_len) {
+            if (!scan->high_inclusive) return ART_STOP;
+            *high_tight = false;
+        } else if (byte > scan->high[pos]) {
+            return ART_STOP;
+        } else if (byte < scan->high[pos]) {
+            *high_tight = false;
+        }
+    }
+    return ART_CONTINUE;
+}
+
+static int visit_leaf(ArtScan* scan, const ArtLeaf* leaf) {
+    int key_len = leaf->key_len - ART_RID_BYTES;
+    int cmp;
+
+    if (scan->low) {
+        cmp = memcmp(leaf->data, scan->low, key_len < scan->low_len ? key_len : scan->low_len);
+        if (cmp < 0 || (cmp == 0 && (key_len < scan->low_len || !scan->low_inclusive))) return ART_CONTINUE;
+    }
+    if (scan->high) {
+        cmp = memcmp(leaf->data, scan->high, key_len < scan->high_len ? key_len : scan->high_len);
+        if (cmp > 0 || (cmp == 0 && key_len >= scan->high_len && !scan->high_inclusive)) return ART_STOP;
+    }
+
+    size_t size = ART_LEAF_COPY_SIZE(leaf);
+    if (scan->match_bytes + size > scan->match_capacity) {
+        size_t capacity = scan->match_capacity ? scan->match_capacity * 2 : 4096;
+        while (capacity < scan->match_bytes + size) capacity *= 2;
+        uint8_t* grown = realloc(scan->matches, capacity);
+        if (!grown) {
+            scan->failed = true;
+            return ART_STOP;
+        }
+        scan->matches = grown;
+        scan->match_capacity = capacity;
+    }
+    memcpy(scan->matches + scan->match_bytes, leaf, sizeof(ArtLeaf) + leaf->key_len + leaf->rest_len);
+    scan->match_bytes += size;
+    return ART_CONTINUE;
+}
+
+static int visit_child(ArtScan* scan, void* child, int depth, uint8_t byte, bool low_tight, bool high_tight);
+
+static int visit_node(ArtScan* scan, void* node, int depth, bool low_tight, bool high_tight) {
+    if (ART_IS_LEAF(node)) return visit_leaf(scan, ART_LEAF(node));
+
+    ArtNode* n = node;
+    if ((low_tight || high_tight) && n->prefix_len) {
+        const ArtLeaf* min_leaf = n->prefix_len > ART_MAX_PREFIX ? minimum(n) : NULL;
+        for (uint32_t i = 0; i < n->prefix_len && (low_tight || high_tight); i++) {
+            uint8_t byte = i < ART_MAX_PREFIX ? n->prefix[i] : min_leaf->data[depth + i];
+            int ret = step_bounds(scan, depth + i, byte, &low_tight, &high_tight);
+            if (ret == ART_SKIP) return ART_CONTINUE;
+            if (ret == ART_STOP) return ART_STOP;
+        }
+    }
+    depth += n->prefix_len;
+
+    // Point and prefix lookups: both bounds pin the same next byte
+    if (low_tight && high_tight && depth < scan->low_len && depth < scan->high_len &&
+        scan->low[depth] == scan->high[depth]) {
+        void** child = find_child(n, scan->low[depth]);
+        if (!child) return ART_CONTINUE;
+        return visit_child(scan, *child, depth, scan->low[depth], low_tight, high_tight);
+    }
+
+    switch (n->type) {
+        case ART_NODE4:
+        case ART_NODE16: {
+            uint8_t* keys = n->type == ART_NODE4 ? ((ArtNode4*)n)->keys : ((ArtNode16*)n)->keys;
+            void** children = n->type == ART_NODE4 ? ((ArtNode4*)n)->children : ((ArtNode16*)n)->children;
+            for (int i = 0; i < n->num_children; i++) {
+                if (visit_child(scan, children[i], depth, keys[i], low_tight, high_tight) == ART_STOP) return ART_STOP;
+            }
+            break;
+        }
+        case ART_NODE48: {
+            ArtNode48* n48 = (ArtNode48*)n;
+            for (int c = 0; c < 256; c++) {
+                if (!n48->child_index[c]) continue;
+                if (visit_child(scan, n48->children[n48->child_index[c] - 1], depth, c,
+                                low_tight, high_tight) == ART_STOP) return ART_STOP;
+            }
+            break;
+        }
+        default: {
+            ArtNode256* n256 = (ArtNode256*)n;
+            for (int c = 0; c < 256; c++) {
+                if (!n256->children[c]) continue;
+                if (visit_child(scan, n256->children[c], depth, c, low_tight, high_tight) == ART_STOP) return ART_STOP;
+            }
+            break;
+        }
+    }
+    return ART_CONTINUE;
+}
+
+static int visit_child(ArtScan* scan, void* child, int depth, uint8_t byte, bool low_tight, bool high_tight) {
+    int ret = step_bounds(scan, depth, byte, &low_tight, &high_tight);
+    if (ret == ART_SKIP) return ART_CONTINUE;
+    if (ret == ART_STOP) return ART_STOP;
+    return visit_node(scan, child, depth + 1, low_tight, high_tight);
+}
+
+/* ---------------- Public API ---------------- */
+
+// Tree key: encoded key columns followed by the record id
+static int build_tree_key(const ArtDesc* desc, const Value* row_values, RecordId rid, uint8_t* key) {
+    Value values[MAX_INDEX_COLUMNS];
+    for (int i = 0; i < desc->key_count; i++) {
+        values[i] = row_values[desc->key_column[i]];
+    }
+    int len = key_encode_values(desc->key_type, values, desc->key_count, key);
+    Value part;
+    part.int_val = rid.page_id;
+    len += key_encode_value(TYPE_INT, &part, key + len);
+    part.int_val = rid.slot;
+    len += key_encode_value(TYPE_INT, &part, key + len);
+    return len;
+}
+
+// Create (or empty) the tree of an ART index before building it from the heap
+int art_reset(const Index* index) {
+    pthread_mutex_lock(&art_registry_mutex);
+    ArtTree* tree = find_tree(index->index_id);
+    if (!tree) {
+        for (int i = 0; i < ART_MAX_INDEXES && !tree; i++) {
+            if (!art_trees[i].in_use) tree = &art_trees[i];
+        }
+        if (tree) {
+            memset(tree, 0, sizeof(ArtTree));
+            pthread_mutex_init(&tree->mutex, NULL);
+            tree->index_id = index->index_id;
+            tree->in_use = true;
+        }
+    }
+    pthread_mutex_unlock(&art_registry_mutex);
+    if (!tree) return -1;
+
+    pthread_mutex_lock(&tree->mutex);
+    free_subtree(tree->root);
+    tree->root = NULL;
+    tree->entries = 0;
+    pthread_mutex_unlock(&tree->mutex);
+    return 0;
+}
+
+void art_drop(int index_id) {
+    pthread_mutex_lock(&art_registry_mutex);
+    ArtTree* tree = find_tree(index_id);
+    if (tree) {
+        free_subtree(tree->root);
+        pthread_mutex_destroy(&tree->mutex);
+        memset(tree, 0, sizeof(ArtTree));
+    }
+    pthread_mutex_unlock(&art_registry_mutex);
+}
+
+int art_insert(const Index* index, const Table* table, const Value* row_values, RecordId rid) {
+    ArtTree* tree = find_tree(index->index_id);
+    ArtDesc desc;
+    if (!tree || art_describe(index, table, &desc) != 0) return -1;
+
+    uint8_t key[ART_MAX_KEY_BYTES];
+    uint8_t rest[MAX_INDEX_COLUMNS * MAX_STRING_LEN];
+    int key_len = build_tree_key(&desc, row_values, rid, key);
+    int rest_len = 0;
+    for (int i = 0; i < desc.include_count; i++) {
+        rest_len += key_encode_value(desc.include_type[i], &row_values[desc.include_column[i]], rest + rest_len);
+    }
+
+    ArtLeaf* leaf = malloc(sizeof(ArtLeaf) + key_len + rest_len);
+    if (!leaf) return -1;
+    leaf->rid = rid;
+    leaf->key_len = key_len;
+    leaf->rest_len = rest_len;
+    memcpy(leaf->data, key, key_len);
+    memcpy(leaf->data + key_len, rest, rest_len);
+
+    pthread_mutex_lock(&tree->mutex);
+    int ret = insert_rec(&tree->root, key, key_len, 0, leaf);
+    if (ret == 0) tree->entries++;
+    pthread_mutex_unlock(&tree->mutex);
+
+    if (ret != 0) free(leaf);
+    return ret;
+}
+
+int art_delete(const Index* index, const Table* table, const Value* row_values, RecordId rid) {
+    ArtTree* tree = find_tree(index->index_id);
+    ArtDesc desc;
+    if (!tree || art_describe(index, table, &desc) != 0) return -1;
+
+    uint8_t key[ART_MAX_KEY_BYTES];
+    int key_len = build_tree_key(&desc, row_values, rid, key);
+
+    pthread_mutex_lock(&tree->mutex);
+    ArtLeaf* leaf = delete_rec(&tree->root, key, key_len, 0);
+    if (leaf) tree->entries--;
+    pthread_mutex_unlock(&tree->mutex);
+
+    if (!leaf) return -1;
+    free(leaf);
+    return 0;
+}
+
+/*
+ * Range scan between two key-prefix bounds, same contract as btree_scan():
+ * a NULL bound (or count 0) is unbounded and entries are visited in key
+ * order. Returns the number of entries visited.
+ */
+int art_scan(const Index* index, const Table* table, const IndexBound* low, const IndexBound* high,
+             ArtVisitor visitor, void* ctx) {
+    ArtTree* tree = find_tree(index->index_id);
+    ArtDesc desc;
+    if (!tree || art_describe(index, table, &desc) != 0) return -1;
+
+    if (low && low->count <= 0) low = NULL;
+    if (high && high->count <= 0) high = NULL;
+    if ((low && low->count > desc.key_count) || (high && high->count > desc.key_count)) return -1;
+
+    uint8_t low_key[MAX_INDEX_COLUMNS * MAX_STRING_LEN];
+    uint8_t high_key[MAX_INDEX_COLUMNS * MAX_STRING_LEN];
+    ArtScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.desc = &desc;
+    if (low) {
+        scan.low_len = key_encode_values(desc.key_type, low->values, low->count, low_key);
+        scan.low = low_key;
+        scan.low_inclusive = low->inclusive;
+    }
+    if (high) {
+        scan.high_len = key_encode_values(desc.key_type, high->values, high->count, high_key);
+        scan.high = high_key;
+        scan.high_inclusive = high->inclusive;
+    }
+
+    // Collect under the mutex, visit after it: visitors latch heap pages,
+    // and writers hold a heap page latch when they insert into the tree
+    pthread_mutex_lock(&tree->mutex);
+    if (tree->root) visit_node(&scan, tree->root, 0, low != NULL, high != NULL);
+    pthread_mutex_unlock(&tree->mutex);
+    if (scan.failed) {
+        free(scan.matches);
+        return -1;
+    }
+
+    int visited = 0;
+    for (size_t pos = 0; pos < scan.match_bytes; ) {
+        const ArtLeaf* leaf = (const ArtLeaf*)(scan.matches + pos);
+        Value entry_values[2 * MAX_INDEX_COLUMNS];
+        key_decode_values(desc.key_type, leaf->data, desc.key_count, entry_values);
+        key_decode_values(desc.include_type, leaf->data + leaf->key_len, desc.include_count,
+                          entry_values + desc.key_count);
+        visited++;
+        if (visitor(entry_values, leaf->rid, ctx) != 0) break;
+        pos += ART_LEAF_COPY_SIZE(leaf);
+    }
+    free(scan.matches);
+    return visited;
+}
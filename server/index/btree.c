@@ -0,0 +1,1130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sched.h>
+#include "../../common/types.h"
+
+/**
+ * MiniDB B+Tree Index
+ * ===================
+ *
+ * NODE LAYOUT (one node per 4KB page, slotted):
+ * +---------+-----------+------------+------------+-----------+-------------+
+ * | IS_LEAF | KEY_COUNT | PREFIX_LEN | HEAP_START | NEXT_LEAF | FIRST_CHILD |
+ * +---------+-----------+------------+------------+-----------+-------------+
+ * |   2B    |    2B     |     2B     |     2B     |    4B     |     4B      |
+ * +--------+------------------+------ free ------+---------------------------+
+ * | PREFIX | SLOT_0 .. SLOT_n |   ->        <-   | ENTRIES (packed from end) |
+ * +--------+------------------+------------------+---------------------------+
+ *
+ * Slot i is the 2-byte body offset of entry i; slots are kept in key order.
+ *
+ * Leaf entry:      [SUFFIX_LEN][KEY SUFFIX][INCLUDE_1 .. INCLUDE_n][RECORD_ID]
+ * Internal entry:  [SUFFIX_LEN][KEY SUFFIX][HAS_RID][RECORD_ID if HAS_RID][CHILD]
+ *
+ * KEY ENCODING:
+ * - Values are stored in their native width using the order-preserving
+ *   encoding in key_codec.c, so encoded keys (including composite keys)
+ *   compare with memcmp().
+ *
+ * COMPRESSION:
+ * - Prefix compression: the longest key prefix shared by every entry in a
+ *   node is stored once (PREFIX) and stripped from each entry. Because
+ *   entries are sorted, that prefix is the common prefix of the first and
+ *   last key.
+ * - Suffix truncation: a separator pushed up by a leaf split is the shortest
+ *   prefix of the right node's first key that still sorts above the left
+ *   node's last key. Only when both keys are equal does the separator carry
+ *   the full key plus record id (HAS_RID).
+ * - An int key costs 14 bytes per leaf entry plus its slot instead of a
+ *   256-byte Value, which raises fanout from ~15 to a few hundred.
+ *
+ * ORDERING:
+ * - Composite keys compare lexicographically: KEY_1 first, then KEY_2 on a
+ *   tie, and so on. Entries are ordered by (key, record id). The record id
+ *   makes every entry unique, so duplicate keys are allowed and a DELETE
+ *   removes exactly the entry belonging to the deleted row.
+ * - Separator i routes entries >= separator i to child i; FIRST_CHILD holds
+ *   everything below separator 1.
+ * - Leaves are chained left to right through NEXT_LEAF for range scans.
+ *
+ * PREFIX SCANS:
+ * - Scan bounds cover a key prefix (IndexBound.count columns), so
+ *   (tenant = X AND ts > Y) becomes one range: low = (X, Y) exclusive,
+ *   high = (X) inclusive.
+ *
+ * COVERING INDEXES:
+ * - INCLUDE columns are stored alongside the key in leaf entries only.
+ * - The executor takes predicates and output values from the leaves
+ *   (index-only scan) when every referenced column is the key or an
+ *   included column. Entries are not versioned, so each matching entry
+ *   still probes its heap row for visibility.
+ *
+ * STRUCTURE MAINTENANCE:
+ * - The root page never moves: a root split copies the old root into a new
+ *   page and turns the root into an internal node, so root_page_id in the
+ *   catalog stays valid for the lifetime of the index.
+ * - Inserts go straight into free space when the key shares the node prefix;
+ *   otherwise (or when deletes left holes) the node is repacked, and split
+ *   by bytes when the repacked node does not fit.
+ * - Nodes are not merged on underflow; deletes only remove the slot.
+ *
+ * CONCURRENCY (optimistic lock coupling):
+ * - Nodes are pinned with pin_page(), which does not take the frame's
+ *   page_mutex. Each frame carries a version word (Page.version); odd means
+ *   write-locked, and every unlock after a modification bumps it.
+ * - Readers never lock. They copy a node, then check that its version did
+ *   not change; on a conflict they restart from the root. Before leaving a
+ *   parent for its child they re-validate the parent, so a child that was
+ *   split in the meantime is never trusted.
+ * - Range scans follow NEXT_LEAF from validated leaf copies and call the
+ *   visitor without holding any latch. Pages are never freed, and a split
+ *   only moves entries to a new right sibling, so the chain stays intact.
+ * - Inserts and deletes descend optimistically and write-lock only the leaf
+ *   (upgrading the version they read). An insert that might split the leaf
+ *   restarts in pessimistic mode: write-lock coupling from the root,
+ *   releasing ancestors as soon as a child is known not to split.
+ *
+ * DURABILITY:
+ * - Index pages are not WAL-logged. Indexes are rebuilt from the heap after
+ *   crash recovery (see rebuild_indexes() in storage.c).
+ */
+
+extern Page* pin_page(int page_id);
+extern void release_page(Page* page);
+extern void mark_dirty(Page* page);
+extern int allocate_page();
+extern int key_max_encoded_size(DataType type);
+extern int key_encode_value(DataType type, const Value* value, uint8_t* out);
+extern int key_encode_values(const DataType* types, const Value* values, int count, uint8_t* out);
+extern int key_decode_values(const DataType* types, const uint8_t* in, int count, Value* values);
+extern int key_encoded_length(const DataType* types, const uint8_t* in, int count);
+
+#define BTREE_BODY_SIZE (PAGE_SIZE - 16)
+#define BTREE_MAX_VALUE_BYTES MAX_STRING_LEN   // Longest encoding: 254 chars + NUL
+#define BTREE_MAX_KEY_BYTES (MAX_INDEX_COLUMNS * BTREE_MAX_VALUE_BYTES)
+#define BTREE_MAX_REST_BYTES (MAX_INDEX_COLUMNS * BTREE_MAX_VALUE_BYTES + (int)sizeof(RecordId) + 1 + (int)sizeof(int))
+#define BTREE_MAX_SLOTS (BTREE_BODY_SIZE / 6)   // Smallest entry: slot + length + 2 bytes
+#define BTREE_MAX_HEIGHT 16
+#define BTREE_SPINS_BEFORE_YIELD 64
+
+typedef struct {
+    uint16_t is_leaf;
+    uint16_t key_count;
+    uint16_t prefix_len;    // Key bytes shared by every entry
+    uint16_t heap_start;    // Body offset of the lowest entry byte
+    int32_t next_leaf;      // Leaves: right sibling (-1 = none)
+    int32_t first_child;    // Internal nodes: child below separator 1
+    uint8_t body[BTREE_BODY_SIZE];
+} BTreeNode;
+
+// Per-index layout derived from the catalog definition
+typedef struct {
+    int root_page_id;
+    int key_count;
+    int key_column[MAX_INDEX_COLUMNS];
+    DataType key_type[MAX_INDEX_COLUMNS];
+    int include_count;
+    int include_column[MAX_INDEX_COLUMNS];
+    DataType include_type[MAX_INDEX_COLUMNS];
+    int max_leaf_entry;     // Worst-case leaf entry size including its slot
+    int max_internal_entry; // Worst-case separator size including its slot
+} BTreeDesc;
+
+// Uncompressed entry: full key bytes plus the bytes following the suffix
+typedef struct {
+    const uint8_t* key;
+    int key_len;
+    const uint8_t* rest;
+    int rest_len;
+} NodeEntry;
+
+// Decompressed copy of a node used for repacking and splitting
+typedef struct {
+    int count;
+    NodeEntry entries[BTREE_MAX_SLOTS + 1];
+    uint8_t* arena;
+    int arena_used;
+} NodeImage;
+
+// Separator produced by a split, to be inserted into the parent
+typedef struct {
+    bool split;
+    uint8_t key[BTREE_MAX_KEY_BYTES];
+    int key_len;
+    bool has_rid;
+    RecordId rid;
+    int right_page_id;
+} BTreeSplit;
+
+/*
+ * Visitor for btree_scan(): entry_values holds the key columns followed by
+ * the INCLUDE columns, in index definition order. Return non-zero to stop.
+ */
+typedef int (*BTreeVisitor)(const Value* entry_values, RecordId rid, void* ctx);
+
+static int find_column(const Table* table, const char* name) {
+    for (int i = 0; i < table->column_count; i++) {
+        if (strcasecmp(table->columns[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int btree_describe(const Index* index, const Table* table, BTreeDesc* desc) {
+    memset(desc, 0, sizeof(BTreeDesc));
+    desc->root_page_id = index->root_page_id;
+    desc->key_count = index->key_count;
+    if (desc->key_count <= 0 || desc->key_count > MAX_INDEX_COLUMNS) return -1;
+
+    int max_key = 0;
+    for (int i = 0; i < index->key_count; i++) {
+        desc->key_column[i] = find_column(table, index->key_columns[i]);
+        if (desc->key_column[i] < 0) return -1;
+        desc->key_type[i] = table->columns[desc->key_column[i]].type;
+        max_key += key_max_encoded_size(desc->key_type[i]);
+    }
+
+    int max_include = 0;
+    desc->include_count = index->include_count;
+    for (int i = 0; i < index->include_count; i++) {
+        desc->include_column[i] = find_column(table, index->include_columns[i]);
+        if (desc->include_column[i] < 0) return -1;
+        desc->include_type[i] = table->columns[desc->include_column[i]].type;
+        max_include += key_max_encoded_size(desc->include_type[i]);
+    }
+
+    desc->max_leaf_entry = 2 * sizeof(uint16_t) + max_key + max_include + sizeof(RecordId);
+    desc->max_internal_entry = 2 * sizeof(uint16_t) + max_key + 1 + sizeof(RecordId) + sizeof(int);
+    return 0;
+}
+
+/* ---------------- Key comparison ---------------- */
+
+static int compare_rids(RecordId a, RecordId b) {
+    if (a.page_id != b.page_id) return a.page_id < b.page_id ? -1 : 1;
+    if (a.slot != b.slot) return a.slot < b.slot ? -1 : 1;
+    return 0;
+}
+
+// Lexicographic byte comparison where a proper prefix sorts first
+static int compare_bytes(const uint8_t* a, int a_len, const uint8_t* b, int b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0) return cmp;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+static int compare_entries(const uint8_t* key_a, int len_a, RecordId rid_a,
+                           const uint8_t* key_b, int len_b, RecordId rid_b) {
+    int cmp = compare_bytes(key_a, len_a, key_b, len_b);
+    return cmp != 0 ? cmp : compare_rids(rid_a, rid_b);
+}
+
+/*
+ * Compare a full entry against a (possibly truncated) separator. An entry
+ * whose key starts with a truncated separator sorts at or above it.
+ */
+static int compare_to_separator(const uint8_t* key, int key_len, RecordId rid,
+                                 const uint8_t* sep, int sep_len, bool sep_has_rid, RecordId sep_rid) {
+    int cmp = memcmp(key, sep, key_len < sep_len ? key_len : sep_len);
+    if (cmp != 0) return cmp;
+    if (key_len < sep_len) return -1;
+    if (key_len > sep_len || !sep_has_rid) return key_len > sep_len ? 1 : 0;
+    return compare_rids(rid, sep_rid);
+}
+
+// Encoded scan bound: the first `count` key columns
+typedef struct {
+    uint8_t key[BTREE_MAX_KEY_BYTES];
+    int key_len;
+    bool inclusive;
+} EncodedBound;
+
+// True if key sorts before every entry admitted by the low bound
+static bool below_low(const uint8_t* key, int key_len, const EncodedBound* low) {
+    int cmp = memcmp(key, low->key, key_len < low->key_len ? key_len : low->key_len);
+    if (cmp != 0) return cmp < 0;
+    if (key_len < low->key_len) return true; // Strictly shorter: sorts before the bound
+    return !low->inclusive;                  // Key starts with the bound
+}
+
+// True if key sorts after every entry admitted by the high bound
+static bool above_high(const uint8_t* key, int key_len, const EncodedBound* high) {
+    int cmp = memcmp(key, high->key, key_len < high->key_len ? key_len : high->key_len);
+    if (cmp != 0) return cmp > 0;
+    if (key_len < high->key_len) return false;
+    return !high->inclusive;
+}
+
+/* ---------------- Node access ---------------- */
+
+static void init_node(BTreeNode* node, bool is_leaf) {
+    memset(node, 0, sizeof(BTreeNode));
+    node->is_leaf = is_leaf ? 1 : 0;
+    node->heap_start = BTREE_BODY_SIZE;
+    node->next_leaf = -1;
+    node->first_child = -1;
+}
+
+static uint16_t slot_offset(const BTreeNode* node, int i) {
+    uint16_t offset;
+    memcpy(&offset, node->body + node->prefix_len + i * sizeof(uint16_t), sizeof(offset));
+    return offset;
+}
+
+static void set_slot_offset(BTreeNode* node, int i, uint16_t offset) {
+    memcpy(node->body + node->prefix_len + i * sizeof(uint16_t), &offset, sizeof(offset));
+}
+
+static int contiguous_free(const BTreeNode* node) {
+    return node->heap_start - (node->prefix_len + node->key_count * (int)sizeof(uint16_t));
+}
+
+// Reassemble the full key of entry i; returns the key length
+static int node_key(const BTreeNode* node, int i, uint8_t* key) {
+    const uint8_t* entry = node->body + slot_offset(node, i);
+    uint16_t suffix_len;
+    memcpy(&suffix_len, entry, sizeof(suffix_len));
+    memcpy(key, node->body, node->prefix_len);
+    memcpy(key + node->prefix_len, entry + sizeof(uint16_t), suffix_len);
+    return node->prefix_len + suffix_len;
+}
+
+// Bytes following the key suffix of entry i
+static const uint8_t* node_rest(const BTreeNode* node, int i) {
+    const uint8_t* entry = node->body + slot_offset(node, i);
+    uint16_t suffix_len;
+    memcpy(&suffix_len, entry, sizeof(suffix_len));
+    return entry + sizeof(uint16_t) + suffix_len;
+}
+
+static int rest_length(const BTreeDesc* desc, const BTreeNode* node, const uint8_t* rest) {
+    if (node->is_leaf) {
+        return key_encoded_length(desc->include_type, rest, desc->include_count) + sizeof(RecordId);
+    }
+    return 1 + (rest[0] ? sizeof(RecordId) : 0) + sizeof(int);
+}
+
+static RecordId leaf_rid(const BTreeDesc* desc, const BTreeNode* node, int i) {
+    const uint8_t* rest = node_rest(node, i);
+    RecordId rid;
+    memcpy(&rid, rest + rest_length(desc, node, rest) - sizeof(RecordId), sizeof(RecordId));
+    return rid;
+}
+
+static void separator_info(const BTreeNode* node, int i, bool* has_rid, RecordId* rid, int* child) {
+    const uint8_t* rest = node_rest(node, i);
+    *has_rid = rest[0] != 0;
+    if (*has_rid) {
+        memcpy(rid, rest + 1, sizeof(RecordId));
+    } else {
+        memset(rid, 0, sizeof(RecordId));
+    }
+    memcpy(child, rest + 1 + (*has_rid ? sizeof(RecordId) : 0), sizeof(int));
+}
+
+// Child i: 0 is FIRST_CHILD, i >= 1 belongs to separator i (entry i - 1)
+static int internal_child(const BTreeNode* node, int i) {
+    if (i == 0) return node->first_child;
+    bool has_rid;
+    RecordId rid;
+    int child;
+    separator_info(node, i - 1, &has_rid, &rid, &child);
+    return child;
+}
+
+/* ---------------- Optimistic latching ---------------- */
+
+static void latch_backoff(int* spins) {
+    if (++*spins >= BTREE_SPINS_BEFORE_YIELD) {
+        sched_yield();
+        *spins = 0;
+    }
+}
+
+// Wait until the node is not write-locked and return its version
+static uint64_t read_lock(Page* page) {
+    uint64_t version;
+    int spins = 0;
+    while ((version = __atomic_load_n(&page->version, __ATOMIC_ACQUIRE)) & 1) {
+        latch_backoff(&spins);
+    }
+    return version;
+}
+
+// True if nothing was written to the node since read_lock() returned version
+static bool validate(Page* page, uint64_t version) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&page->version, __ATOMIC_RELAXED) == version;
+}
+
+// Take the write lock only if the node is still at version
+static bool upgrade_lock(Page* page, uint64_t version) {
+    if (!__atomic_compare_exchange_n(&page->version, &version, version + 1, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);   // Lock visible before any node write
+    return true;
+}
+
+static void write_lock(Page* page) {
+    int spins = 0;
+    while (!upgrade_lock(page, read_lock(page))) {
+        latch_backoff(&spins);
+    }
+}
+
+static void write_unlock(Page* page) {
+    __atomic_add_fetch(&page->version, 1, __ATOMIC_RELEASE);
+}
+
+// Unlock a node that was not modified: readers that saw the old version stay valid
+static void write_unlock_unchanged(Page* page) {
+    __atomic_sub_fetch(&page->version, 1, __ATOMIC_RELEASE);
+}
+
+// Copy a node; false if a writer got in, in which case the copy is garbage
+static bool node_snapshot(Page* page, uint64_t version, BTreeNode* copy) {
+    memcpy(copy, page->data, sizeof(BTreeNode));
+    return validate(page, version);
+}
+
+/* ---------------- Search ---------------- */
+
+// Index of the child whose subtree may contain (key, rid)
+static int find_child(const BTreeNode* node, const uint8_t* key, int key_len, RecordId rid) {
+    int lo = 0, hi = node->key_count;
+    uint8_t sep[BTREE_MAX_KEY_BYTES];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int sep_len = node_key(node, mid, sep);
+        bool has_rid;
+        RecordId sep_rid;
+        int child;
+        separator_info(node, mid, &has_rid, &sep_rid, &child);
+        if (compare_to_separator(key, key_len, rid, sep, sep_len, has_rid, sep_rid) >= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo; // Number of separators <= (key, rid)
+}
+
+// First leaf position whose entry is >= (key, rid)
+static int find_leaf_position(const BTreeDesc* desc, const BTreeNode* node,
+                              const uint8_t* key, int key_len, RecordId rid) {
+    int lo = 0, hi = node->key_count;
+    uint8_t entry_key[BTREE_MAX_KEY_BYTES];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int entry_len = node_key(node, mid, entry_key);
+        if (compare_entries(entry_key, entry_len, leaf_rid(desc, node, mid), key, key_len, rid) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Index of the first child that may hold entries admitted by the low bound
+static int find_child_for_bound(const BTreeNode* node, const EncodedBound* low) {
+    int lo = 0, hi = node->key_count;
+    uint8_t sep[BTREE_MAX_KEY_BYTES];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int sep_len = node_key(node, mid, sep);
+        if (below_low(sep, sep_len, low)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo; // Number of separators below the bound
+}
+
+// First leaf position admitted by the low bound
+static int find_leaf_position_for_bound(const BTreeNode* node, const EncodedBound* low) {
+    int lo = 0, hi = node->key_count;
+    uint8_t entry_key[BTREE_MAX_KEY_BYTES];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int entry_len = node_key(node, mid, entry_key);
+        if (below_low(entry_key, entry_len, low)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Where a descent is heading: an entry (insert/delete) or a scan's low bound
+typedef struct {
+    const uint8_t* key;         // Entry key, or NULL for a scan
+    int key_len;
+    RecordId rid;
+    const EncodedBound* low;    // Scan low bound (NULL = leftmost leaf)
+} BTreeTarget;
+
+static int route(const BTreeNode* node, const BTreeTarget* target) {
+    if (target->key) return find_child(node, target->key, target->key_len, target->rid);
+    return target->low ? find_child_for_bound(node, target->low) : 0;
+}
+
+/*
+ * Optimistic descent to the leaf for target. Returns the pinned leaf, its
+ * version and a validated copy of it. No latch is held by the caller.
+ */
+static Page* descend_optimistic(const BTreeDesc* desc, const BTreeTarget* target,
+                                BTreeNode* copy, uint64_t* leaf_version) {
+    for (;;) {
+        Page* page = pin_page(desc->root_page_id);
+        if (!page) return NULL;
+        uint64_t version = read_lock(page);
+        bool restart = false;
+
+        while (!restart) {
+            if (!node_snapshot(page, version, copy)) {
+                restart = true;
+                break;
+            }
+            if (copy->is_leaf) {
+                *leaf_version = version;
+                return page;
+            }
+
+            Page* child = pin_page(internal_child(copy, route(copy, target)));
+            if (!child) {
+                release_page(page);
+                return NULL;
+            }
+            uint64_t child_version = read_lock(child);
+
+            // The parent must not have changed while we stepped into the child
+            restart = !validate(page, version);
+            release_page(page);
+            page = child;
+            version = child_version;
+        }
+        release_page(page);
+    }
+}
+
+// Bytes a node's entries occupy once repacked (prefix, slots and entries)
+static int node_used_bytes(const BTreeDesc* desc, const BTreeNode* node) {
+    int used = node->prefix_len;
+    for (int i = 0; i < node->key_count; i++) {
+        const uint8_t* entry = node->body + slot_offset(node, i);
+        uint16_t suffix_len;
+        memcpy(&suffix_len, entry, sizeof(suffix_len));
+        used += 2 * sizeof(uint16_t) + suffix_len + rest_length(desc, node, node_rest(node, i));
+    }
+    return used;
+}
+
+/*
+ * Whether inserting an entry cannot split the node. entry_size includes the
+ * slot and length field. Unless the key is known to share the node prefix,
+ * assume the new key shrinks the prefix to nothing.
+ */
+static bool node_is_safe(const BTreeDesc* desc, const BTreeNode* node, int entry_size, bool keeps_prefix) {
+    int used = node_used_bytes(desc, node) + entry_size;
+    if (!keeps_prefix) used += node->key_count * node->prefix_len;
+    return used <= BTREE_BODY_SIZE;
+}
+
+// Whether (key, rest) goes into this leaf without a split
+static bool leaf_is_safe(const BTreeDesc* desc, const BTreeNode* node,
+                         const uint8_t* key, int key_len, int rest_len) {
+    bool keeps_prefix = key_len >= node->prefix_len && memcmp(key, node->body, node->prefix_len) == 0;
+    int entry_size = 2 * sizeof(uint16_t) + key_len - (keeps_prefix ? node->prefix_len : 0) + rest_len;
+    return node_is_safe(desc, node, entry_size, keeps_prefix);
+}
+
+/* ---------------- Repacking and splitting ---------------- */
+
+// Decompressed size of a node is at most its body plus one prefix per entry
+static NodeImage* image_create(const BTreeNode* node, int extra_bytes) {
+    NodeImage* image = malloc(sizeof(NodeImage));
+    if (!image) return NULL;
+    image->count = 0;
+    image->arena_used = 0;
+    image->arena = malloc((size_t)node->key_count * node->prefix_len + BTREE_BODY_SIZE + extra_bytes);
+    if (!image->arena) {
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+static void image_free(NodeImage* image) {
+    if (!image) return;
+    free(image->arena);
+    free(image);
+}
+
+static void image_append(NodeImage* image, const uint8_t* key, int key_len, const uint8_t* rest, int rest_len) {
+    NodeEntry* entry = &image->entries[image->count++];
+    uint8_t* dst = image->arena + image->arena_used;
+    memcpy(dst, key, key_len);
+    memcpy(dst + key_len, rest, rest_len);
+    image->arena_used += key_len + rest_len;
+    entry->key = dst;
+    entry->key_len = key_len;
+    entry->rest = dst + key_len;
+    entry->rest_len = rest_len;
+}
+
+// Decompress a node, inserting (key, rest) at position pos
+static void image_load(NodeImage* image, const BTreeDesc* desc, const BTreeNode* node, int pos,
+                       const uint8_t* key, int key_len, const uint8_t* rest, int rest_len) {
+    uint8_t entry_key[BTREE_MAX_KEY_BYTES];
+    image->count = 0;
+    image->arena_used = 0;
+    for (int i = 0; i <= node->key_count; i++) {
+        if (i == pos) image_append(image, key, key_len, rest, rest_len);
+        if (i == node->key_count) break;
+        int entry_len = node_key(node, i, entry_key);
+        const uint8_t* entry_rest = node_rest(node, i);
+        image_append(image, entry_key, entry_len, entry_rest, rest_length(desc, node, entry_rest));
+    }
+}
+
+static int common_prefix(const NodeEntry* a, const NodeEntry* b) {
+    int max = a->key_len < b->key_len ? a->key_len : b->key_len;
+    int len = 0;
+    while (len < max && a->key[len] == b->key[len]) len++;
+    return len;
+}
+
+// Bytes needed to pack entries [from, to) into one node
+static int packed_size(const NodeImage* image, int from, int to) {
+    if (to <= from) return 0;
+    int prefix = common_prefix(&image->entries[from], &image->entries[to - 1]);
+    int size = prefix;
+    for (int i = from; i < to; i++) {
+        size += sizeof(uint16_t) * 2 + image->entries[i].key_len - prefix + image->entries[i].rest_len;
+    }
+    return size;
+}
+
+// Write entries [from, to) into an emptied node, computing its common prefix
+static void image_pack(const NodeImage* image, int from, int to, BTreeNode* node) {
+    int prefix = to > from ? common_prefix(&image->entries[from], &image->entries[to - 1]) : 0;
+    node->prefix_len = prefix;
+    node->key_count = 0;
+    node->heap_start = BTREE_BODY_SIZE;
+    if (to > from) memcpy(node->body, image->entries[from].key, prefix);
+
+    for (int i = from; i < to; i++) {
+        const NodeEntry* entry = &image->entries[i];
+        uint16_t suffix_len = entry->key_len - prefix;
+        int size = sizeof(uint16_t) + suffix_len + entry->rest_len;
+        node->heap_start -= size;
+        uint8_t* dst = node->body + node->heap_start;
+        memcpy(dst, &suffix_len, sizeof(suffix_len));
+        memcpy(dst + sizeof(uint16_t), entry->key + prefix, suffix_len);
+        memcpy(dst + sizeof(uint16_t) + suffix_len, entry->rest, entry->rest_len);
+        set_slot_offset(node, node->key_count++, node->heap_start);
+    }
+}
+
+/*
+ * Split point that balances bytes while keeping both halves within a page.
+ * Internal splits move entry `mid` up, so the right half starts after it.
+ */
+static int choose_split(const NodeImage* image, bool move_up) {
+    int best = -1, best_diff = 0;
+    for (int mid = 1; mid < image->count; mid++) {
+        int left = packed_size(image, 0, mid);
+        int right = packed_size(image, mid + (move_up ? 1 : 0), image->count);
+        if (left > BTREE_BODY_SIZE || right > BTREE_BODY_SIZE) continue;
+        int diff = left > right ? left - right : right - left;
+        if (best < 0 || diff < best_diff) {
+            best = mid;
+            best_diff = diff;
+        }
+    }
+    return best;
+}
+
+/*
+ * Suffix truncation: the shortest prefix of the right node's first key that
+ * sorts above the left node's last key. Equal keys need the record id.
+ */
+static void make_separator(const uint8_t* left, int left_len, RecordId left_rid,
+                           const uint8_t* right, int right_len, RecordId right_rid, BTreeSplit* split) {
+    (void)left_rid;
+    int len = 0;
+    while (len < left_len && len < right_len && left[len] == right[len]) len++;
+
+    if (len == left_len && len == right_len) {
+        memcpy(split->key, right, right_len);
+        split->key_len = right_len;
+        split->has_rid = true;
+        split->rid = right_rid;
+    } else {
+        split->key_len = len < right_len ? len + 1 : right_len;
+        memcpy(split->key, right, split->key_len);
+        split->has_rid = false;
+        memset(&split->rid, 0, sizeof(RecordId));
+    }
+}
+
+/*
+ * Insert (key, rest) at pos. Fast path: the key shares the node prefix and
+ * fits in contiguous free space. Otherwise repack, and split if needed.
+ */
+static int node_insert(const BTreeDesc* desc, BTreeNode* node, int pos,
+                       const uint8_t* key, int key_len, const uint8_t* rest, int rest_len,
+                       BTreeSplit* split) {
+    split->split = false;
+
+    if (key_len >= node->prefix_len && memcmp(key, node->body, node->prefix_len) == 0) {
+        int suffix_len = key_len - node->prefix_len;
+        int size = sizeof(uint16_t) + suffix_len + rest_len;
+        if (contiguous_free(node) >= size + (int)sizeof(uint16_t)) {
+            node->heap_start -= size;
+            uint8_t* dst = node->body + node->heap_start;
+            uint16_t stored_len = suffix_len;
+            memcpy(dst, &stored_len, sizeof(stored_len));
+            memcpy(dst + sizeof(uint16_t), key + node->prefix_len, suffix_len);
+            memcpy(dst + sizeof(uint16_t) + suffix_len, rest, rest_len);
+
+            uint8_t* slots = node->body + node->prefix_len;
+            memmove(slots + (pos + 1) * sizeof(uint16_t), slots + pos * sizeof(uint16_t),
+                    (node->key_count - pos) * sizeof(uint16_t));
+            set_slot_offset(node, pos, node->heap_start);
+            node->key_count++;
+            return 0;
+        }
+    }
+
+    NodeImage* image = image_create(node, key_len + rest_len);
+    if (!image) return -1;
+    image_load(image, desc, node, pos, key, key_len, rest, rest_len);
+
+    if (packed_size(image, 0, image->count) <= BTREE_BODY_SIZE) {
+        image_pack(image, 0, image->count, node);
+        image_free(image);
+        return 0;
+    }
+
+    // Pick the split point first (both halves must fit): a node that cannot
+    // be split must not cost a page, which could never be handed out again
+    int mid = choose_split(image, !node->is_leaf);
+    if (mid < 0) {
+        image_free(image);
+        return -1;
+    }
+
+    // The new right node becomes reachable once the caller unlocks this node
+    int right_page_id = allocate_page();
+    Page* right_page = right_page_id < 0 ? NULL : pin_page(right_page_id);
+    if (!right_page) {
+        image_free(image);
+        return -1;
+    }
+    write_lock(right_page);
+    BTreeNode* right = (BTreeNode*)right_page->data;
+    init_node(right, node->is_leaf);
+
+    if (node->is_leaf) {
+        const NodeEntry* last = &image->entries[mid - 1];
+        const NodeEntry* first = &image->entries[mid];
+        RecordId last_rid, first_rid;
+        memcpy(&last_rid, last->rest + last->rest_len - sizeof(RecordId), sizeof(RecordId));
+        memcpy(&first_rid, first->rest + first->rest_len - sizeof(RecordId), sizeof(RecordId));
+        make_separator(last->key, last->key_len, last_rid, first->key, first->key_len, first_rid, split);
+
+        image_pack(image, mid, image->count, right);
+        image_pack(image, 0, mid, node);
+        right->next_leaf = node->next_leaf;
+        node->next_leaf = right_page_id;
+    } else {
+        // The separator at mid moves up; its child becomes the right node's first child
+        const NodeEntry* up = &image->entries[mid];
+        memcpy(split->key, up->key, up->key_len);
+        split->key_len = up->key_len;
+        split->has_rid = up->rest[0] != 0;
+        if (split->has_rid) memcpy(&split->rid, up->rest + 1, sizeof(RecordId));
+        memcpy(&right->first_child, up->rest + 1 + (split->has_rid ? sizeof(RecordId) : 0), sizeof(int));
+
+        image_pack(image, mid + 1, image->count, right);
+        image_pack(image, 0, mid, node);
+    }
+
+    split->split = true;
+    split->right_page_id = right_page_id;
+    mark_dirty(right_page);
+    write_unlock(right_page);
+    release_page(right_page);
+    image_free(image);
+    return 0;
+}
+
+static int build_separator_rest(const BTreeSplit* split, uint8_t* rest) {
+    int len = 0;
+    rest[len++] = split->has_rid ? 1 : 0;
+    if (split->has_rid) {
+        memcpy(rest + len, &split->rid, sizeof(RecordId));
+        len += sizeof(RecordId);
+    }
+    memcpy(rest + len, &split->right_page_id, sizeof(int));
+    return len + sizeof(int);
+}
+
+// Root split: move the (left half) root into a new page, keep the root in place
+static int split_root(const BTreeDesc* desc, Page* root_page, const BTreeSplit* split) {
+    int left_page_id = allocate_page();
+    Page* left_page = left_page_id < 0 ? NULL : pin_page(left_page_id);
+    if (!left_page) return -1;
+
+    write_lock(left_page);
+    memcpy(left_page->data, root_page->data, PAGE_SIZE);
+    write_unlock(left_page);
+    mark_dirty(left_page);
+    release_page(left_page);
+
+    BTreeNode* root = (BTreeNode*)root_page->data;
+    init_node(root, false);
+    root->first_child = left_page_id;
+
+    uint8_t sep_rest[1 + sizeof(RecordId) + sizeof(int)];
+    int sep_rest_len = build_separator_rest(split, sep_rest);
+    BTreeSplit no_split;
+    return node_insert(desc, root, 0, split->key, split->key_len, sep_rest, sep_rest_len, &no_split);
+}
+
+/*
+ * Insert that may split: write-lock coupling from the root. Once a child
+ * cannot split, every lock above it is released; splits then propagate
+ * only through the nodes that are still locked.
+ */
+static int insert_pessimistic(const BTreeDesc* desc, const uint8_t* key, int key_len,
+                              const uint8_t* rest, int rest_len, RecordId rid) {
+    Page* path[BTREE_MAX_HEIGHT];
+    int child_idx[BTREE_MAX_HEIGHT];
+    int top = 0, depth = 0;     // path[top .. depth - 1] are write-locked
+
+    path[depth] = pin_page(desc->root_page_id);
+    if (!path[depth]) return -1;
+    write_lock(path[depth++]);
+
+    int ret = 0;
+    for (;;) {
+        BTreeNode* node = (BTreeNode*)path[depth - 1]->data;
+        if (node->is_leaf) break;
+        if (depth == BTREE_MAX_HEIGHT) {
+            ret = -1;
+            break;
+        }
+
+        child_idx[depth - 1] = find_child(node, key, key_len, rid);
+        Page* child = pin_page(internal_child(node, child_idx[depth - 1]));
+        if (!child) {
+            ret = -1;
+            break;
+        }
+        write_lock(child);
+
+        BTreeNode* child_node = (BTreeNode*)child->data;
+        bool safe = child_node->is_leaf ? leaf_is_safe(desc, child_node, key, key_len, rest_len)
+                                        : node_is_safe(desc, child_node, desc->max_internal_entry, false);
+        if (safe) {
+            for (int i = top; i < depth; i++) {
+                write_unlock_unchanged(path[i]);
+                release_page(path[i]);
+            }
+            top = depth;
+        }
+        path[depth++] = child;
+    }
+
+    int level = depth - 1;      // Lowest level that was modified
+    if (ret == 0) {
+        BTreeSplit* split = malloc(sizeof(BTreeSplit));
+        BTreeSplit* parent_split = malloc(sizeof(BTreeSplit));
+        if (!split || !parent_split) {
+            ret = -1;
+            level = depth;
+        } else {
+            BTreeNode* leaf = (BTreeNode*)path[level]->data;
+            int pos = find_leaf_position(desc, leaf, key, key_len, rid);
+            ret = node_insert(desc, leaf, pos, key, key_len, rest, rest_len, split);
+
+            // New separator goes right after the split child
+            while (ret == 0 && split->split && level > top) {
+                level--;
+                uint8_t sep_rest[1 + sizeof(RecordId) + sizeof(int)];
+                int sep_rest_len = build_separator_rest(split, sep_rest);
+                ret = node_insert(desc, (BTreeNode*)path[level]->data, child_idx[level],
+                                  split->key, split->key_len, sep_rest, sep_rest_len, parent_split);
+                BTreeSplit* tmp = split;
+                split = parent_split;
+                parent_split = tmp;
+            }
+
+            if (ret == 0 && split->split) {
+                // Only the root can be left splitting: every lower top node was safe
+                ret = (level == 0 && top == 0) ? split_root(desc, path[0], split) : -1;
+            }
+        }
+        free(split);
+        free(parent_split);
+    }
+
+    for (int i = top; i < depth; i++) {
+        if (i >= level) {
+            mark_dirty(path[i]);
+            write_unlock(path[i]);
+        } else {
+            write_unlock_unchanged(path[i]);
+        }
+        release_page(path[i]);
+    }
+    return ret;
+}
+
+/* ---------------- Public API ---------------- */
+
+/*
+ * Whether worst-case entries of this index always leave a valid split: two
+ * entries plus a full-length node prefix must fit in one node.
+ */
+bool btree_entry_fits(const Index* index, const Table* table) {
+    BTreeDesc desc;
+    if (btree_describe(index, table, &desc) != 0) return false;
+    int max_key = desc.max_internal_entry - 2 * sizeof(uint16_t) - 1 - sizeof(RecordId) - sizeof(int);
+    return max_key + 2 * desc.max_leaf_entry <= BTREE_BODY_SIZE &&
+           max_key + 2 * desc.max_internal_entry <= BTREE_BODY_SIZE;
+}
+
+int btree_create(uint32_t txn_id) {
+    (void)txn_id;
+    int root_page_id = allocate_page();
+    Page* page = pin_page(root_page_id);
+    if (!page) return -1;
+
+    write_lock(page);
+    init_node((BTreeNode*)page->data, true);
+    write_unlock(page);
+    mark_dirty(page);
+    release_page(page);
+    return root_page_id;
+}
+
+// Reset an index to an empty root leaf (used before rebuilding from the heap)
+int btree_reset(int root_page_id, uint32_t txn_id) {
+    (void)txn_id;
+    Page* page = pin_page(root_page_id);
+    if (!page) return -1;
+
+    write_lock(page);
+    init_node((BTreeNode*)page->data, true);
+    write_unlock(page);
+    mark_dirty(page);
+    release_page(page);
+    return 0;
+}
+
+static int build_key(const BTreeDesc* desc, const Value* row_values, uint8_t* key) {
+    Value values[MAX_INDEX_COLUMNS];
+    for (int i = 0; i < desc->key_count; i++) {
+        values[i] = row_values[desc->key_column[i]];
+    }
+    return key_encode_values(desc->key_type, values, desc->key_count, key);
+}
+
+// Leaf payload after the key: encoded INCLUDE columns then the record id
+static int build_leaf_rest(const BTreeDesc* desc, const Value* row_values, RecordId rid, uint8_t* rest) {
+    int len = 0;
+    for (int i = 0; i < desc->include_count; i++) {
+        len += key_encode_value(desc->include_type[i], &row_values[desc->include_column[i]], rest + len);
+    }
+    memcpy(rest + len, &rid, sizeof(RecordId));
+    return len + sizeof(RecordId);
+}
+
+int btree_insert(const Index* index, const Table* table, const Value* row_values, RecordId rid, uint32_t txn_id) {
+    (void)txn_id;
+    BTreeDesc desc;
+    if (btree_describe(index, table, &desc) != 0) return -1;
+
+    uint8_t key[BTREE_MAX_KEY_BYTES];
+    uint8_t rest[BTREE_MAX_REST_BYTES];
+    int key_len = build_key(&desc, row_values, key);
+    int rest_len = build_leaf_rest(&desc, row_values, rid, rest);
+
+    BTreeNode* copy = malloc(sizeof(BTreeNode));
+    if (!copy) return -1;
+    BTreeTarget target = { key, key_len, rid, NULL };
+
+    // Fast path: lock only the leaf when the entry fits without a split
+    for (;;) {
+        uint64_t version;
+        Page* page = descend_optimistic(&desc, &target, copy, &version);
+        if (!page) {
+            free(copy);
+            return -1;
+        }
+        if (!leaf_is_safe(&desc, copy, key, key_len, rest_len)) {
+            release_page(page);
+            break;
+        }
+        if (!upgrade_lock(page, version)) {
+            release_page(page);
+            continue;
+        }
+
+        // Unchanged since the snapshot, so the leaf still has room
+        BTreeNode* node = (BTreeNode*)page->data;
+        BTreeSplit split;
+        int pos = find_leaf_position(&desc, node, key, key_len, rid);
+        int ret = node_insert(&desc, node, pos, key, key_len, rest, rest_len, &split);
+        mark_dirty(page);
+        write_unlock(page);
+        release_page(page);
+        free(copy);
+        return ret;
+    }
+
+    free(copy);
+    return insert_pessimistic(&desc, key, key_len, rest, rest_len, rid);
+}
+
+int btree_delete(const Index* index, const Table* table, const Value* row_values, RecordId rid, uint32_t txn_id) {
+    (void)txn_id;
+    BTreeDesc desc;
+    if (btree_describe(index, table, &desc) != 0) return -1;
+
+    uint8_t key[BTREE_MAX_KEY_BYTES];
+    int key_len = build_key(&desc, row_values, key);
+
+    BTreeNode* copy = malloc(sizeof(BTreeNode));
+    if (!copy) return -1;
+    BTreeTarget target = { key, key_len, rid, NULL };
+
+    int found = -1;
+    for (;;) {
+        uint64_t version;
+        Page* page = descend_optimistic(&desc, &target, copy, &version);
+        if (!page) break;
+
+        int pos = find_leaf_position(&desc, copy, key, key_len, rid);
+        uint8_t entry_key[BTREE_MAX_KEY_BYTES];
+        if (pos >= copy->key_count ||
+            compare_entries(entry_key, node_key(copy, pos, entry_key), leaf_rid(&desc, copy, pos),
+                            key, key_len, rid) != 0) {
+            release_page(page);
+            break;
+        }
+        if (!upgrade_lock(page, version)) {
+            release_page(page);
+            continue;
+        }
+
+        // Drop the slot; the entry bytes become a hole reclaimed on the next repack
+        BTreeNode* node = (BTreeNode*)page->data;
+        uint8_t* slots = node->body + node->prefix_len;
+        memmove(slots + pos * sizeof(uint16_t), slots + (pos + 1) * sizeof(uint16_t),
+                (node->key_count - pos - 1) * sizeof(uint16_t));
+        node->key_count--;
+        mark_dirty(page);
+        write_unlock(page);
+        release_page(page);
+        found = 0;
+        break;
+    }
+    free(copy);
+    return found;
+}
+
+static void encode_bound(const BTreeDesc* desc, const IndexBound* bound, EncodedBound* encoded) {
+    encoded->key_len = key_encode_values(desc->key_type, bound->values, bound->count, encoded->key);
+    encoded->inclusive = bound->inclusive;
+}
+
+/*
+ * Range scan between two key-prefix bounds. A NULL bound (or count 0) is
+ * unbounded on that side. Entries are visited in key order.
+ */
+int btree_scan(const Index* index, const Table* table, const IndexBound* low, const IndexBound* high,
+               BTreeVisitor visitor, void* ctx, uint32_t txn_id) {
+    (void)txn_id;
+    BTreeDesc desc;
+    if (btree_describe(index, table, &desc) != 0) return -1;
+
+    if (low && low->count <= 0) low = NULL;
+    if (high && high->count <= 0) high = NULL;
+    if ((low && low->count > desc.key_count) || (high && high->count > desc.key_count)) return -1;
+
+    EncodedBound low_key, high_key;
+    if (low) encode_bound(&desc, low, &low_key);
+    if (high) encode_bound(&desc, high, &high_key);
+
+    BTreeNode* leaf = malloc(sizeof(BTreeNode));
+    if (!leaf) return -1;
+
+    // Descend to the first leaf that may contain the low bound
+    BTreeTarget target = { NULL, 0, { 0, 0 }, low ? &low_key : NULL };
+    uint64_t version;
+    Page* page = descend_optimistic(&desc, &target, leaf, &version);
+    if (!page) {
+        free(leaf);
+        return -1;
+    }
+    release_page(page);
+
+    // Entries are visited from the validated copy, so no latch is held in the visitor
+    int visited = 0;
+    int pos = low ? find_leaf_position_for_bound(leaf, &low_key) : 0;
+    uint8_t key[BTREE_MAX_KEY_BYTES];
+
+    for (;;) {
+        for (; pos < leaf->key_count; pos++) {
+            int key_len = node_key(leaf, pos, key);
+            if (high && above_high(key, key_len, &high_key)) {
+                free(leaf);
+                return visited;
+            }
+
+            Value entry_values[2 * MAX_INDEX_COLUMNS];
+            RecordId rid;
+            const uint8_t* rest = node_rest(leaf, pos);
+            key_decode_values(desc.key_type, key, desc.key_count, entry_values);
+            int include_len = key_decode_values(desc.include_type, rest, desc.include_count,
+                                            entry_values + desc.key_count);
+            memcpy(&rid, rest + include_len, sizeof(RecordId));
+
+            visited++;
+            if (visitor(entry_values, rid, ctx) != 0) {
+                free(leaf);
+                return visited;
+            }
+        }
+
+        int next = leaf->next_leaf;
+        if (next == -1) break;
+
+        // Leaves are never freed, so a conflict only retries the sibling itself
+        page = pin_page(next);
+        if (!page) {
+            free(leaf);
+            return -1;
+        }
+        do {
+            version = read_lock(page);
+        } while (!node_snapshot(page, version, leaf));
+        release_page(page);
+        pos = 0;
+    }
+
+    free(leaf);
+    return visited;
+}
@@ -19,6 +19,10 @@ extern void close_wal_manager();
 extern int perform_crash_recovery();
 extern int checkpoint_recovery();
 extern void flush_wal();
+extern int rebuild_indexes();
+extern int init_zone_maps();
+extern void cleanup_zone_maps();
+extern int rebuild_zone_maps();
 
 extern int execute_create_table(const char* table_name, Column* columns, int column_count, uint32_t txn_id, QueryResult* result);
 extern int execute_drop_table(const char* table_name, uint32_t txn_id, QueryResult* result);
@@ -26,10 +30,20 @@ extern int execute_insert(const char* table_name, Value* values, int value_count
 extern int execute_update(const char* table_name, const char* column, Value* value, const char* where_clause, uint32_t txn_id, QueryResult* result);
 extern int execute_delete(const char* table_name, const char* where_clause, uint32_t txn_id, QueryResult* result);
 extern int execute_select(const char* table_name, bool select_all, char columns[][MAX_NAME_LEN], int column_count, uint32_t txn_id, QueryResult* result);
-extern int execute_create_index(const char* index_name, const char* table_name, const char* column_name, int index_type, uint32_t txn_id, QueryResult* result);
+extern int execute_select_with_where(const char* table_name, bool select_all, char columns[][MAX_NAME_LEN], int column_count,
+                                     Predicate* predicates, int predicate_count,
+                                     uint32_t txn_id, QueryResult* result);
+extern int execute_select_for_update(const char* table_name, bool select_all, char columns[][MAX_NAME_LEN], int column_count,
+                                     Predicate* predicates, int predicate_count, RowLockPolicy policy, int limit,
+                                     uint32_t txn_id, QueryResult* result);
+extern int execute_create_index(const char* index_name, const char* table_name,
+                                char key_columns[][MAX_NAME_LEN], int key_count,
+                                char include_columns[][MAX_NAME_LEN], int include_count,
+                                int index_type, uint32_t txn_id, QueryResult* result);
 extern int execute_drop_index(const char* index_name, uint32_t txn_id, QueryResult* result);
 extern int execute_describe(const char* table_name, uint32_t txn_id, QueryResult* result);
 extern int execute_show_tables(uint32_t txn_id, QueryResult* result);
+extern int execute_show_concurrency(uint32_t txn_id, QueryResult* result);
 
 DataType parse_datatype(const char* type_str, int* size) {
     char upper_type[64];
@@ -61,6 +75,156 @@ DataType parse_datatype(const char* type_str, int* size) {
     return TYPE_INT;
 }
 
+static void trim_whitespace(char* str) {
+    char* start = str;
+    while (*start == ' ' || *start == '\t') start++;
+    if (start != str) memmove(str, start, strlen(start) + 1);
+
+    char* end = str + strlen(str) - 1;
+    while (end >= str && (*end == ' ' || *end == '\t' || *end == ';')) *end-- = '\0';
+}
+
+// Parse "(a, b, c)" into column names; returns the count or -1 if malformed
+static int parse_column_list(const char* text, char columns[][MAX_NAME_LEN], int max_columns) {
+    const char* open = strchr(text, '(');
+    const char* close = open ? strchr(open, ')') : NULL;
+    if (!open || !close) return -1;
+
+    char list[256];
+    int len = close - open - 1;
+    if (len <= 0 || len >= (int)sizeof(list)) return -1;
+    strncpy(list, open + 1, len);
+    list[len] = '\0';
+
+    int count = 0;
+    char* save = NULL;
+    char* token = strtok_r(list, ",", &save);
+    while (token) {
+        if (count >= max_columns) return -1;
+        strncpy(columns[count], token, MAX_NAME_LEN - 1);
+        columns[count][MAX_NAME_LEN - 1] = '\0';
+        trim_whitespace(columns[count]);
+        if (columns[count][0] == '\0') return -1;
+        count++;
+        token = strtok_r(NULL, ",", &save);
+    }
+    return count;
+}
+
+// Parse "column op value" (op is =, >, <, >= or <=); quotes around the value are removed
+static bool parse_predicate(char* text, Predicate* predicate) {
+    char* op_pos = NULL;
+    
+    if ((op_pos = strstr(text, ">="))) {
+        strcpy(predicate->op, ">=");
+    } else if ((op_pos = strstr(text, "<="))) {
+        strcpy(predicate->op, "<=");
+    } else if ((op_pos = strchr(text, '>'))) {
+        strcpy(predicate->op, ">");
+    } else if ((op_pos = strchr(text, '<'))) {
+        strcpy(predicate->op, "<");
+    } else if ((op_pos = strchr(text, '='))) {
+        strcpy(predicate->op, "=");
+    } else {
+        return false;
+    }
+    
+    // Extract column (before operator)
+    char* val = op_pos + strlen(predicate->op);
+    *op_pos = '\0';
+    trim_whitespace(text);
+    if (strlen(text) == 0 || strlen(text) >= MAX_NAME_LEN) return false;
+    strcpy(predicate->column, text);
+    
+    // Extract value (after operator), then remove quotes if present
+    trim_whitespace(val);
+    if ((*val == '\'' || *val == '"') && strlen(val) > 1) {
+        val++; // skip opening quote
+        char* end = val + strlen(val) - 1;
+        if (*end == '\'' || *end == '"') *end = '\0'; // remove closing quote
+    }
+    
+    if (strlen(val) == 0 || strlen(val) >= MAX_STRING_LEN) return false;
+    strcpy(predicate->value, val);
+    return true;
+}
+
+// Split a WHERE clause on AND (outside quotes) into predicates; returns the count
+static int parse_where_clause(const char* where_text, Predicate* predicates, int max_predicates) {
+    char clause[MAX_QUERY_LEN];
+    strncpy(clause, where_text, sizeof(clause) - 1);
+    clause[sizeof(clause) - 1] = '\0';
+    
+    int count = 0;
+    char* start = clause;
+    char quote = '\0';
+    for (char* p = clause; ; p++) {
+        if (quote) {
+            if (*p == quote) quote = '\0';
+            else if (*p == '\0') break;
+            continue;
+        }
+        if (*p == '\'' || *p == '"') {
+            quote = *p;
+            continue;
+        }
+        
+        bool at_and = *p == ' ' && strncasecmp(p, " and ", 5) == 0;
+        if (at_and || *p == '\0') {
+            bool last = *p == '\0';
+            *p = '\0';
+            if (count < max_predicates && parse_predicate(start, &predicates[count])) {
+                count++;
+            }
+            if (last) break;
+            p += 4;
+            start = p + 1;
+        }
+    }
+    return count;
+}
+
+/*
+ * Cut a trailing [LIMIT n] [FOR UPDATE [NOWAIT | SKIP LOCKED]] (and ';')
+ * off a SELECT and its upper-case copy alike, returning the clauses.
+ * Returns false if either clause is malformed.
+ */
+static bool parse_select_tail(char* query, char* upper_query, RowLockPolicy* policy, int* limit) {
+    *policy = ROW_LOCK_NONE;
+    *limit = 0;
+    
+    size_t len = strlen(upper_query);
+    while (len > 0 && (upper_query[len - 1] == ';' || upper_query[len - 1] == ' ' ||
+                       upper_query[len - 1] == '\n' || upper_query[len - 1] == '\r')) {
+        len--;
+    }
+    upper_query[len] = query[len] = '\0';
+    
+    char* for_update = strstr(upper_query, " FOR UPDATE");
+    if (for_update) {
+        const char* wait_mode = for_update + 11;
+        while (*wait_mode == ' ') wait_mode++;
+        if (*wait_mode == '\0') *policy = ROW_LOCK_WAIT;
+        else if (strcmp(wait_mode, "NOWAIT") == 0) *policy = ROW_LOCK_NOWAIT;
+        else if (strcmp(wait_mode, "SKIP LOCKED") == 0) *policy = ROW_LOCK_SKIP_LOCKED;
+        else return false;
+        len = for_update - upper_query;
+        upper_query[len] = query[len] = '\0';
+    }
+    
+    char* limit_pos = strstr(upper_query, " LIMIT ");
+    if (limit_pos) {
+        int consumed = 0;
+        if (sscanf(limit_pos + 7, "%d %n", limit, &consumed) != 1 || limit_pos[7 + consumed] != '\0' ||
+            *limit <= 0) {
+            return false;
+        }
+        len = limit_pos - upper_query;
+        upper_query[len] = query[len] = '\0';
+    }
+    return true;
+}
+
 int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
     printf("Processing (txn %u): %s\n", txn_id, query);
     printf("DEBUG: Query length: %zu\n", strlen(query));
@@ -95,7 +259,8 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
         strncpy(col_defs, paren_start + 1, paren_end - paren_start - 1);
         col_defs[paren_end - paren_start - 1] = '\0';
         
-        char* token = strtok(col_defs, ",");
+        char* save = NULL;
+        char* token = strtok_r(col_defs, ",", &save);
         while (token && column_count < MAX_COLUMNS) {
             while (*token == ' ') token++;
             
@@ -106,7 +271,7 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
                 columns[column_count].nullable = true;
                 column_count++;
             }
-            token = strtok(NULL, ",");
+            token = strtok_r(NULL, ",", &save);
         }
         
         return execute_create_table(table_name, columns, column_count, txn_id, result);
@@ -147,7 +312,8 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
         strncpy(val_list, paren_start + 1, paren_end - paren_start - 1);
         val_list[paren_end - paren_start - 1] = '\0';
         
-        char* token = strtok(val_list, ",");
+        char* save = NULL;
+        char* token = strtok_r(val_list, ",", &save);
         while (token && value_count < MAX_COLUMNS) {
             while (*token == ' ') token++;
             
@@ -160,7 +326,7 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
                 values[value_count].int_val = atoi(token);
             }
             value_count++;
-            token = strtok(NULL, ",");
+            token = strtok_r(NULL, ",", &save);
         }
         
         return execute_insert(table_name, values, value_count, txn_id, result);
@@ -204,75 +370,40 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
         printf("DEBUG: Processing SELECT query: %s\n", query);
         printf("DEBUG: Upper query: %s\n", upper_query);
         fflush(stdout);
+        
+        // LIMIT and FOR UPDATE come off first; the rest parses as before
+        char select_query[MAX_QUERY_LEN];
+        strcpy(select_query, query);
+        query = select_query;
+        RowLockPolicy lock_policy;
+        int limit;
+        if (!parse_select_tail(select_query, upper_query, &lock_policy, &limit)) {
+            result->column_count = 1;
+            strcpy(result->columns[0].name, "Error");
+            result->columns[0].type = TYPE_VARCHAR;
+            result->row_count = 1;
+            strcpy(result->data[0][0].string_val, "Invalid LIMIT or FOR UPDATE clause");
+            return -1;
+        }
         char table_names[MAX_COLUMNS][MAX_NAME_LEN];
         int table_count = 0;
         bool select_all = false;
         char columns[MAX_COLUMNS][MAX_NAME_LEN];
         int column_count = 0;
         
-        // Simple WHERE clause detection
-        char where_column[MAX_NAME_LEN] = "";
-        char where_value[MAX_STRING_LEN] = "";
-        char where_op[3] = "";
-        bool has_where = false;
+        // WHERE clause: one or more predicates joined by AND
+        Predicate predicates[MAX_PREDICATES];
+        int predicate_count = 0;
         
         // Look for WHERE pattern in original query (not upper case)
         char* where_start = strstr(query, " where ");
         if (!where_start) where_start = strstr(query, " WHERE ");
         
         if (where_start) {
-            // Simple pattern: "where column = value" or "where column = 'value'"
-            char temp[256];
-            strncpy(temp, where_start + 7, sizeof(temp) - 1);
-            temp[sizeof(temp) - 1] = '\0';
-            
-            // Find operator (=, >, <, >=, <=)
-            char* op_pos = NULL;
-            
-            if ((op_pos = strstr(temp, ">="))) {
-                strcpy(where_op, ">=");
-            } else if ((op_pos = strstr(temp, "<="))) {
-                strcpy(where_op, "<=");
-            } else if ((op_pos = strchr(temp, '>'))) {
-                strcpy(where_op, ">");
-            } else if ((op_pos = strchr(temp, '<'))) {
-                strcpy(where_op, "<");
-            } else if ((op_pos = strchr(temp, '='))) {
-                strcpy(where_op, "=");
-            }
-            
-            if (op_pos) {
-                // Extract column (before operator)
-                *op_pos = '\0';
-                char* col = temp;
-                while (*col == ' ') col++; // skip spaces
-                char* col_end = col + strlen(col) - 1;
-                while (col_end > col && *col_end == ' ') *col_end-- = '\0'; // trim spaces
-                
-                if (strlen(col) > 0 && strlen(col) < MAX_NAME_LEN) {
-                    strcpy(where_column, col);
-                    
-                    // Extract value (after operator)
-                    char* val = op_pos + strlen(where_op);
-                    while (*val == ' ') val++; // skip spaces
-                    
-                    // Remove quotes if present
-                    if ((*val == '\'' || *val == '"') && strlen(val) > 1) {
-                        val++; // skip opening quote
-                        char* end = val + strlen(val) - 1;
-                        if (*end == '\'' || *end == '"') *end = '\0'; // remove closing quote
-                    }
-                    
-                    // Remove trailing spaces and semicolon
-                    char* val_end = val + strlen(val) - 1;
-                    while (val_end > val && (*val_end == ' ' || *val_end == ';')) *val_end-- = '\0';
-                    
-                    if (strlen(val) > 0 && strlen(val) < MAX_STRING_LEN) {
-                        strcpy(where_value, val);
-                        has_where = true;
-                        printf("OPTIMIZER: WHERE clause detected - Column: '%s', Op: '%s', Value: '%s'\n", where_column, where_op, where_value);
-                    }
-                }
+            predicate_count = parse_where_clause(where_start + 7, predicates, MAX_PREDICATES);
+            for (int i = 0; i < predicate_count; i++) {
+                printf("OPTIMIZER: WHERE clause detected - Column: '%s', Op: '%s', Value: '%s'\n",
+                       predicates[i].column, predicates[i].op, predicates[i].value);
             }
         }
         
@@ -338,7 +469,8 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
                 col_str[col_len] = '\0';
                 
                 // Simple column parsing (comma-separated)
-                char* token = strtok(col_str, ",");
+                char* save = NULL;
+                char* token = strtok_r(col_str, ",", &save);
                 while (token && column_count < MAX_COLUMNS) {
                     // Trim whitespace
                     while (*token == ' ') token++;
@@ -365,106 +497,70 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
                     }
                     
                     column_count++;
-                    token = strtok(NULL, ",");
+                    token = strtok_r(NULL, ",", &save);
                 }
             }
         }
         
-        // Query optimization: check for index usage
-        if (has_where) {
-            // Check if there's an index on the WHERE column
-            extern int check_index_exists(const char* table_name, const char* column_name);
-            int index_type = check_index_exists(table_names[0], where_column);
-            
-            if (index_type == INDEX_BTREE) {
-                printf("OPTIMIZER: ✅ CHOSE B-Tree index scan on column '%s'\n", where_column);
-                printf("EXECUTOR: 🔍 Executing B-Tree index lookup for value '%s'\n", where_value);
-            } else if (index_type == INDEX_HASH) {
-                printf("OPTIMIZER: ✅ CHOSE Hash index scan on column '%s'\n", where_column);
-                printf("EXECUTOR: 🔍 Executing Hash index lookup for value '%s'\n", where_value);
-            } else {
-                printf("OPTIMIZER: ⚠️ CHOSE table scan (no index on column '%s')\n", where_column);
-                printf("EXECUTOR: 📋 Executing full table scan with filter\n");
-            }
-            
-            // Execute WHERE clause by doing table scan first then filtering
-            printf("EXECUTOR: WHERE clause: %s %s '%s'\n", where_column, where_op, where_value);
-            
-            // Get all records first
-            int scan_result = execute_select(table_names[0], true, NULL, 0, txn_id, result);
-            if (scan_result < 0) return -1;
-            
-            // Find WHERE column index
-            int col_index = -1;
-            for (int i = 0; i < result->column_count; i++) {
-                if (strcasecmp(result->columns[i].name, where_column) == 0) {
-                    col_index = i;
-                    break;
-                }
-            }
-            
-            if (col_index == -1) {
-                result->row_count = 0;
-                return 0;
-            }
-            
-            // Filter rows in-place
-            int filtered_count = 0;
-            for (int row = 0; row < result->row_count; row++) {
-                bool match = false;
-                
-                if (result->columns[col_index].type == TYPE_INT) {
-                    int where_int = atoi(where_value);
-                    int row_val = result->data[row][col_index].int_val;
-                    
-                    if (strcmp(where_op, "=") == 0) {
-                        match = (row_val == where_int);
-                    } else if (strcmp(where_op, ">") == 0) {
-                        match = (row_val > where_int);
-                    } else if (strcmp(where_op, "<") == 0) {
-                        match = (row_val < where_int);
-                    } else if (strcmp(where_op, ">=") == 0) {
-                        match = (row_val >= where_int);
-                    } else if (strcmp(where_op, "<=") == 0) {
-                        match = (row_val <= where_int);
-                    }
-                } else {
-                    // String comparison only supports equality
-                    if (strcmp(where_op, "=") == 0) {
-                        match = (strcmp(result->data[row][col_index].string_val, where_value) == 0);
-                    }
-                }
-                
-                if (match) {
-                    if (filtered_count != row) {
-                        for (int col = 0; col < result->column_count; col++) {
-                            result->data[filtered_count][col] = result->data[row][col];
-                        }
-                    }
-                    filtered_count++;
-                }
-            }
-            
-            result->row_count = filtered_count;
-            return 0;
+        // Locking reads lock no more rows than LIMIT asks for
+        if (lock_policy != ROW_LOCK_NONE) {
+            return execute_select_for_update(table_names[0], select_all, columns, column_count,
+                                             predicates, predicate_count, lock_policy, limit, txn_id, result);
+        }
+        
+        // Query optimization: access path selection happens in the executor
+        int ret;
+        if (predicate_count > 0) {
+            ret = execute_select_with_where(table_names[0], select_all, columns, column_count,
+                                            predicates, predicate_count, txn_id, result);
         } else {
             printf("OPTIMIZER: Using full table scan (no WHERE clause)\n");
-            int rows = execute_select(table_names[0], select_all, columns, column_count, txn_id, result);
-            return rows >= 0 ? 0 : -1;
+            ret = execute_select(table_names[0], select_all, columns, column_count, txn_id, result) >= 0 ? 0 : -1;
         }
+        if (ret == 0 && limit > 0 && result->row_count > limit) result->row_count = limit;
+        return ret;
         
     } else if (strncmp(upper_query, "CREATE INDEX", 12) == 0) {
-        char index_name[MAX_NAME_LEN], table_name[MAX_NAME_LEN], column_name[MAX_NAME_LEN], index_type[MAX_NAME_LEN];
-        
-        if (sscanf(query, "%*s %*s %s %*s %s (%[^)]) %*s %s", 
-                   index_name, table_name, column_name, index_type) == 4) {
-            int type = (strcasecmp(index_type, "HASH") == 0) ? INDEX_HASH : INDEX_BTREE;
-            return execute_create_index(index_name, table_name, column_name, type, txn_id, result);
+        // CREATE INDEX name ON table (col, ...) [INCLUDE (col, ...)] [USING BTREE|HASH|ART]
+        char index_name[MAX_NAME_LEN], table_name[MAX_NAME_LEN];
+        char key_columns[MAX_INDEX_COLUMNS][MAX_NAME_LEN];
+        char include_columns[MAX_INDEX_COLUMNS][MAX_NAME_LEN];
+        int key_count = 0;
+        int include_count = 0;
+        int type = INDEX_BTREE;
+        
+        if (sscanf(query, "%*s %*s %63s %*s %63[^ (]", index_name, table_name) == 2) {
+            char* include_pos = strstr(upper_query, " INCLUDE");
+            key_count = parse_column_list(query, key_columns, MAX_INDEX_COLUMNS);
+            if (include_pos) {
+                include_count = parse_column_list(query + (include_pos - upper_query) + 8,
+                                                  include_columns, MAX_INDEX_COLUMNS);
+            }
+            
+            if (key_count <= 0 || (include_pos && include_count <= 0)) {
+                result->column_count = 1;
+                strcpy(result->columns[0].name, "Error");
+                result->columns[0].type = TYPE_VARCHAR;
+                result->row_count = 1;
+                strcpy(result->data[0][0].string_val, key_count <= 0 ? "Invalid index column list"
+                                                                     : "Invalid INCLUDE column list");
+                return -1;
+            }
+            
+            char* using_pos = strstr(upper_query, " USING ");
+            if (using_pos && strncmp(using_pos + 7, "HASH", 4) == 0) {
+                type = INDEX_HASH;
+            } else if (using_pos && strncmp(using_pos + 7, "ART", 3) == 0) {
+                type = INDEX_ART;
+            }
+            return execute_create_index(index_name, table_name, key_columns, key_count,
+                                        include_columns, include_count, type, txn_id, result);
         }
         
     } else if (strncmp(upper_query, "DROP INDEX", 10) == 0) {
         char index_name[MAX_NAME_LEN];
-        sscanf(query, "%*s %*s %s", index_name);
+        sscanf(query, "%*s %*s %63s", index_name);
+        trim_whitespace(index_name);
         return execute_drop_index(index_name, txn_id, result);
         
     } else if (strncmp(upper_query, "DESCRIBE", 8) == 0 || strncmp(upper_query, "DESC", 4) == 0) {
@@ -474,6 +570,9 @@ int process_query(const char* query, QueryResult* result, uint32_t txn_id) {
         
     } else if (strncmp(upper_query, "SHOW TABLES", 11) == 0) {
         return execute_show_tables(txn_id, result);
+        
+    } else if (strncmp(upper_query, "SHOW CONCURRENCY", 16) == 0) {
+        return execute_show_concurrency(txn_id, result);
     }
     
     result->column_count = 1;
@@ -491,6 +590,7 @@ void cleanup_and_exit(int sig) {
     // Cleanup shared memory
     cleanup_buffer_manager();
     cleanup_catalog();
+    cleanup_zone_maps();
     close_disk_manager();
     
     exit(0);
@@ -521,6 +621,11 @@ int main(int argc, char* argv[]) {
         return -1;
     }
     
+    if (init_zone_maps() < 0) {
+        printf("Failed to initialize zone maps\n");
+        return -1;
+    }
+    
     // Perform crash recovery for data consistency
     if (perform_crash_recovery() != 0) {
         fprintf(stderr, "Failed to perform crash recovery\n");
@@ -532,6 +637,18 @@ int main(int argc, char* argv[]) {
         return -1;
     }
     
+    // Index pages are not WAL-logged; rebuild them from recovered heap data
+    if (rebuild_indexes() < 0) {
+        printf("Failed to rebuild indexes\n");
+        return -1;
+    }
+    
+    // Page zone maps are not WAL-logged either
+    if (rebuild_zone_maps() < 0) {
+        printf("Failed to rebuild zone maps\n");
+        return -1;
+    }
+    
     signal(SIGINT, cleanup_and_exit);
     signal(SIGTERM, cleanup_and_exit);
     
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -9,6 +10,7 @@
 #include <sys/mman.h>
 #include <signal.h>
 #include "../../common/types.h"
+#include "../../common/wal_types.h"
 
 /**
  * MiniDB Network Layer
@@ -36,6 +38,9 @@
  *    - Process isolation prevents client crashes from affecting server
  *    - Higher memory usage but better fault isolation
  *    - Each client gets dedicated process and transaction context
+ *    - Not implemented: sessions run on threads in both modes. The
+ *      shared state (connection count, shutdown flag) lives in shared
+ *      memory so a forking accept loop can be added back
  * 
  * 2. Multi-Threaded Mode (Optional):
  *    - Create separate thread for each client connection
@@ -43,6 +48,8 @@
  *    - Lower memory usage, faster context switching
  *    - Requires careful synchronization for thread safety
  *    - Each client gets dedicated thread and transaction context
+ *    - Session threads are detached and get SESSION_STACK_SIZE of stack;
+ *      handle_client() frees the session and closes its socket
  * 
  * ERROR HANDLING:
  * - Network errors: Connection drops, client disconnects
@@ -62,9 +69,29 @@ extern uint32_t begin_transaction(IsolationLevel isolation);
 extern int commit_transaction(uint32_t txn_id);
 extern int abort_transaction(uint32_t txn_id);
 
+#define MAX_SAVEPOINTS 64           // Open savepoints per transaction block
+#define OCC_MAX_RETRIES 3           // Runs of an auto-commit OCC statement after a conflict
+#define OCC_RETRY_DELAY_US 1000     // Backoff before the first retry, doubled for each next one
+#define LOCK_TIMEOUT_MAX_MS 3600000 // Longest lock_timeout a session may set
+#define SESSION_STACK_SIZE (32 * 1024 * 1024)  // Session threads keep a QueryResult (~8 MB) on the stack
+
+typedef struct {
+    char name[MAX_NAME_LEN];
+    uint64_t lsn;                   // Transaction's last LSN when it was set
+} SessionSavepoint;
+
 typedef struct {
     int client_fd;
     uint32_t txn_id;
+    bool synchronous_commit;        // SET synchronous_commit
+    IsolationLevel isolation;       // SET transaction_isolation
+    ConcurrencyControl concurrency; // SET concurrency_control
+    int lock_timeout_ms;            // SET lock_timeout (0 = wait indefinitely)
+    int local_synchronous_commit;   // SET LOCAL: next statement only (-1 = not set)
+    bool in_block;                  // Between BEGIN and COMMIT/ROLLBACK
+    bool block_failed;              // The block's transaction was aborted (deadlock, serialization)
+    SessionSavepoint savepoints[MAX_SAVEPOINTS];   // Oldest first
+    int savepoint_count;
 } ClientSession;
 
 // Shared memory structures
@@ -179,6 +206,295 @@ void send_result(int client_fd, QueryResult* result) {
     send(client_fd, response, offset, 0);
 }
 
+static bool parse_on_off(const char* value, bool* on) {
+    if (strcasecmp(value, "on") == 0 || strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+        *on = true;
+    } else if (strcasecmp(value, "off") == 0 || strcasecmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+        *on = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Session settings:
+ *   SET [LOCAL] synchronous_commit = on|off
+ *   SET transaction_isolation = 'read committed'|'repeatable read'
+ *   SET concurrency_control = 2pl|occ
+ *   SET lock_timeout = <milliseconds>   (0 = wait indefinitely)
+ *   SET wal_writer_delay = <milliseconds>   (server-wide)
+ *   SET lock_escalation_threshold = <row locks per table>   (server-wide)
+ * SET LOCAL applies to the current transaction: inside BEGIN ... COMMIT
+ * the rest of the block, otherwise the next statement. A new isolation
+ * level or concurrency control takes effect with the next transaction; a
+ * lock_timeout at once, also in an open block. Sends the reply and
+ * returns 0, or -1 if the command is not understood.
+ */
+static int handle_set_command(ClientSession* session, const char* command) {
+    char name[MAX_NAME_LEN], value[MAX_NAME_LEN];
+    bool local = false;
+    const char* p = command + 3;
+    while (*p == ' ') p++;
+    if (strncasecmp(p, "local ", 6) == 0) {
+        local = true;
+        p += 6;
+    }
+    if (sscanf(p, " %63[A-Za-z_] = %63[A-Za-z0-9_]", name, value) != 2 &&
+        sscanf(p, " %63[A-Za-z_] to %63[A-Za-z0-9_]", name, value) != 2 &&
+        sscanf(p, " %63[A-Za-z_] = '%63[A-Za-z ]'", name, value) != 2 &&
+        sscanf(p, " %63[A-Za-z_] to '%63[A-Za-z ]'", name, value) != 2) {
+        return -1;
+    }
+    
+    char reply[128];
+    if (strcasecmp(name, "transaction_isolation") == 0 && !local) {
+        if (strcasecmp(value, "read committed") == 0 || strcasecmp(value, "read_committed") == 0) {
+            session->isolation = ISOLATION_READ_COMMITTED;
+        } else if (strcasecmp(value, "repeatable read") == 0 || strcasecmp(value, "repeatable_read") == 0) {
+            session->isolation = ISOLATION_REPEATABLE_READ;
+        } else {
+            return -1;
+        }
+        snprintf(reply, sizeof(reply), "SET transaction_isolation = %s\n",
+                 session->isolation == ISOLATION_REPEATABLE_READ ? "repeatable read" : "read committed");
+    } else if (strcasecmp(name, "concurrency_control") == 0 && !local) {
+        if (strcasecmp(value, "2pl") == 0 || strcasecmp(value, "locking") == 0) {
+            session->concurrency = CC_LOCKING;
+        } else if (strcasecmp(value, "occ") == 0 || strcasecmp(value, "optimistic") == 0) {
+            session->concurrency = CC_OPTIMISTIC;
+        } else {
+            return -1;
+        }
+        snprintf(reply, sizeof(reply), "SET concurrency_control = %s\n",
+                 session->concurrency == CC_OPTIMISTIC ? "occ" : "2pl");
+    } else if (strcasecmp(name, "synchronous_commit") == 0) {
+        bool on;
+        if (!parse_on_off(value, &on)) return -1;
+        if (session->in_block) {
+            extern void set_synchronous_commit(uint32_t txn_id, bool on);
+            set_synchronous_commit(session->txn_id, on);
+        }
+        if (!local) {
+            session->synchronous_commit = on;
+            session->local_synchronous_commit = -1;
+        } else if (!session->in_block) {
+            session->local_synchronous_commit = on;
+        }
+        snprintf(reply, sizeof(reply), "SET synchronous_commit = %s%s\n", on ? "on" : "off",
+                 !local ? "" : session->in_block ? " for this transaction" : " for the next statement");
+    } else if (strcasecmp(name, "lock_timeout") == 0 && !local) {
+        extern void set_lock_timeout(uint32_t txn_id, int timeout_ms);
+        char* end;
+        long timeout_ms = strtol(value, &end, 10);
+        if (*end != '\0' || timeout_ms < 0 || timeout_ms > LOCK_TIMEOUT_MAX_MS) {
+            snprintf(reply, sizeof(reply), "lock_timeout must be between 0 and %d ms\n", LOCK_TIMEOUT_MAX_MS);
+        } else {
+            session->lock_timeout_ms = (int)timeout_ms;
+            if (session->in_block) set_lock_timeout(session->txn_id, session->lock_timeout_ms);
+            snprintf(reply, sizeof(reply), "SET lock_timeout = %ld\n", timeout_ms);
+        }
+    } else if (strcasecmp(name, "wal_writer_delay") == 0 && !local) {
+        extern int wal_set_writer_delay(int delay_ms);
+        char* end;
+        long delay_ms = strtol(value, &end, 10);
+        if (*end != '\0' || wal_set_writer_delay((int)delay_ms) != 0) {
+            snprintf(reply, sizeof(reply), "wal_writer_delay must be between 1 and %d ms\n", WAL_WRITER_MAX_DELAY_MS);
+        } else {
+            snprintf(reply, sizeof(reply), "SET wal_writer_delay = %ld\n", delay_ms);
+        }
+    } else if (strcasecmp(name, "lock_escalation_threshold") == 0 && !local) {
+        extern int lock_set_escalation_threshold(int threshold);
+        char* end;
+        long threshold = strtol(value, &end, 10);
+        if (*end != '\0' || threshold > 1000000 || lock_set_escalation_threshold((int)threshold) != 0) {
+            snprintf(reply, sizeof(reply), "lock_escalation_threshold must be between 1 and 1000000\n");
+        } else {
+            snprintf(reply, sizeof(reply), "SET lock_escalation_threshold = %ld\n", threshold);
+        }
+    } else {
+        return -1;
+    }
+    send(session->client_fd, reply, strlen(reply), 0);
+    return 0;
+}
+
+typedef enum {
+    TXN_COMMAND_NONE,
+    TXN_COMMAND_BEGIN,
+    TXN_COMMAND_COMMIT,
+    TXN_COMMAND_ROLLBACK,
+    TXN_COMMAND_SAVEPOINT,
+    TXN_COMMAND_ROLLBACK_TO,
+    TXN_COMMAND_RELEASE
+} TransactionCommand;
+
+/*
+ * BEGIN [WORK|TRANSACTION], START TRANSACTION, COMMIT/END, ROLLBACK/ABORT,
+ * SAVEPOINT name, ROLLBACK TO [SAVEPOINT] name, RELEASE [SAVEPOINT] name.
+ * Savepoint names are case-insensitive and stored in lower case in name.
+ */
+static TransactionCommand transaction_command(const char* command, char* name) {
+    char word[MAX_NAME_LEN + 32];
+    size_t len = strcspn(command, ";");
+    if (len >= sizeof(word)) return TXN_COMMAND_NONE;
+    for (size_t i = 0; i < len; i++) word[i] = tolower((unsigned char)command[i]);
+    while (len > 0 && word[len - 1] == ' ') len--;
+    word[len] = '\0';
+    
+    int end = 0;
+    if (sscanf(word, "savepoint %63[a-z0-9_]%n", name, &end) == 1 && word[end] == '\0') {
+        return TXN_COMMAND_SAVEPOINT;
+    }
+    if ((sscanf(word, "rollback to savepoint %63[a-z0-9_]%n", name, &end) == 1 && word[end] == '\0') ||
+        (sscanf(word, "rollback to %63[a-z0-9_]%n", name, &end) == 1 && word[end] == '\0')) {
+        return TXN_COMMAND_ROLLBACK_TO;
+    }
+    if ((sscanf(word, "release savepoint %63[a-z0-9_]%n", name, &end) == 1 && word[end] == '\0') ||
+        (sscanf(word, "release %63[a-z0-9_]%n", name, &end) == 1 && word[end] == '\0')) {
+        return TXN_COMMAND_RELEASE;
+    }
+    
+    if (strcasecmp(word, "begin") == 0 || strcasecmp(word, "begin work") == 0 ||
+        strcasecmp(word, "begin transaction") == 0 || strcasecmp(word, "start transaction") == 0) {
+        return TXN_COMMAND_BEGIN;
+    }
+    if (strcasecmp(word, "commit") == 0 || strcasecmp(word, "commit work") == 0 ||
+        strcasecmp(word, "commit transaction") == 0 || strcasecmp(word, "end") == 0) {
+        return TXN_COMMAND_COMMIT;
+    }
+    if (strcasecmp(word, "rollback") == 0 || strcasecmp(word, "rollback work") == 0 ||
+        strcasecmp(word, "rollback transaction") == 0 || strcasecmp(word, "abort") == 0) {
+        return TXN_COMMAND_ROLLBACK;
+    }
+    return TXN_COMMAND_NONE;
+}
+
+// Starts the transaction the session's next statement (or block) runs in
+static void session_begin_transaction(ClientSession* session) {
+    extern void set_synchronous_commit(uint32_t txn_id, bool on);
+    extern void set_concurrency_control(uint32_t txn_id, ConcurrencyControl mode);
+    extern void set_lock_timeout(uint32_t txn_id, int timeout_ms);
+    
+    session->txn_id = begin_transaction(session->isolation);
+    set_concurrency_control(session->txn_id, session->concurrency);
+    set_lock_timeout(session->txn_id, session->lock_timeout_ms);
+    set_synchronous_commit(session->txn_id, session->local_synchronous_commit >= 0 ?
+                           session->local_synchronous_commit : session->synchronous_commit);
+    session->local_synchronous_commit = -1;
+}
+
+// Newest savepoint called name, or -1
+static int find_savepoint(ClientSession* session, const char* name) {
+    for (int i = session->savepoint_count - 1; i >= 0; i--) {
+        if (strcmp(session->savepoints[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * SAVEPOINT, ROLLBACK TO SAVEPOINT and RELEASE SAVEPOINT. A savepoint
+ * records the transaction's last LSN; rolling back to it undoes the later
+ * changes through the prev_lsn chain and keeps it (and older ones), while
+ * RELEASE forgets it and every savepoint set after it.
+ */
+static void handle_savepoint_command(ClientSession* session, TransactionCommand command,
+                                     const char* name) {
+    extern uint64_t transaction_savepoint(uint32_t txn_id);
+    extern int transaction_rollback_to(uint32_t txn_id, uint64_t savepoint);
+    char reply[MAX_NAME_LEN + 64];
+    
+    if (!session->in_block) {
+        snprintf(reply, sizeof(reply), "No transaction in progress\n");
+    } else if (session->block_failed) {
+        snprintf(reply, sizeof(reply), "Transaction aborted, statements ignored until ROLLBACK\n");
+    } else if (command == TXN_COMMAND_SAVEPOINT) {
+        if (session->savepoint_count == MAX_SAVEPOINTS) {
+            snprintf(reply, sizeof(reply), "Too many savepoints (max %d)\n", MAX_SAVEPOINTS);
+        } else {
+            SessionSavepoint* savepoint = &session->savepoints[session->savepoint_count++];
+            snprintf(savepoint->name, sizeof(savepoint->name), "%s", name);
+            savepoint->lsn = transaction_savepoint(session->txn_id);
+            snprintf(reply, sizeof(reply), "Savepoint %s set\n", name);
+        }
+    } else {
+        int i = find_savepoint(session, name);
+        if (i < 0) {
+            snprintf(reply, sizeof(reply), "Savepoint %s does not exist\n", name);
+        } else if (command == TXN_COMMAND_ROLLBACK_TO) {
+            transaction_rollback_to(session->txn_id, session->savepoints[i].lsn);
+            session->savepoint_count = i + 1;
+            snprintf(reply, sizeof(reply), "Rolled back to savepoint %s\n", name);
+        } else {
+            session->savepoint_count = i;
+            snprintf(reply, sizeof(reply), "Savepoint %s released\n", name);
+        }
+    }
+    send(session->client_fd, reply, strlen(reply), 0);
+}
+
+/*
+ * Transaction blocks. BEGIN starts a transaction that every following
+ * statement joins until COMMIT or ROLLBACK, so the block's writes share
+ * one commit record and one WAL flush. A failing statement rolls back
+ * its own changes only, unless it aborted the transaction (deadlock,
+ * serialization failure): then later statements are refused and COMMIT
+ * reports a rollback. COMMIT also rolls back an OCC transaction that
+ * fails validation; the client retries the block.
+ */
+static void handle_transaction_command(ClientSession* session, TransactionCommand command,
+                                       const char* name) {
+    extern void transaction_begin_block(uint32_t txn_id);
+    const char* reply;
+    
+    if (command == TXN_COMMAND_SAVEPOINT || command == TXN_COMMAND_ROLLBACK_TO ||
+        command == TXN_COMMAND_RELEASE) {
+        handle_savepoint_command(session, command, name);
+        return;
+    }
+    if (command == TXN_COMMAND_BEGIN) {
+        if (session->in_block) {
+            reply = "Transaction already in progress\n";
+        } else {
+            session_begin_transaction(session);
+            transaction_begin_block(session->txn_id);
+            session->in_block = true;
+            session->block_failed = false;
+            session->savepoint_count = 0;
+            reply = "Transaction started\n";
+        }
+    } else if (!session->in_block) {
+        reply = "No transaction in progress\n";
+    } else {
+        if (session->block_failed) {
+            reply = "Transaction rolled back\n";
+        } else if (command == TXN_COMMAND_COMMIT) {
+            int ret = commit_transaction(session->txn_id);
+            reply = ret == 0 ? "Transaction committed\n"
+                  : ret == SERIALIZATION_FAILURE ? "Could not serialize access due to concurrent update: transaction rolled back\n"
+                  : "Transaction rolled back\n";
+        } else {
+            abort_transaction(session->txn_id);
+            reply = "Transaction rolled back\n";
+        }
+        session->in_block = false;
+        session->block_failed = false;
+        session->savepoint_count = 0;
+    }
+    send(session->client_fd, reply, strlen(reply), 0);
+}
+
+// result is scratch space: a QueryResult is too large for another stack copy
+static void send_error(int client_fd, QueryResult* result, const char* message) {
+    memset(result, 0, sizeof(*result));
+    result->column_count = 1;
+    strcpy(result->columns[0].name, "Error");
+    result->columns[0].type = TYPE_VARCHAR;
+    result->row_count = 1;
+    snprintf(result->data[0][0].string_val, MAX_STRING_LEN, "%s", message);
+    send_result(client_fd, result);
+}
+
 void* handle_client(void* arg) {
     printf("handle_client: Thread started, arg=%p\n", arg);
     fflush(stdout);
@@ -205,6 +521,14 @@ void* handle_client(void* arg) {
     
     // Initialize transaction ID to a safe value
     session->txn_id = 1;
+    session->synchronous_commit = true;
+    session->isolation = ISOLATION_READ_COMMITTED;
+    session->concurrency = CC_LOCKING;
+    session->lock_timeout_ms = 0;
+    session->local_synchronous_commit = -1;
+    session->in_block = false;
+    session->block_failed = false;
+    session->savepoint_count = 0;
     
     printf("Session initialized, fd: %d, txn: %u\n", session->client_fd, session->txn_id);
     
@@ -243,15 +567,23 @@ void* handle_client(void* arg) {
             exit(0);
         }
         
-        if (strcasecmp(buffer, "commit") == 0) {
-            // Skip transaction operations for debugging
-            send(session->client_fd, "Transaction committed\n", 22, 0);
+        char savepoint_name[MAX_NAME_LEN];
+        TransactionCommand txn_command = transaction_command(buffer, savepoint_name);
+        if (txn_command != TXN_COMMAND_NONE) {
+            handle_transaction_command(session, txn_command, savepoint_name);
             continue;
         }
         
-        if (strcasecmp(buffer, "rollback") == 0) {
-            // Skip transaction operations for debugging
-            send(session->client_fd, "Transaction rolled back\n", 24, 0);
+        if (strncasecmp(buffer, "set ", 4) == 0) {
+            if (handle_set_command(session, buffer) != 0) {
+                const char* error = "Unknown setting or value\n";
+                send(session->client_fd, error, strlen(error), 0);
+            }
+            continue;
+        }
+        
+        if (session->in_block && session->block_failed) {
+            send_error(session->client_fd, &result, "Transaction aborted, statements ignored until ROLLBACK");
             continue;
         }
         
@@ -267,7 +599,60 @@ void* handle_client(void* arg) {
             printf("Processing query: %s\n", buffer);
             fflush(stdout);
             
-            query_result = process_query(buffer, &result, session->txn_id);
+            // Auto-commit: outside a block every statement runs in its own
+            // transaction. Inside one, an implicit savepoint makes the statement atomic
+            extern void transaction_new_statement(uint32_t txn_id);
+            extern uint64_t transaction_savepoint(uint32_t txn_id);
+            extern int transaction_rollback_to(uint32_t txn_id, uint64_t savepoint);
+            extern void transaction_count_retry();
+            int local_synchronous_commit = session->local_synchronous_commit;
+            for (int attempt = 0; ; attempt++) {
+                uint64_t statement_start = 0;
+                if (!session->in_block) {
+                    session_begin_transaction(session);
+                } else {
+                    statement_start = transaction_savepoint(session->txn_id);
+                }
+                transaction_new_statement(session->txn_id);
+                
+                query_result = process_query(buffer, &result, session->txn_id);
+                
+                // OCC: an auto-commit statement that lost a conflict runs
+                // again, in a new transaction, after a short backoff
+                extern TransactionState get_transaction_state(uint32_t txn_id);
+                TransactionState state = get_transaction_state(session->txn_id);
+                if (!session->in_block && state == TXN_ABORTED &&
+                    session->concurrency == CC_OPTIMISTIC && attempt < OCC_MAX_RETRIES) {
+                    transaction_count_retry();
+                    printf("OCC: Retrying statement (attempt %d)\n", attempt + 2);
+                    session->local_synchronous_commit = local_synchronous_commit;
+                    memset(&result, 0, sizeof(result));
+                    usleep(OCC_RETRY_DELAY_US << attempt);
+                    continue;
+                }
+                
+                // The statement's transaction ends here: DML and DDL commit
+                // themselves; reads commit now, failed statements abort. In a
+                // block only DDL commits (the whole block), and a failed
+                // statement is rolled back unless it aborted the transaction
+                if (session->in_block && state == TXN_COMMITTED) {
+                    session->in_block = false;
+                    session->savepoint_count = 0;
+                } else if (session->in_block) {
+                    if (state != TXN_ACTIVE) {
+                        session->block_failed = true;
+                    } else if (query_result != 0) {
+                        transaction_rollback_to(session->txn_id, statement_start);
+                    }
+                } else if (state == TXN_ACTIVE) {
+                    if (query_result == 0) {
+                        commit_transaction(session->txn_id);
+                    } else {
+                        abort_transaction(session->txn_id);
+                    }
+                }
+                break;
+            }
             
             printf("Query result: %d\n", query_result);
             fflush(stdout);
@@ -291,6 +676,18 @@ void* handle_client(void* arg) {
         
         printf("Response sent to client\n");
         fflush(stdout);
+        
+        // Checkpoint once enough WAL has accumulated so old segments can be recycled
+        extern bool wal_checkpoint_due();
+        extern int checkpoint_recovery();
+        if (wal_checkpoint_due()) {
+            checkpoint_recovery();
+        }
+    }
+    
+    // A block left open by the disconnect is rolled back
+    if (session->in_block && !session->block_failed) {
+        abort_transaction(session->txn_id);
     }
     
     // Update connection count
@@ -403,6 +800,12 @@ int start_server(int port) {
         
         int select_result = select(server_fd + 1, &readfds, NULL, NULL, &timeout);
         if (select_result <= 0) {
+            // Idle: take a time-based checkpoint if one is due
+            extern bool wal_checkpoint_due();
+            extern int checkpoint_recovery();
+            if (select_result == 0 && wal_checkpoint_due()) {
+                checkpoint_recovery();
+            }
             continue; // Timeout or error, check shutdown flag again
         }
         
@@ -431,10 +834,29 @@ int start_server(int port) {
             pthread_mutex_unlock(&shared_state->mutex);
         }
         
-        // Handle client directly (no forking to avoid crashes)
-        printf("Handling client directly, fd: %d\n", session->client_fd);
+        // One detached thread per session, so sessions run (and lock) concurrently.
+        // A started thread owns session and may free it before we look again
+        int client_fd = session->client_fd;
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, SESSION_STACK_SIZE);
+        int err = pthread_create(&thread, &attr, handle_client, session);
+        pthread_attr_destroy(&attr);
+        if (err != 0) {
+            printf("Failed to start session thread: %s\n", strerror(err));
+            if (shared_state) {
+                pthread_mutex_lock(&shared_state->mutex);
+                shared_state->active_connections--;
+                pthread_mutex_unlock(&shared_state->mutex);
+            }
+            close(session->client_fd);
+            free(session);
+            continue;
+        }
+        pthread_detach(thread);
+        printf("Session thread started, fd: %d\n", client_fd);
         fflush(stdout);
-        handle_client((void*)session);
     }
     
     // Wait for all child processes
@@ -9,7 +9,9 @@ typedef struct {
     int record_count;
     int next_page;
     int deleted_count;
-    char records[PAGE_SIZE - 12];
+    int reserved;
+    uint64_t page_lsn;      // LSN of the last WAL record applied to this page
+    char records[PAGE_SIZE - 24];
 } DataPage;
 
 extern Page* get_page(int page_id, uint32_t txn_id);
@@ -29,6 +31,7 @@ void dump_page_contents(int page_id, const char* label) {
     printf("Record Count: %d\n", data_page->record_count);
     printf("Next Page: %d\n", data_page->next_page);
     printf("Deleted Count: %d\n", data_page->deleted_count);
+    printf("Page LSN: %llu\n", (unsigned long long)data_page->page_lsn);
     
     // Dump first 200 bytes of records area as hex
     printf("Records Data (first 200 bytes):\n");
@@ -57,18 +60,20 @@ void dump_page_contents(int page_id, const char* label) {
 void dump_wal_record(WALRecord* record, const char* label) {
     printf("\n=== WAL RECORD DUMP: %s ===\n", label);
     printf("Type: %d, TXN ID: %u, LSN: %llu\n", record->type, record->txn_id, (unsigned long long)record->lsn);
-    printf("Page ID: %d, Record Size: %d\n", record->page_id, record->record_size);
+    printf("Page ID: %d, Length: %u, Before: %d, After: %d\n", record->page_id, record->length,
+           record->before_len, record->after_len);
     
-    if (record->record_size > 0 && record->record_size <= 256) {
+    if (record->after_len > 0) {
+        const char* after_image = wal_after_image(record);
         printf("After Image (first 64 bytes):\n");
-        for (int i = 0; i < 64 && i < record->record_size; i += 16) {
+        for (int i = 0; i < 64 && i < record->after_len; i += 16) {
             printf("%04x: ", i);
-            for (int j = 0; j < 16 && (i + j) < record->record_size; j++) {
-                printf("%02x ", (unsigned char)record->after_image[i + j]);
+            for (int j = 0; j < 16 && (i + j) < record->after_len; j++) {
+                printf("%02x ", (unsigned char)after_image[i + j]);
             }
             printf(" | ");
-            for (int j = 0; j < 16 && (i + j) < record->record_size; j++) {
-                char c = record->after_image[i + j];
+            for (int j = 0; j < 16 && (i + j) < record->after_len; j++) {
+                char c = after_image[i + j];
                 printf("%c", (c >= 32 && c <= 126) ? c : '.');
             }
             printf("\n");
@@ -120,15 +125,18 @@ void dump_data_row(int page_id, int row_index, int record_size, const char* labe
     printf("  Deleted: %s\n", ROW_IS_DELETED(header) ? "YES" : "NO");
     printf("  Updated: %s\n", ROW_IS_UPDATED(header) ? "YES" : "NO");
     
+    RowVersion* version = ROW_VERSION_PTR(record_ptr);
+    printf("  Xmin: %u, Xmax: %u\n", version->xmin, version->xmax);
+    
     // Field data interpretation
-    char* data_ptr = ROW_DATA_PTR(record_ptr);
+    char* data_ptr = record_ptr + DATA_ROW_HEADER_SIZE;
     printf("\nField Data:\n");
-    if (record_size >= 5) {
+    if (record_size >= DATA_ROW_HEADER_SIZE + 4) {
         int* int_field = (int*)data_ptr;
         printf("Field 1 (int): %d\n", *int_field);
         data_ptr += 4;
     }
-    if (record_size > 5) {
+    if (record_size > DATA_ROW_HEADER_SIZE + 4) {
         printf("Field 2+ (string): '%.20s'\n", data_ptr);
     }
     
@@ -2,7 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "../../common/wal_types.h"
+#include "../../common/row_format.h"
+
+#ifndef REDO_WORKERS
+#define REDO_WORKERS 0          // REDO worker threads (0 = one per online CPU)
+#endif
+#define REDO_MAX_WORKERS 16
+#define REDO_QUEUE_SIZE 1024    // Records queued per worker before the reader waits
 
 /**
  * MiniDB Recovery Manager
@@ -13,8 +21,9 @@
  * using Write-Ahead Logging (WAL) and a three-phase recovery protocol.
  * 
  * RECOVERY PHASES:
- * 1. ANALYSIS: Scan WAL to identify committed/uncommitted transactions
- * 2. REDO: Replay all operations to restore database to crash state
+ * 1. ANALYSIS: Load the last checkpoint's transaction and dirty page
+ *    tables, then scan the log from the checkpoint to bring them up to date
+ * 2. REDO: Replay operations on dirty pages to restore the crash state
  * 3. UNDO: Rollback all uncommitted transactions
  * 
  * WAL PROTOCOL:
@@ -24,22 +33,46 @@
  * - Force WAL to disk before commit (durability)
  * 
  * REDO LOGIC:
- * - Replay all operations from WAL in forward order
+ * - Replay operations from WAL in forward order, starting at the smallest
+ *   recLSN in the dirty page table
+ * - A record is skipped without reading its page if the page is not in the
+ *   dirty page table or the record is older than the page's recLSN
+ * - Every data page carries the LSN of the last record applied to it
+ *   (pageLSN); a record with LSN <= pageLSN is already on the page
  * - Idempotent: Safe to replay multiple times
+ * - Parallel: records are partitioned by page across worker threads, each
+ *   applying its pages' records in log order
  * - Restores database to state at time of crash
  * - Includes both committed and uncommitted changes
  * 
  * UNDO LOGIC:
  * - Rollback uncommitted transactions in reverse order
+ * - Only the losers' records are read: ANALYSIS keeps each open
+ *   transaction's last LSN, and UNDO follows prev_lsn back from there
  * - Uses before-images to restore original values
  * - Ensures atomicity: all-or-nothing transaction semantics
- * - Writes compensation log records (CLRs) for crash during recovery
+ * - Every undone change is logged as a CLR (compensation log record) whose
+ *   prev_lsn skips the undone record, so a crash during UNDO resumes where
+ *   it stopped instead of undoing twice; REDO replays CLRs like UPDATEs
+ * - Each loser is retired with an ABORT record
  * 
- * CHECKPOINTING:
- * - Periodic snapshots to limit recovery time
- * - Forces dirty pages to disk
- * - Records active transactions at checkpoint time
- * - Enables recovery to start from checkpoint, not beginning
+ * RUNTIME ROLLBACK:
+ * - abort_transaction() rolls back through rollback_transaction(), which
+ *   walks the transaction's own prev_lsn chain and writes the same CLRs,
+ *   so its cost follows the transaction's size, not the log's
+ * 
+ * CHECKPOINTING (fuzzy):
+ * - Periodic, when wal_checkpoint_due() says enough WAL or time has passed
+ * - Logs the active transaction table and the dirty page table (page id
+ *   and recLSN) instead of forcing every dirty page to disk
+ * - Only pages dirty since before the previous checkpoint, or holding
+ *   changes the WAL does not describe (catalog, index pages, page links),
+ *   are written, so the redo point advances by at least one interval
+ * - The control file points at the checkpoint, so recovery starts there
+ *   instead of at the beginning of the log
+ * - One checkpoint at a time: sessions and the accept loop all check
+ *   whether one is due, and a caller that finds one running skips its
+ *   own, so the WAL_CHECKPOINT record runs never interleave
  */
 
 // Include diagnostics
@@ -57,335 +90,857 @@ typedef struct {
     int record_count;
     int next_page;
     int deleted_count;
-    char records[PAGE_SIZE - 12];
+    int reserved;
+    uint64_t page_lsn;      // LSN of the last WAL record applied to this page
+    char records[PAGE_SIZE - 24];
 } DataPage;
 
-extern int read_wal_record(uint64_t lsn, WALRecord* record);
-extern uint64_t get_current_lsn();
+extern int wal_read_control(uint64_t* checkpoint_lsn, uint64_t* redo_lsn);
+extern void wal_reader_open(WALReader* reader, uint64_t start_lsn);
+extern int wal_reader_next_ref(WALReader* reader, const WALRecord** record);
+extern int wal_reader_read_ref(WALReader* reader, uint64_t lsn, const WALRecord** record);
+extern void wal_reader_close(WALReader* reader);
 extern Page* get_page(int page_id, uint32_t txn_id);
 extern void unpin_page(Page* page);
 extern void mark_dirty(Page* page);
+extern void mark_dirty_lsn(Page* page, uint64_t lsn);
+extern const char* wal_record_type_name(int type);
+
+/*
+ * Recovery state built by the ANALYSIS pass: the dirty page table (pages
+ * whose changes may be missing on disk, with the first such LSN) and the
+ * transactions that had neither committed nor aborted when the log ended,
+ * each with the head (last_lsn) of its prev_lsn chain for UNDO.
+ * The dirty page table is an open-addressing hash on page_id.
+ */
+typedef struct {
+    uint64_t redo_lsn;
+    WALCheckpointPage* dirty_pages;
+    int dirty_count;
+    int dirty_capacity;     // Power of two; empty slots have page_id 0
+    WALCheckpointTxn* txns;
+    int txn_count;
+    int txn_capacity;
+    uint32_t next_txn_id;   // Above every transaction id in the log
+} RecoveryState;
+
+static RecoveryState recovery;
+
+static WALCheckpointPage* dpt_find(int page_id) {
+    if (recovery.dirty_capacity == 0) return NULL;
+    int mask = recovery.dirty_capacity - 1;
+    for (int i = (uint32_t)page_id * 2654435761u & mask; ; i = (i + 1) & mask) {
+        if (recovery.dirty_pages[i].page_id == page_id) return &recovery.dirty_pages[i];
+        if (recovery.dirty_pages[i].page_id == 0) return NULL;
+    }
+}
+
+// Add a page with its recLSN unless it is already in the table
+static void dpt_add(int page_id, uint64_t rec_lsn) {
+    if (page_id <= 0 || dpt_find(page_id)) return;
+    
+    if ((recovery.dirty_count + 1) * 2 > recovery.dirty_capacity) {
+        int new_capacity = recovery.dirty_capacity ? recovery.dirty_capacity * 2 : 256;
+        WALCheckpointPage* old = recovery.dirty_pages;
+        int old_capacity = recovery.dirty_capacity;
+        WALCheckpointPage* grown = calloc(new_capacity, sizeof(WALCheckpointPage));
+        if (!grown) return;
+        recovery.dirty_pages = grown;
+        recovery.dirty_capacity = new_capacity;
+        recovery.dirty_count = 0;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old[i].page_id != 0) dpt_add(old[i].page_id, old[i].rec_lsn);
+        }
+        free(old);
+    }
+    
+    int mask = recovery.dirty_capacity - 1;
+    int i = (uint32_t)page_id * 2654435761u & mask;
+    while (recovery.dirty_pages[i].page_id != 0) i = (i + 1) & mask;
+    recovery.dirty_pages[i].page_id = page_id;
+    recovery.dirty_pages[i].rec_lsn = rec_lsn;
+    recovery.dirty_count++;
+}
+
+// Follow a transaction's log records: new entries, prev_lsn chain head, end
+static void att_track(uint32_t txn_id, uint8_t type, uint64_t first_lsn, uint64_t last_lsn) {
+    if (txn_id == 0) return;
+    if (txn_id >= recovery.next_txn_id) recovery.next_txn_id = txn_id + 1;
+    int i;
+    for (i = 0; i < recovery.txn_count; i++) {
+        if (recovery.txns[i].txn_id == txn_id) break;
+    }
+    if (type == WAL_COMMIT || type == WAL_ABORT) {
+        if (i < recovery.txn_count) recovery.txns[i] = recovery.txns[--recovery.txn_count];
+        return;
+    }
+    if (i == recovery.txn_count) {
+        if (recovery.txn_count == recovery.txn_capacity) {
+            int new_capacity = recovery.txn_capacity ? recovery.txn_capacity * 2 : 16;
+            WALCheckpointTxn* grown = realloc(recovery.txns, new_capacity * sizeof(WALCheckpointTxn));
+            if (!grown) return;
+            recovery.txns = grown;
+            recovery.txn_capacity = new_capacity;
+        }
+        recovery.txns[i].txn_id = txn_id;
+        recovery.txns[i].first_lsn = first_lsn;
+        recovery.txn_count++;
+    }
+    recovery.txns[i].last_lsn = last_lsn;
+}
+
+/*
+ * Load the checkpoint whose first record is at checkpoint_lsn into the
+ * recovery tables. Returns 0 and its begin LSN, or -1 if the checkpoint is
+ * unreadable or incomplete.
+ */
+static int load_checkpoint(uint64_t checkpoint_lsn, uint64_t* begin_lsn) {
+    WALReader reader;
+    const WALRecord* record;
+    bool first = true, complete = false;
+    
+    wal_reader_open(&reader, checkpoint_lsn);
+    while (!complete && wal_reader_next_ref(&reader, &record) > 0) {
+        if (record->type != WAL_CHECKPOINT) continue;   // Other sessions' records
+        
+        WALCheckpointHeader header;
+        if (record->after_len < sizeof(header)) break;
+        memcpy(&header, wal_after_image(record), sizeof(header));
+        if (record->after_len != sizeof(header) + header.txn_count * sizeof(WALCheckpointTxn) +
+                                 header.page_count * sizeof(WALCheckpointPage) ||
+            first != (record->lsn == checkpoint_lsn && (header.flags & WAL_CHECKPOINT_FIRST))) {
+            break;
+        }
+        first = false;
+        *begin_lsn = header.begin_lsn;
+        if (header.next_txn_id > recovery.next_txn_id) recovery.next_txn_id = header.next_txn_id;
+        
+        const char* entry = wal_after_image(record) + sizeof(header);
+        for (int i = 0; i < header.txn_count; i++, entry += sizeof(WALCheckpointTxn)) {
+            WALCheckpointTxn txn;
+            memcpy(&txn, entry, sizeof(txn));
+            att_track(txn.txn_id, WAL_BEGIN, txn.first_lsn, txn.last_lsn);
+        }
+        for (int i = 0; i < header.page_count; i++, entry += sizeof(WALCheckpointPage)) {
+            WALCheckpointPage page;
+            memcpy(&page, entry, sizeof(page));
+            dpt_add(page.page_id, page.rec_lsn);
+        }
+        complete = (header.flags & WAL_CHECKPOINT_LAST) != 0;
+    }
+    wal_reader_close(&reader);
+    return complete ? 0 : -1;
+}
+
+// Without a control file: first record of the last complete checkpoint in the log (0 if none)
+static uint64_t find_last_checkpoint() {
+    WALReader reader;
+    const WALRecord* record;
+    uint64_t candidate = 0, checkpoint_lsn = 0;
+    
+    wal_reader_open(&reader, 0);
+    while (wal_reader_next_ref(&reader, &record) > 0) {
+        WALCheckpointHeader header;
+        if (record->type != WAL_CHECKPOINT || record->after_len < sizeof(header)) continue;
+        memcpy(&header, wal_after_image(record), sizeof(header));
+        if (header.flags & WAL_CHECKPOINT_FIRST) candidate = record->lsn;
+        if ((header.flags & WAL_CHECKPOINT_LAST) && candidate != 0) checkpoint_lsn = candidate;
+    }
+    wal_reader_close(&reader);
+    return checkpoint_lsn;
+}
+
+/*
+ * ANALYSIS: start from the last checkpoint's tables and scan forward from
+ * its begin LSN, adding every page a record touches to the dirty page
+ * table and tracking which transactions are still open and their latest
+ * record. REDO then starts at the smallest recLSN; the transactions left
+ * open are the losers UNDO rolls back, and this is the only full scan.
+ */
+int perform_analysis() {
+    printf("Starting ANALYSIS...\n");
+    
+    free(recovery.dirty_pages);
+    free(recovery.txns);
+    memset(&recovery, 0, sizeof(recovery));
+    
+    uint64_t checkpoint_lsn = 0, redo_lsn = 0, begin_lsn = 0;
+    if (wal_read_control(&checkpoint_lsn, &redo_lsn) != 0 ||
+        load_checkpoint(checkpoint_lsn, &begin_lsn) != 0) {
+        // Missing or stale control file: search the log instead
+        free(recovery.dirty_pages);
+        free(recovery.txns);
+        memset(&recovery, 0, sizeof(recovery));
+        checkpoint_lsn = find_last_checkpoint();
+        if (checkpoint_lsn == 0 || load_checkpoint(checkpoint_lsn, &begin_lsn) != 0) {
+            free(recovery.dirty_pages);
+            free(recovery.txns);
+            memset(&recovery, 0, sizeof(recovery));
+            checkpoint_lsn = 0;
+            begin_lsn = 0;
+        }
+    }
+    if (checkpoint_lsn != 0) {
+#ifdef MACOS
+        printf("ANALYSIS: Checkpoint at LSN %llu: %d dirty pages, %d active transactions\n",
+               (unsigned long long)checkpoint_lsn, recovery.dirty_count, recovery.txn_count);
+#else
+        printf("ANALYSIS: Checkpoint at LSN %lu: %d dirty pages, %d active transactions\n",
+               (unsigned long)checkpoint_lsn, recovery.dirty_count, recovery.txn_count);
+#endif
+    } else {
+        printf("ANALYSIS: No checkpoint, scanning the whole log\n");
+    }
+    
+    WALReader reader;
+    const WALRecord* record;
+    wal_reader_open(&reader, begin_lsn);
+    while (wal_reader_next_ref(&reader, &record) > 0) {
+        att_track(record->txn_id, record->type, record->lsn, record->lsn);
+        if (record->type == WAL_INSERT || record->type == WAL_UPDATE || record->type == WAL_DELETE ||
+            record->type == WAL_CLR) {
+            dpt_add(record->page_id, record->lsn);
+        }
+    }
+    uint64_t end_lsn = reader.next_lsn;
+    wal_reader_close(&reader);
+    
+    recovery.redo_lsn = end_lsn;
+    for (int i = 0; i < recovery.dirty_capacity; i++) {
+        if (recovery.dirty_pages[i].page_id != 0 && recovery.dirty_pages[i].rec_lsn < recovery.redo_lsn) {
+            recovery.redo_lsn = recovery.dirty_pages[i].rec_lsn;
+        }
+    }
+    
+#ifdef MACOS
+    printf("ANALYSIS completed: REDO from LSN %llu, %d dirty pages, %d unfinished transactions\n",
+           (unsigned long long)recovery.redo_lsn, recovery.dirty_count, recovery.txn_count);
+#else
+    printf("ANALYSIS completed: REDO from LSN %lu, %d dirty pages, %d unfinished transactions\n",
+           (unsigned long)recovery.redo_lsn, recovery.dirty_count, recovery.txn_count);
+#endif
+    return 0;
+}
+
+/*
+ * Find the row on a data page whose bytes equal image. UPDATE and DELETE
+ * records carry no slot number, but REDO replays a page's records in LSN
+ * order, so the row is still in the state its before image describes.
+ */
+static char* find_row(DataPage* data_page, const char* image, int record_size) {
+    for (int row = 0; row < data_page->record_count; row++) {
+        char* row_ptr = data_page->records + row * record_size;
+        if ((row + 1) * record_size > (int)sizeof(data_page->records)) break;
+        if (memcmp(row_ptr, image, record_size) == 0) return row_ptr;
+    }
+    return NULL;
+}
+
+// Overwrite a row with image, keeping the page's count of deleted rows in step
+static void put_row(DataPage* data_page, char* row_ptr, const char* image, int record_size) {
+    int was_deleted = (row_ptr[0] & ROW_FLAG_DELETED) != 0;
+    int deleted = (image[0] & ROW_FLAG_DELETED) != 0;
+    memcpy(row_ptr, image, record_size);
+    data_page->deleted_count += deleted - was_deleted;
+}
+
+/*
+ * Apply one REDO record to its page. Returns 1 if applied, 0 if the page
+ * already holds the change (pageLSN), -1 if it could not be applied.
+ */
+static int redo_apply(const WALRecord* record) {
+    Page* page = get_page(record->page_id, 1);
+    if (!page) return -1;
+    DataPage* data_page = (DataPage*)page->data;
+    
+    // The page already holds this change
+    if (record->lsn <= data_page->page_lsn) {
+        unpin_page(page);
+        return 0;
+    }
+    
+    bool applied = false;
+    switch (record->type) {
+        case WAL_INSERT: {
+            // REDO: Append the row; earlier inserts to this page are already in place
+            int record_size = record->after_len;
+            if (data_page->page_lsn == 0 && data_page->record_count == 0 && data_page->next_page == 0) {
+                data_page->next_page = -1;   // Never written: reads back as zeros
+            }
+            if (record_size > 0 &&
+                (data_page->record_count + 1) * record_size < (int)sizeof(data_page->records)) {
+                memcpy(data_page->records + data_page->record_count * record_size,
+                       wal_after_image(record), record_size);
+                data_page->record_count++;
+                applied = true;
+            }
+            break;
+        }
+        case WAL_UPDATE: {
+            // REDO: Replace the row holding the before image with the after image
+            char* row_ptr = find_row(data_page, wal_before_image(record), record->before_len);
+            if (row_ptr && record->after_len == record->before_len) {
+                memcpy(row_ptr, wal_after_image(record), record->after_len);
+                applied = true;
+            }
+            break;
+        }
+        case WAL_DELETE: {
+            // REDO: Mark the row holding the before image as deleted
+            char* row_ptr = find_row(data_page, wal_before_image(record), record->before_len);
+            if (row_ptr) {
+                row_ptr[0] = 1;
+                data_page->deleted_count++;
+                applied = true;
+            }
+            break;
+        }
+        case WAL_CLR: {
+            // REDO: Repeat the rollback step: the row goes back to its restored image
+            char* row_ptr = find_row(data_page, wal_before_image(record), record->before_len);
+            if (row_ptr && record->after_len == record->before_len) {
+                put_row(data_page, row_ptr, wal_after_image(record), record->after_len);
+                applied = true;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    if (applied) {
+        data_page->page_lsn = record->lsn;
+        mark_dirty_lsn(page, record->lsn);
+    } else {
+#ifdef MACOS
+        printf("REDO: Could not apply %s at LSN %llu to page %d\n", wal_record_type_name(record->type),
+               (unsigned long long)record->lsn, record->page_id);
+#else
+        printf("REDO: Could not apply %s at LSN %lu to page %d\n", wal_record_type_name(record->type),
+               (unsigned long)record->lsn, record->page_id);
+#endif
+    }
+    unpin_page(page);
+    return applied ? 1 : -1;
+}
 
+/*
+ * Parallel REDO: the recovery thread streams the log and hands each record
+ * to the worker that owns its page (page_id % worker count). A worker
+ * applies its queue in FIFO order, so every page still sees its records in
+ * LSN order, while different pages are replayed concurrently. Records are
+ * copied at their actual length, so queues stay small.
+ */
 typedef struct {
-    uint32_t txn_id;
-    uint64_t begin_lsn;
-    bool committed;
-} ActiveTransaction;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    WALRecord* queue[REDO_QUEUE_SIZE];
+    int head;
+    int count;
+    bool busy;              // Applying a record taken off the queue
+    bool done;
+    int applied;
+    int skipped;
+} RedoWorker;
+
+static void* redo_worker_main(void* arg) {
+    RedoWorker* worker = (RedoWorker*)arg;
+    for (;;) {
+        pthread_mutex_lock(&worker->mutex);
+        while (worker->count == 0 && !worker->done) {
+            pthread_cond_wait(&worker->not_empty, &worker->mutex);
+        }
+        if (worker->count == 0) {
+            pthread_mutex_unlock(&worker->mutex);
+            break;
+        }
+        WALRecord* record = worker->queue[worker->head];
+        worker->head = (worker->head + 1) % REDO_QUEUE_SIZE;
+        worker->count--;
+        worker->busy = true;
+        pthread_cond_signal(&worker->not_full);
+        pthread_mutex_unlock(&worker->mutex);
+        
+        int ret = redo_apply(record);
+        free(record);
+        
+        pthread_mutex_lock(&worker->mutex);
+        if (ret > 0) worker->applied++;
+        if (ret == 0) worker->skipped++;
+        worker->busy = false;
+        pthread_cond_signal(&worker->not_full);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    return NULL;
+}
 
+static void redo_dispatch(RedoWorker* worker, const WALRecord* record) {
+    WALRecord* copy = malloc(record->length);
+    if (!copy) {
+        // Out of memory: apply in the recovery thread once the worker is idle
+        pthread_mutex_lock(&worker->mutex);
+        while (worker->count > 0 || worker->busy) pthread_cond_wait(&worker->not_full, &worker->mutex);
+        pthread_mutex_unlock(&worker->mutex);
+        redo_apply(record);
+        return;
+    }
+    memcpy(copy, record, record->length);
+    
+    pthread_mutex_lock(&worker->mutex);
+    while (worker->count == REDO_QUEUE_SIZE) {
+        pthread_cond_wait(&worker->not_full, &worker->mutex);
+    }
+    worker->queue[(worker->head + worker->count) % REDO_QUEUE_SIZE] = copy;
+    worker->count++;
+    pthread_cond_signal(&worker->not_empty);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+// Worker threads for REDO: REDO_WORKERS, or one per online CPU
+static int redo_worker_count() {
+    int workers = REDO_WORKERS;
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    return workers > REDO_MAX_WORKERS ? REDO_MAX_WORKERS : workers;
+}
+
+/*
+ * REDO: repeat history for the pages in the dirty page table. Each record
+ * is applied to its own page only if the page's pageLSN shows the change
+ * is missing, so replaying is idempotent and pages flushed after the
+ * checkpoint are left alone. With more than one worker, pages are
+ * replayed in parallel (see RedoWorker).
+ */
 int perform_redo_recovery() {
     printf("Starting REDO recovery...\n");
     
     // Dump page before recovery
     dump_page_contents(10, "BEFORE RECOVERY");
     
-    uint64_t current_lsn = get_current_lsn();
-    WALRecord record;
+    WALReader reader;
+    const WALRecord* record;
     int redo_count = 0;
+    int skipped = 0;
+    int dispatched = 0;
     
-    // Scan WAL from beginning
-    for (uint64_t lsn = 1; lsn <= current_lsn; lsn++) {
-        read_wal_record(lsn, &record); // Always read, ignore checksum errors
-        
-        switch (record.type) {
-            case WAL_INSERT: {
-                // REDO: Append record to page
-                if (record.page_id > 0 && record.record_size > 0) {
-                    dump_wal_record(&record, "INSERT RECORD");
-                    
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        DataPage* data_page = (DataPage*)page->data;
-                        
-                        printf("BEFORE INSERT: page %d has %d records\n", record.page_id, data_page->record_count);
-                        
-                        // Clear page chain once at start of recovery
-                        static bool recovery_cleared = false;
-                        if (!recovery_cleared) {
-                            data_page->record_count = 0;
-                            data_page->next_page = -1;
-                            data_page->deleted_count = 0;
-                            memset(data_page->records, 0, sizeof(data_page->records));
-                            recovery_cleared = true;
-                            printf("CLEARED page chain for recovery\n");
-                        }
-                        
-                        if (record.record_size <= 256) {
-                            // Always use the WAL record size for consistency
-                            int wal_record_size = record.record_size;
-                            
-                            // Store the WAL record size globally for scan operations
-                            extern int g_recovery_record_size;
-                            if (g_recovery_record_size == 0) {
-                                g_recovery_record_size = wal_record_size;
-                                printf("REDO: Setting recovery record size to %d\n", g_recovery_record_size);
-                            }
-                            
-                            // Find page with space, starting from current page
-                            Page* target_page = page;
-                            DataPage* target_data_page = data_page;
-                            
-                            while (target_page && target_data_page) {
-                                if ((target_data_page->record_count + 1) * wal_record_size < sizeof(target_data_page->records)) {
-                                    // Found space - insert here
-                                    memcpy(target_data_page->records + (target_data_page->record_count * wal_record_size),
-                                           record.after_image, wal_record_size);
-                                    target_data_page->record_count++;
-                                    mark_dirty(target_page);
-                                    redo_count++;
-                                    printf("REDO: Applied INSERT #%d, page %d, count=%d\n", 
-                                           redo_count, (target_page == page) ? record.page_id : target_data_page->record_count, target_data_page->record_count);
-                                    break;
-                                }
-                                
-                                // Current page full, try next page
-                                if (target_data_page->next_page == -1) {
-                                    // Need new page
-                                    extern int allocate_page();
-                                    int new_page_id = allocate_page();
-                                    if (new_page_id > 0) {
-                                        target_data_page->next_page = new_page_id;
-                                        mark_dirty(target_page);
-                                        if (target_page != page) unpin_page(target_page);
-                                        
-                                        target_page = get_page(new_page_id, 1);
-                                        if (target_page) {
-                                            target_data_page = (DataPage*)target_page->data;
-                                            target_data_page->record_count = 0;
-                                            target_data_page->next_page = -1;
-                                            target_data_page->deleted_count = 0;
-                                            memset(target_data_page->records, 0, sizeof(target_data_page->records));
-                                            printf("REDO: Allocated new page %d\n", new_page_id);
-                                        }
-                                    } else {
-                                        break;
-                                    }
-                                } else {
-                                    // Move to existing next page
-                                    if (target_page != page) unpin_page(target_page);
-                                    target_page = get_page(target_data_page->next_page, 1);
-                                    if (target_page) {
-                                        target_data_page = (DataPage*)target_page->data;
-                                    }
-                                }
-                            }
-                            
-                            if (target_page != page && target_page) unpin_page(target_page);
-                        }
-                        unpin_page(page);
-                    }
-                }
-                break;
-            }
-            case WAL_UPDATE: {
-                // REDO: Apply after image (simplified - overwrite first matching record)
-                if (record.page_id > 0 && record.record_size > 0) {
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        DataPage* data_page = (DataPage*)page->data;
-                        if (data_page->record_count > 0 && record.record_size <= 256) {
-                            memcpy(data_page->records, record.after_image, record.record_size);
-                            mark_dirty(page);
-                            redo_count++;
-                            printf("REDO: Applied UPDATE for TXN %u, page %d\n", record.txn_id, record.page_id);
-                        }
-                        unpin_page(page);
-                    }
-                }
+    // Start the workers; fall back to replaying in this thread
+    static RedoWorker workers[REDO_MAX_WORKERS];
+    int worker_count = redo_worker_count();
+    int started = 0;
+    if (worker_count > 1) {
+        for (; started < worker_count; started++) {
+            RedoWorker* worker = &workers[started];
+            memset(worker, 0, sizeof(*worker));
+            pthread_mutex_init(&worker->mutex, NULL);
+            pthread_cond_init(&worker->not_empty, NULL);
+            pthread_cond_init(&worker->not_full, NULL);
+            if (pthread_create(&worker->thread, NULL, redo_worker_main, worker) != 0) {
+                pthread_cond_destroy(&worker->not_full);
+                pthread_cond_destroy(&worker->not_empty);
+                pthread_mutex_destroy(&worker->mutex);
                 break;
             }
-            case WAL_DELETE: {
-                // REDO: Mark record as deleted
-                if (record.page_id > 0) {
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        // Simple deletion - mark first byte as deleted
-                        page->data[0] = 1;
-                        mark_dirty(page);
-                        unpin_page(page);
-                        redo_count++;
-                        printf("REDO: Applied DELETE for TXN %u, page %d\n",
-                               record.txn_id, record.page_id);
-                    }
-                }
-                break;
-            }
-            default:
-                break;
+        }
+        if (started == 1) {
+            // A single worker only adds hand-off cost
+            workers[0].done = true;
+            pthread_cond_signal(&workers[0].not_empty);
+            pthread_join(workers[0].thread, NULL);
+            started = 0;
         }
     }
     
+    // Scan WAL from the smallest recLSN in the dirty page table
+    uint64_t redo_lsn = recovery.redo_lsn;
+#ifdef MACOS
+    printf("REDO: Starting at LSN %llu with %d worker(s)\n", (unsigned long long)redo_lsn, started ? started : 1);
+#else
+    printf("REDO: Starting at LSN %lu with %d worker(s)\n", (unsigned long)redo_lsn, started ? started : 1);
+#endif
+    wal_reader_open(&reader, redo_lsn);
+    while (wal_reader_next_ref(&reader, &record) > 0) {
+        if (record->type != WAL_INSERT && record->type != WAL_UPDATE && record->type != WAL_DELETE &&
+            record->type != WAL_CLR) {
+            continue;
+        }
+        if (record->page_id <= 0) continue;
+        
+        // Scans address rows with the logged record size, even when nothing is replayed
+        if (g_recovery_record_size == 0 && record->type == WAL_INSERT && record->after_len > 0) {
+            g_recovery_record_size = record->after_len;
+            printf("REDO: Setting recovery record size to %d\n", g_recovery_record_size);
+        }
+        
+        // Changes to clean pages, or older than the page's recLSN, are on disk
+        WALCheckpointPage* dirty = dpt_find(record->page_id);
+        if (!dirty || record->lsn < dirty->rec_lsn) {
+            skipped++;
+            continue;
+        }
+        
+        if (started > 0) {
+            redo_dispatch(&workers[record->page_id % started], record);
+            dispatched++;
+            continue;
+        }
+        int ret = redo_apply(record);
+        if (ret > 0) redo_count++;
+        if (ret == 0) skipped++;
+    }
+    wal_reader_close(&reader);
+    
+    // Drain and stop the workers
+    for (int i = 0; i < started; i++) {
+        pthread_mutex_lock(&workers[i].mutex);
+        workers[i].done = true;
+        pthread_cond_signal(&workers[i].not_empty);
+        pthread_mutex_unlock(&workers[i].mutex);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        redo_count += workers[i].applied;
+        skipped += workers[i].skipped;
+        pthread_cond_destroy(&workers[i].not_full);
+        pthread_cond_destroy(&workers[i].not_empty);
+        pthread_mutex_destroy(&workers[i].mutex);
+    }
+    if (started > 0) {
+        printf("REDO: %d records dispatched to %d workers\n", dispatched, started);
+    }
+    
     // Dump page after recovery
     dump_page_contents(10, "AFTER RECOVERY");
     
-    printf("REDO recovery completed: %d operations applied\n", redo_count);
+    printf("REDO recovery completed: %d operations applied, %d already on disk\n", redo_count, skipped);
     return redo_count;
 }
 
-int perform_undo_recovery() {
-    printf("Starting UNDO recovery...\n");
+/*
+ * Roll one data record back on its page: log a CLR, then apply it with the
+ * page latched. The row is found by content, as in REDO: rollback runs
+ * backwards through each transaction's records, so the row still holds
+ * what the record left (its after image, or for a DELETE the deleted
+ * before image). Returns 0 on success, -1 if the row is not there.
+ */
+static int undo_record(const WALRecord* record) {
+    extern uint64_t wal_log_clr(uint32_t txn_id, int page_id, const char* before, const char* after,
+                                int record_size, uint64_t undo_next_lsn);
+    
+    char changed[WAL_MAX_IMAGE_SIZE];
+    char restored[WAL_MAX_IMAGE_SIZE];
+    int record_size;
+    switch (record->type) {
+        case WAL_INSERT:
+            // UNDO INSERT: Mark the inserted row as deleted
+            record_size = record->after_len;
+            memcpy(changed, wal_after_image(record), record_size);
+            memcpy(restored, changed, record_size);
+            restored[0] |= ROW_FLAG_DELETED;
+            break;
+        case WAL_UPDATE:
+            // UNDO UPDATE: Put the before image back
+            if (record->before_len != record->after_len) return -1;
+            record_size = record->after_len;
+            memcpy(changed, wal_after_image(record), record_size);
+            memcpy(restored, wal_before_image(record), record_size);
+            break;
+        case WAL_DELETE:
+            // UNDO DELETE: Find the row by its deleted image and restore it
+            record_size = record->before_len;
+            memcpy(restored, wal_before_image(record), record_size);
+            memcpy(changed, restored, record_size);
+            changed[0] = 1;
+            break;
+        default:
+            return -1;
+    }
+    if (record_size <= 1) return -1;
+    
+    Page* page = get_page(record->page_id, record->txn_id);
+    if (!page) return -1;
+    DataPage* data_page = (DataPage*)page->data;
+    
+    char* row_ptr = find_row(data_page, changed, record_size);
+    if (row_ptr) {
+        uint64_t clr_lsn = wal_log_clr(record->txn_id, record->page_id, changed, restored,
+                                       record_size, record->prev_lsn);
+        put_row(data_page, row_ptr, restored, record_size);
+        if (clr_lsn != 0) {
+            data_page->page_lsn = clr_lsn;
+            mark_dirty_lsn(page, clr_lsn);
+        } else {
+            mark_dirty(page);
+        }
+    }
+    unpin_page(page);
+    return row_ptr ? 0 : -1;
+}
+
+/*
+ * Runtime rollback: undo txn_id's changes logged after stop_lsn (0 = all of
+ * them), newest first. Only the transaction's own records are read, by
+ * following its prev_lsn chain back from its last record; CLRs already in
+ * the chain lead past the work they undid. The caller holds the
+ * transaction's locks. Returns the number of changes undone.
+ */
+int rollback_transaction(uint32_t txn_id, uint64_t stop_lsn) {
+    extern uint64_t wal_transaction_last_lsn(uint32_t txn_id);
     
-    uint64_t current_lsn = get_current_lsn();
-    WALRecord record;
-    ActiveTransaction active_txns[1000];
-    int active_count = 0;
+    WALReader reader;
+    const WALRecord* record;
     int undo_count = 0;
+    uint64_t lsn = wal_transaction_last_lsn(txn_id);
     
-    // First pass: Find uncommitted transactions
-    for (uint64_t lsn = 1; lsn <= current_lsn; lsn++) {
-        if (read_wal_record(lsn, &record) != 0) {
-            continue;
+    wal_reader_open(&reader, 0);
+    while (lsn > stop_lsn) {
+        if (wal_reader_read_ref(&reader, lsn, &record) != 0 || record->txn_id != txn_id) {
+#ifdef MACOS
+            printf("ROLLBACK: Chain of TXN %u broken at LSN %llu\n", txn_id, (unsigned long long)lsn);
+#else
+            printf("ROLLBACK: Chain of TXN %u broken at LSN %lu\n", txn_id, (unsigned long)lsn);
+#endif
+            break;
         }
-        
-        switch (record.type) {
-            case WAL_BEGIN: {
-                // Add to active transactions
-                if (active_count < 1000) {
-                    active_txns[active_count].txn_id = record.txn_id;
-                    active_txns[active_count].begin_lsn = lsn;
-                    active_txns[active_count].committed = false;
-                    active_count++;
-                }
-                break;
-            }
-            case WAL_COMMIT: {
-                // Mark transaction as committed
-                for (int i = 0; i < active_count; i++) {
-                    if (active_txns[i].txn_id == record.txn_id) {
-                        active_txns[i].committed = true;
-                        break;
-                    }
-                }
-                break;
-            }
-            case WAL_ABORT: {
-                // Mark transaction as committed (already rolled back)
-                for (int i = 0; i < active_count; i++) {
-                    if (active_txns[i].txn_id == record.txn_id) {
-                        active_txns[i].committed = true;
-                        break;
-                    }
-                }
-                break;
+        uint64_t prev_lsn = record->prev_lsn;
+        if ((record->type == WAL_INSERT || record->type == WAL_UPDATE || record->type == WAL_DELETE) &&
+            record->page_id > 0) {
+            if (undo_record(record) == 0) {
+                undo_count++;
+            } else {
+#ifdef MACOS
+                printf("ROLLBACK: Could not roll back %s at LSN %llu on page %d\n",
+                       wal_record_type_name(record->type), (unsigned long long)lsn, record->page_id);
+#else
+                printf("ROLLBACK: Could not roll back %s at LSN %lu on page %d\n",
+                       wal_record_type_name(record->type), (unsigned long)lsn, record->page_id);
+#endif
             }
-            default:
-                break;
         }
+        if (prev_lsn >= lsn) break;
+        lsn = prev_lsn;
     }
+    wal_reader_close(&reader);
     
-    // Second pass: UNDO uncommitted transactions (reverse order)
-    for (uint64_t lsn = current_lsn; lsn >= 1; lsn--) {
-        if (read_wal_record(lsn, &record) != 0) {
-            continue;
+    printf("ROLLBACK: TXN %u: %d changes undone\n", txn_id, undo_count);
+    return undo_count;
+}
+
+/*
+ * UNDO: roll back the loser transactions ANALYSIS left open. Rather than
+ * rescanning the log, each loser's records are visited through its
+ * prev_lsn chain, starting at its last record; all losers are undone
+ * together in reverse LSN order by always taking the loser whose next
+ * record is latest. Every undone change is logged as a CLR, and each loser
+ * then gets an ABORT record, so a later recovery does not undo it again.
+ */
+int perform_undo_recovery() {
+    extern uint64_t wal_abort_transaction(uint32_t txn_id);
+    extern void flush_wal();
+    
+    printf("Starting UNDO recovery...\n");
+    
+    WALReader reader;
+    const WALRecord* record;
+    int undo_count = 0;
+    int visited = 0;
+    
+    // Chain heads still to undo, one per loser
+    uint64_t* next_lsn = malloc((recovery.txn_count + 1) * sizeof(uint64_t));
+    if (!next_lsn) {
+        printf("UNDO: Out of memory\n");
+        return -1;
+    }
+    for (int i = 0; i < recovery.txn_count; i++) {
+        next_lsn[i] = recovery.txns[i].last_lsn;
+    }
+    
+    wal_reader_open(&reader, 0);
+    for (;;) {
+        int loser = -1;
+        for (int i = 0; i < recovery.txn_count; i++) {
+            if (next_lsn[i] != 0 && (loser < 0 || next_lsn[i] > next_lsn[loser])) loser = i;
         }
+        if (loser < 0) break;
         
-        // Check if this transaction needs to be undone
-        bool needs_undo = false;
-        for (int i = 0; i < active_count; i++) {
-            if (active_txns[i].txn_id == record.txn_id && !active_txns[i].committed) {
-                needs_undo = true;
-                break;
-            }
+        uint64_t lsn = next_lsn[loser];
+        next_lsn[loser] = 0;
+        if (wal_reader_read_ref(&reader, lsn, &record) != 0 || record->txn_id != recovery.txns[loser].txn_id) {
+#ifdef MACOS
+            printf("UNDO: Chain of TXN %u broken at LSN %llu\n", recovery.txns[loser].txn_id, (unsigned long long)lsn);
+#else
+            printf("UNDO: Chain of TXN %u broken at LSN %lu\n", recovery.txns[loser].txn_id, (unsigned long)lsn);
+#endif
+            continue;
         }
+        visited++;
+        if (record->prev_lsn < lsn) next_lsn[loser] = record->prev_lsn;
         
-        if (!needs_undo) continue;
-        
-        switch (record.type) {
-            case WAL_INSERT: {
-                // UNDO INSERT: Remove the record
-                if (record.page_id > 0) {
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        // Simple undo - mark as deleted
-                        page->data[0] = 1;
-                        mark_dirty(page);
-                        unpin_page(page);
-                        undo_count++;
-                        printf("UNDO: Removed INSERT for TXN %u, page %d\n",
-                               record.txn_id, record.page_id);
-                    }
-                }
-                break;
-            }
-            case WAL_UPDATE: {
-                // UNDO UPDATE: Restore before image
-                if (record.page_id > 0 && record.record_size > 0) {
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        int copy_size = (record.record_size < 256) ? record.record_size : 256;
-                        if (copy_size <= PAGE_SIZE) {
-                            memcpy(page->data, record.before_image, copy_size);
-                            mark_dirty(page);
-                            unpin_page(page);
-                            undo_count++;
-                            printf("UNDO: Restored UPDATE for TXN %u, page %d\n",
-                                   record.txn_id, record.page_id);
-                        } else {
-                            unpin_page(page);
-                        }
-                    }
-                }
-                break;
-            }
-            case WAL_DELETE: {
-                // UNDO DELETE: Restore the record
-                if (record.page_id > 0 && record.record_size > 0) {
-                    Page* page = get_page(record.page_id, 1);
-                    if (page) {
-                        int copy_size = (record.record_size < 256) ? record.record_size : 256;
-                        if (copy_size <= PAGE_SIZE) {
-                            memcpy(page->data, record.before_image, copy_size);
-                            mark_dirty(page);
-                            unpin_page(page);
-                            undo_count++;
-                            printf("UNDO: Restored DELETE for TXN %u, page %d\n",
-                                   record.txn_id, record.page_id);
-                        } else {
-                            unpin_page(page);
-                        }
-                    }
-                }
-                break;
-            }
-            default:
-                break;
+        if (record->type != WAL_INSERT && record->type != WAL_UPDATE && record->type != WAL_DELETE) {
+            continue;
+        }
+        if (record->page_id <= 0) continue;
+        if (undo_record(record) == 0) {
+            undo_count++;
+            printf("UNDO: Rolled back %s for TXN %u, page %d\n", wal_record_type_name(record->type),
+                   record->txn_id, record->page_id);
+        } else {
+#ifdef MACOS
+            printf("UNDO: Could not roll back %s at LSN %llu on page %d\n", wal_record_type_name(record->type),
+                   (unsigned long long)lsn, record->page_id);
+#else
+            printf("UNDO: Could not roll back %s at LSN %lu on page %d\n", wal_record_type_name(record->type),
+                   (unsigned long)lsn, record->page_id);
+#endif
+        }
+    }
+    wal_reader_close(&reader);
+    free(next_lsn);
+    
+    // The CLRs make the rollback redoable, so the pages need not be on disk first
+    if (recovery.txn_count > 0) {
+        for (int i = 0; i < recovery.txn_count; i++) {
+            wal_abort_transaction(recovery.txns[i].txn_id);
         }
+        flush_wal();
     }
     
-    printf("UNDO recovery completed: %d operations undone\n", undo_count);
+    printf("UNDO recovery completed: %d operations undone for %d transactions (%d records visited)\n",
+           undo_count, recovery.txn_count, visited);
     return undo_count;
 }
 
 int perform_crash_recovery() {
     printf("Starting crash recovery...\n");
     
+    // Phase 0: ANALYSIS - Rebuild the dirty page and transaction tables
+    perform_analysis();
+    
     // Phase 1: REDO - Replay all committed operations
     int redo_ops = perform_redo_recovery();
     
     // Phase 2: UNDO - Rollback uncommitted transactions
     int undo_ops = perform_undo_recovery();
     
+    // New transactions must not reuse ids that row versions already carry
+    extern void transaction_set_next_id(uint32_t txn_id);
+    transaction_set_next_id(recovery.next_txn_id);
+    
     printf("Crash recovery completed: %d REDO, %d UNDO operations\n", 
            redo_ops, undo_ops);
     
     return 0;
 }
 
-int checkpoint_recovery() {
+static pthread_mutex_t checkpoint_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Take a fuzzy checkpoint: log the active transaction table and the dirty
+ * page table without flushing the buffer pool, then point the control file
+ * at the checkpoint and recycle segments recovery no longer needs. Caller
+ * holds checkpoint_mutex.
+ */
+static int take_checkpoint() {
     printf("Creating checkpoint...\n");
     
-    // Force all dirty pages to disk
-    extern void flush_all_pages();
-    flush_all_pages();
-    
-    // Write checkpoint record
+    extern uint64_t wal_end_lsn();
+    extern uint64_t wal_last_checkpoint_lsn();
+    extern int flush_checkpoint_pages(uint64_t lsn);
+    extern int collect_dirty_pages(WALCheckpointPage** pages);
+    extern int wal_collect_active_txns(WALCheckpointTxn** txns);
     extern uint64_t write_wal_record(WALRecordType type, uint32_t txn_id, int page_id, 
                                     const char* before_image, const char* after_image, int record_size);
-    uint64_t checkpoint_lsn = write_wal_record(WAL_CHECKPOINT, 0, -1, NULL, NULL, 0);
+    extern int wal_flush_to(uint64_t lsn);
+    extern int wal_checkpoint_complete(uint64_t checkpoint_lsn, uint64_t redo_lsn);
+    extern void wal_recycle_segments(uint64_t keep_lsn);
+    extern uint32_t transaction_next_id();
+    
+    uint64_t begin_lsn = wal_end_lsn();
+    uint32_t next_txn_id = transaction_next_id();
+    
+    // Unlogged changes must reach disk; pages dirty since before the previous
+    // checkpoint are written too so the redo point moves on
+    int written = flush_checkpoint_pages(wal_last_checkpoint_lsn());
+    
+    WALCheckpointPage* pages = NULL;
+    WALCheckpointTxn* txns = NULL;
+    int page_count = collect_dirty_pages(&pages);
+    int txn_count = wal_collect_active_txns(&txns);
+    if (page_count < 0 || txn_count < 0) {
+        free(pages);
+        free(txns);
+        printf("Checkpoint failed: out of memory\n");
+        return -1;
+    }
+    
+    // REDO must start at the oldest change not on disk; UNDO needs open transactions' records
+    uint64_t redo_lsn = begin_lsn;
+    for (int i = 0; i < page_count; i++) {
+        if (pages[i].rec_lsn < redo_lsn) redo_lsn = pages[i].rec_lsn;
+    }
+    uint64_t keep_lsn = redo_lsn;
+    for (int i = 0; i < txn_count; i++) {
+        if (txns[i].first_lsn < keep_lsn) keep_lsn = txns[i].first_lsn;
+    }
+    
+    // Log the tables, as many entries per record as fit
+    char payload[WAL_MAX_IMAGE_SIZE];
+    uint64_t checkpoint_lsn = 0, lsn = 0;
+    int txn_pos = 0, page_pos = 0;
+    bool last = false;
+    while (!last) {
+        WALCheckpointHeader header = { begin_lsn, redo_lsn, 0, 0, checkpoint_lsn == 0 ? WAL_CHECKPOINT_FIRST : 0,
+                                       next_txn_id };
+        size_t size = sizeof(header);
+        while (txn_pos < txn_count && size + sizeof(WALCheckpointTxn) <= sizeof(payload)) {
+            memcpy(payload + size, &txns[txn_pos++], sizeof(WALCheckpointTxn));
+            size += sizeof(WALCheckpointTxn);
+            header.txn_count++;
+        }
+        while (txn_pos == txn_count && page_pos < page_count &&
+               size + sizeof(WALCheckpointPage) <= sizeof(payload)) {
+            memcpy(payload + size, &pages[page_pos++], sizeof(WALCheckpointPage));
+            size += sizeof(WALCheckpointPage);
+            header.page_count++;
+        }
+        last = txn_pos == txn_count && page_pos == page_count;
+        if (last) header.flags |= WAL_CHECKPOINT_LAST;
+        memcpy(payload, &header, sizeof(header));
+        
+        lsn = write_wal_record(WAL_CHECKPOINT, 0, -1, NULL, payload, size);
+        if (lsn == 0) break;
+        if (checkpoint_lsn == 0) checkpoint_lsn = lsn;
+    }
+    free(pages);
+    free(txns);
+    
+    if (lsn == 0 || wal_flush_to(lsn) != 0 || wal_checkpoint_complete(checkpoint_lsn, redo_lsn) != 0) {
+        printf("Checkpoint failed: could not log checkpoint\n");
+        return -1;
+    }
+    
+    wal_recycle_segments(keep_lsn);
     
 #ifdef MACOS
-    printf("Checkpoint created at LSN %llu\n", (unsigned long long)checkpoint_lsn);
+    printf("Checkpoint created at LSN %llu: redo point %llu, %d dirty pages, %d active transactions, %d pages written\n",
+           (unsigned long long)checkpoint_lsn, (unsigned long long)redo_lsn, page_count, txn_count, written);
 #else
-    printf("Checkpoint created at LSN %lu\n", (unsigned long)checkpoint_lsn);
+    printf("Checkpoint created at LSN %lu: redo point %lu, %d dirty pages, %d active transactions, %d pages written\n",
+           (unsigned long)checkpoint_lsn, (unsigned long)redo_lsn, page_count, txn_count, written);
 #endif
     return 0;
-}
\ No newline at end of file
+}
+
+// Take a checkpoint unless one is already being taken (see CHECKPOINTING)
+int checkpoint_recovery() {
+    if (pthread_mutex_trylock(&checkpoint_mutex) != 0) {
+        printf("Checkpoint already in progress, skipping\n");
+        return 0;
+    }
+    int ret = take_checkpoint();
+    pthread_mutex_unlock(&checkpoint_mutex);
+    return ret;
+}
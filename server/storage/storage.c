@@ -11,40 +11,58 @@
  * See common/row_format.h for detailed documentation
  * 
  * Current implementation uses simple format:
- * [FLAGS:1][FIELD1:4][FIELD2:VAR]...
+ * [FLAGS:1][XMIN:4][XMAX:4][FIELD1:4][FIELD2:VAR]...
  * 
  * FLAGS byte contains delete/update status
+ * XMIN/XMAX stamp the row version for MVCC (see transaction_manager.c)
  * Fields are stored in column order as defined in table schema
  */
 
 extern Page* get_page(int page_id, uint32_t txn_id);
 extern void unpin_page(Page* page);
 extern void mark_dirty(Page* page);
+extern void mark_dirty_lsn(Page* page, uint64_t lsn);
+extern void flush_page(Page* page);
 extern int allocate_page();
-extern int create_table_catalog(const char* table_name, Column* columns, int column_count);
+extern int create_table_catalog(const char* table_name, Column* columns, int column_count, int table_id);
 extern int drop_table_catalog(const char* table_name);
-extern int create_index_catalog(const char* index_name, int table_id, const char* column_name, int index_type, int root_page_id);
+extern int create_index_catalog(const char* index_name, int table_id,
+                                char key_columns[][MAX_NAME_LEN], int key_count,
+                                char include_columns[][MAX_NAME_LEN], int include_count,
+                                int index_type, int root_page_id);
 extern int drop_index_catalog(const char* index_name);
+extern Index* find_index_by_name(const char* name);
+extern int get_table_indexes(int table_id, Index* result_indexes, int max_indexes);
+extern int get_all_tables(Table* result_tables, int max_tables);
 extern Table* find_table_by_name(const char* name);
 
+extern int btree_create(uint32_t txn_id);
+extern bool btree_entry_fits(const Index* index, const Table* table);
+extern int btree_reset(int root_page_id, uint32_t txn_id);
+extern int btree_insert(const Index* index, const Table* table, const Value* row_values, RecordId rid, uint32_t txn_id);
+extern int art_reset(const Index* index);
+extern void art_drop(int index_id);
+extern int art_insert(const Index* index, const Table* table, const Value* row_values, RecordId rid);
+extern void zone_map_reset_page(int page_id, int next_page);
+extern void zone_map_set_next(int page_id, int next_page);
+extern void zone_map_add_row(int page_id, const Table* table, const Value* values);
+extern bool zone_map_page_may_match(int page_id, const Table* table, const BoundPredicate* predicates,
+                                    int predicate_count, int* next_page);
+extern const Snapshot* transaction_snapshot(uint32_t txn_id);
+extern bool transaction_visible(const Snapshot* snapshot, uint32_t txn_id, uint32_t xid);
+extern TransactionState transaction_status(uint32_t txn_id);
+
+#define MAX_TABLE_INDEXES 8
+
 typedef struct {
     int record_count;
     int next_page;
     int deleted_count;
-    char records[PAGE_SIZE - 12];
+    int reserved;
+    uint64_t page_lsn;      // LSN of the last WAL record applied to this page
+    char records[PAGE_SIZE - 24];
 } DataPage;
 
-typedef struct {
-    int key_count;
-    int is_leaf;
-    int parent;
-    struct {
-        Value key;
-        int page_id;
-    } entries[100];
-    int children[101];
-} BTreePage;
-
 typedef struct {
     int bucket_count;
     struct {
@@ -94,9 +112,9 @@ int write_system_table_record(int table_id, const void* record, int record_size)
 }
 
 int create_table_storage(const char* table_name, Column* columns, int column_count, uint32_t txn_id) {
-    int table_id = create_table_catalog(table_name, columns, column_count);
-    if (table_id < 0) return -1;
+    if (find_table_by_name(table_name)) return -1;
     
+    // The first data page id doubles as the table id
     int page_id = allocate_page();
     Page* page = get_page(page_id, txn_id);
     if (!page) return -1;
@@ -105,10 +123,15 @@ int create_table_storage(const char* table_name, Column* columns, int column_cou
     data_page->record_count = 0;
     data_page->next_page = -1;
     data_page->deleted_count = 0;
+    data_page->page_lsn = 0;
+    zone_map_reset_page(page_id, -1);
     
     mark_dirty(page);
     unpin_page(page);
     
+    int table_id = create_table_catalog(table_name, columns, column_count, page_id);
+    if (table_id < 0) return -1;
+    
     printf("Table %s created with table_id %d, data_page_id %d\n", 
            table_name, table_id, page_id);
     return table_id;
@@ -126,7 +149,7 @@ int drop_table_storage(const char* table_name, uint32_t txn_id) {
 }
 
 int calculate_record_size(Column* columns, int column_count) {
-    int size = 1; // Delete flag
+    int size = DATA_ROW_HEADER_SIZE; // Flags + MVCC version
     for (int i = 0; i < column_count; i++) {
         switch (columns[i].type) {
             case TYPE_INT:
@@ -150,8 +173,10 @@ int calculate_record_size(Column* columns, int column_count) {
 int serialize_record(Column* columns, int column_count, Value* values, char* buffer) {
     int offset = 0;
     
-    // Delete flag
+    // Delete flag, then the version stamp the writer fills in
     buffer[offset++] = 0; // Not deleted
+    memset(buffer + offset, 0, sizeof(RowVersion));
+    offset += sizeof(RowVersion);
     
     for (int i = 0; i < column_count; i++) {
         switch (columns[i].type) {
@@ -181,8 +206,9 @@ int serialize_record(Column* columns, int column_count, Value* values, char* buf
 int deserialize_record(Column* columns, int column_count, const char* buffer, Value* values, bool* deleted) {
     int offset = 0;
     
-    // Delete flag
+    // Delete flag; visibility is decided from the version by the caller
     *deleted = buffer[offset++];
+    offset += sizeof(RowVersion);
     
     for (int i = 0; i < column_count; i++) {
         switch (columns[i].type) {
@@ -209,16 +235,217 @@ int deserialize_record(Column* columns, int column_count, const char* buffer, Va
     return offset;
 }
 
-int insert_record(const char* table_name, Value* values, int value_count, uint32_t txn_id) {
-    Table* table = find_table_by_name(table_name);
-    if (!table) return -1;
+int compare_values(DataType type, const Value* a, const Value* b) {
+    switch (type) {
+        case TYPE_INT:
+            return (a->int_val > b->int_val) - (a->int_val < b->int_val);
+        case TYPE_BIGINT:
+            return (a->bigint_val > b->bigint_val) - (a->bigint_val < b->bigint_val);
+        case TYPE_FLOAT:
+            return (a->float_val > b->float_val) - (a->float_val < b->float_val);
+        case TYPE_CHAR:
+        case TYPE_VARCHAR:
+        default:
+            return strcmp(a->string_val, b->string_val);
+    }
+}
+
+// MVCC: may txn_id see this row version through snapshot?
+static bool row_visible(const char* record_ptr, const Snapshot* snapshot, uint32_t txn_id) {
+    if (ROW_IS_DELETED(ROW_HEADER_PTR(record_ptr))) return false;
+    const RowVersion* version = ROW_VERSION_PTR(record_ptr);
+    if (!transaction_visible(snapshot, txn_id, version->xmin)) return false;
+    return version->xmax == 0 || !transaction_visible(snapshot, txn_id, version->xmax);
+}
+
+// Versions someone may still read: index builds and zone maps cover all of them
+static bool row_version_live(const char* record_ptr) {
+    return !ROW_IS_DELETED(ROW_HEADER_PTR(record_ptr)) &&
+           transaction_status(ROW_VERSION_PTR(record_ptr)->xmin) != TXN_ABORTED;
+}
+
+typedef enum {
+    ROW_SKIP,           // Not a version txn_id can change
+    ROW_WRITABLE,       // Change it once the row lock is held (then check again)
+    ROW_CONFLICT        // REPEATABLE READ: changed by a transaction the snapshot misses
+} RowWriteCheck;
+
+/*
+ * Can txn_id update or delete this row version? Writers act on the latest
+ * committed version, so a version another transaction is still writing
+ * counts as writable: the row lock waits for that transaction, and the
+ * caller checks again once it holds the lock.
+ */
+static RowWriteCheck row_write_check(const char* record_ptr, const Snapshot* snapshot, uint32_t txn_id,
+                                     bool repeatable_read) {
+    if (ROW_IS_DELETED(ROW_HEADER_PTR(record_ptr))) return ROW_SKIP;
+    const RowVersion* version = ROW_VERSION_PTR(record_ptr);
     
+    if (version->xmin != txn_id) {
+        TransactionState state = transaction_status(version->xmin);
+        if (state == TXN_ABORTED) return ROW_SKIP;
+        if (state == TXN_COMMITTED && repeatable_read &&
+            !transaction_visible(snapshot, txn_id, version->xmin)) {
+            return ROW_SKIP;    // Inserted after our snapshot
+        }
+    }
+    
+    if (version->xmax == 0) return ROW_WRITABLE;
+    if (version->xmax == txn_id) return ROW_SKIP;   // We already deleted or replaced it
+    switch (transaction_status(version->xmax)) {
+        case TXN_ABORTED:
+        case TXN_ACTIVE:
+            return ROW_WRITABLE;
+        default:
+            if (repeatable_read && !transaction_visible(snapshot, txn_id, version->xmax)) return ROW_CONFLICT;
+            return ROW_SKIP;
+    }
+}
+
+/*
+ * Another transaction still writing this version: its creator, or the
+ * transaction that stamped its xmax, while running. Returns its id or 0.
+ * Locking writers hold the row lock while they write, so once we hold a
+ * row's lock, a busy version belongs to an OCC writer.
+ */
+static uint32_t row_writer(const char* record_ptr, uint32_t txn_id) {
+    const RowVersion* version = ROW_VERSION_PTR(record_ptr);
+    if (version->xmin != txn_id && transaction_status(version->xmin) == TXN_ACTIVE) return version->xmin;
+    if (version->xmax != 0 && version->xmax != txn_id && transaction_status(version->xmax) == TXN_ACTIVE) {
+        return version->xmax;
+    }
+    return 0;
+}
+
+/*
+ * OCC validation: is a version txn_id read still the current one? It must
+ * still be in its slot and not be replaced or deleted by anyone else,
+ * committed or still running (a running writer may commit first).
+ */
+bool row_version_current(const OccRead* read, uint32_t txn_id) {
+    Page* page = get_page(read->page_id, txn_id);
+    if (!page) return false;
+    
+    DataPage* data_page = (DataPage*)page->data;
+    bool current = false;
+    if (read->slot < data_page->record_count) {
+        const char* record_ptr = data_page->records + (read->slot * read->record_size);
+        const RowVersion* version = ROW_VERSION_PTR(record_ptr);
+        current = !ROW_IS_DELETED(ROW_HEADER_PTR(record_ptr)) && version->xmin == read->xmin &&
+                  (version->xmax == 0 || version->xmax == txn_id ||
+                   transaction_status(version->xmax) == TXN_ABORTED);
+    }
+    unpin_page(page);
+    return current;
+}
+
+// OCC: remember a version the transaction read, for validation at commit
+static void record_read(uint32_t txn_id, int page_id, int slot, int record_size, const char* record_ptr) {
+    extern void transaction_record_read(uint32_t txn_id, int page_id, int slot, int record_size, uint32_t xmin);
+    transaction_record_read(txn_id, page_id, slot, record_size, ROW_VERSION_PTR(record_ptr)->xmin);
+}
+
+// Record size used to address slots; matches what scan_table() reads
+static int table_record_size(Table* table) {
+    extern int g_recovery_record_size;
+    if (g_recovery_record_size > 0) {
+        return g_recovery_record_size;
+    }
+    return calculate_record_size(table->columns, table->column_count);
+}
+
+static void index_insert_row(Table* table, Index* indexes, int index_count, const Value* values, RecordId rid, uint32_t txn_id) {
+    for (int i = 0; i < index_count; i++) {
+        if (indexes[i].type == INDEX_BTREE) {
+            btree_insert(&indexes[i], table, values, rid, txn_id);
+        } else if (indexes[i].type == INDEX_ART) {
+            art_insert(&indexes[i], table, values, rid);
+        }
+    }
+}
+
+extern int acquire_row_lock(uint32_t txn_id, int table_id, RecordId rid, bool wait);
+extern void release_row_lock(uint32_t txn_id, int table_id, RecordId rid);
+extern bool transaction_optimistic(uint32_t txn_id);
+extern int transaction_record_write(uint32_t txn_id);
+extern bool row_locked_by_other(uint32_t txn_id, int table_id, RecordId rid);
+
+/*
+ * X-lock a row while its page is latched (get_page()). If another
+ * transaction holds the row, waiting with the latch held could deadlock,
+ * so the page is released for the wait (marked dirty first with dirty_lsn,
+ * if the caller already changed it) and latched again afterwards. Returns
+ * 0 if the lock was granted at once, 1 after such a wait (the caller must
+ * re-read the page through *page), LOCK_DEADLOCK if the wait would
+ * deadlock and this transaction was chosen as the victim, LOCK_TIMEOUT
+ * after lock_timeout, -1 on failure.
+ */
+static int lock_row_latched(uint32_t txn_id, int table_id, RecordId rid, Page** page, uint64_t dirty_lsn) {
+    int ret = acquire_row_lock(txn_id, table_id, rid, false);
+    if (ret <= 0) return ret;
+    
+    if (dirty_lsn != 0) mark_dirty_lsn(*page, dirty_lsn);
+    unpin_page(*page);
+    ret = acquire_row_lock(txn_id, table_id, rid, true);
+    *page = get_page(rid.page_id, txn_id);
+    if (!*page) return -1;
+    return ret == 0 ? 1 : ret;
+}
+
+/*
+ * Like lock_row_latched(), for a locking writer that holds the row lock
+ * but finds OCC transaction writer still writing the version (see
+ * row_writer()): waits for it to end with the page released. Returns 1
+ * (re-read the page through *page), LOCK_DEADLOCK, LOCK_TIMEOUT or -1.
+ */
+static int wait_writer_latched(uint32_t txn_id, uint32_t writer, Page** page, uint64_t dirty_lsn) {
+    extern int transaction_wait(uint32_t txn_id, uint32_t xid);
+    int page_id = (*page)->page_id;
+    if (dirty_lsn != 0) mark_dirty_lsn(*page, dirty_lsn);
+    unpin_page(*page);
+    int ret = transaction_wait(txn_id, writer);
+    *page = get_page(page_id, txn_id);
+    if (!*page) return -1;
+    return ret == 0 ? 1 : ret;
+}
+
+/*
+ * Claim a version for update or delete, with its page latched. Locking
+ * writers X-lock the row, waiting if needed (returns 1: evaluate the row
+ * again). OCC writers take no row lock: a version someone else is still
+ * writing, or a row someone has locked (SELECT ... FOR UPDATE), is a
+ * conflict, reported at once. Returns 0 when txn_id may stamp the version,
+ * SERIALIZATION_FAILURE, LOCK_DEADLOCK, LOCK_TIMEOUT or -1.
+ */
+static int claim_row_latched(uint32_t txn_id, int table_id, RecordId rid, bool optimistic,
+                             Page** page, uint64_t dirty_lsn, int record_size) {
+    const char* record_ptr = ((DataPage*)(*page)->data)->records + (rid.slot * record_size);
+    if (optimistic) {
+        uint32_t writer = row_writer(record_ptr, txn_id);
+        if (writer != 0) {
+            printf("OCC: TXN %u conflicts with transaction %u on page %d slot %d\n", txn_id, writer,
+                   rid.page_id, rid.slot);
+            return SERIALIZATION_FAILURE;
+        }
+        if (row_locked_by_other(txn_id, table_id, rid)) {
+            printf("OCC: TXN %u conflicts with a row lock on page %d slot %d\n", txn_id, rid.page_id, rid.slot);
+            return SERIALIZATION_FAILURE;
+        }
+        return transaction_record_write(txn_id);
+    }
+    int lock = lock_row_latched(txn_id, table_id, rid, page, dirty_lsn);
+    if (lock != 0) return lock;
+    uint32_t writer = row_writer(record_ptr, txn_id);
+    return writer != 0 ? wait_writer_latched(txn_id, writer, page, dirty_lsn) : 0;
+}
+
+// Page of table's heap with room for one more record, allocating one at the end if needed. Pinned
+static Page* find_insert_page(Table* table, int record_size, uint32_t txn_id) {
     int current_page_id = table->table_id;
     Page* page = get_page(current_page_id, txn_id);
-    if (!page) return -1;
+    if (!page) return NULL;
     
     DataPage* data_page = (DataPage*)page->data;
-    int record_size = calculate_record_size(table->columns, table->column_count);
     
     // Find page with space
     while ((data_page->record_count + 1) * record_size >= sizeof(data_page->records)) {
@@ -227,21 +454,35 @@ int insert_record(const char* table_name, Value* values, int value_count, uint32
             int new_page_id = allocate_page();
             if (new_page_id < 0) {
                 unpin_page(page);
-                return -1;
+                return NULL;
             }
             
+            Page* new_page = get_page(new_page_id, txn_id);
+            if (!new_page) {
+                unpin_page(page);
+                return NULL;
+            }
+            DataPage* new_data_page = (DataPage*)new_page->data;
+            new_data_page->record_count = 0;
+            new_data_page->next_page = -1;
+            new_data_page->deleted_count = 0;
+            new_data_page->page_lsn = 0;
+            mark_dirty(new_page);
+            
+            // Page allocation is not logged: the new page and then the link
+            // to it go to disk now, so a crash can neither lose the link nor
+            // hand out the page again
+            flush_page(new_page);
             data_page->next_page = new_page_id;
+            zone_map_set_next(current_page_id, new_page_id);
             mark_dirty(page);
+            flush_page(page);
             unpin_page(page);
             
             current_page_id = new_page_id;
-            page = get_page(current_page_id, txn_id);
-            if (!page) return -1;
-            
-            data_page = (DataPage*)page->data;
-            data_page->record_count = 0;
-            data_page->next_page = -1;
-            data_page->deleted_count = 0;
+            page = new_page;
+            data_page = new_data_page;
+            zone_map_reset_page(new_page_id, -1);
             
             printf("INSERT: Allocated new page %d\n", new_page_id);
             break;
@@ -250,41 +491,173 @@ int insert_record(const char* table_name, Value* values, int value_count, uint32
             unpin_page(page);
             current_page_id = data_page->next_page;
             page = get_page(current_page_id, txn_id);
-            if (!page) return -1;
+            if (!page) return NULL;
             data_page = (DataPage*)page->data;
         }
     }
+    return page;
+}
+
+/*
+ * Append a row version created by txn_id to the first page with room and
+ * index it. Returns 0, or a negative error.
+ */
+static int insert_row(Table* table, Value* values, uint32_t txn_id) {
+    int record_size = calculate_record_size(table->columns, table->column_count);
+    Page* page;
+    DataPage* data_page;
+    RecordId rid;
     
-    char record_buffer[512];
+    // Lock the new row's slot. Nobody else can write an OCC transaction's
+    // new version, so it needs no row lock
+    for (;;) {
+        page = find_insert_page(table, record_size, txn_id);
+        if (!page) return -1;
+        data_page = (DataPage*)page->data;
+        rid.page_id = page->page_id;
+        rid.slot = data_page->record_count;
+        
+        int lock = transaction_optimistic(txn_id) ? transaction_record_write(txn_id)
+                                                  : lock_row_latched(txn_id, table->table_id, rid, &page, 0);
+        if (lock < 0) {
+            if (page) unpin_page(page);
+            return lock;
+        }
+        if (lock == 0) break;
+        
+        // Waited with the page released (escalation): keep the slot if it is
+        // still the next free one, else give its lock back and look again
+        data_page = (DataPage*)page->data;
+        if (data_page->record_count == rid.slot &&
+            (data_page->record_count + 1) * record_size < (int)sizeof(data_page->records)) break;
+        release_row_lock(txn_id, table->table_id, rid);
+        unpin_page(page);
+    }
+    int current_page_id = rid.page_id;
+    
+    char record_buffer[PAGE_SIZE];
     serialize_record(table->columns, table->column_count, values, record_buffer);
+    ROW_VERSION_PTR(record_buffer)->xmin = txn_id;
     
     // WAL log to correct current page
     extern uint64_t wal_log_insert(uint32_t txn_id, int page_id, const char* record, int record_size);
-    if (record_size > 0 && record_size < 512) {
-        wal_log_insert(txn_id, current_page_id, record_buffer, record_size);
+    uint64_t insert_lsn = 0;
+    if (record_size > 0) {
+        insert_lsn = wal_log_insert(txn_id, current_page_id, record_buffer, record_size);
+        if (insert_lsn == 0) {
+            // Never change a page the log does not cover
+            unpin_page(page);
+            return -1;
+        }
     }
     
     memcpy(data_page->records + (data_page->record_count * record_size), 
            record_buffer, record_size);
     data_page->record_count++;
+    if (insert_lsn != 0) data_page->page_lsn = insert_lsn;
+    zone_map_add_row(current_page_id, table, values);
     
-    mark_dirty(page);
+    Index indexes[MAX_TABLE_INDEXES];
+    int index_count = get_table_indexes(table->table_id, indexes, MAX_TABLE_INDEXES);
+    index_insert_row(table, indexes, index_count, values, rid, txn_id);
+    
+    mark_dirty_lsn(page, insert_lsn);
     unpin_page(page);
     
     return 0;
 }
 
-int update_record(const char* table_name, const char* column, Value* value, const char* where_clause, uint32_t txn_id) {
+int insert_record(const char* table_name, Value* values, int value_count, uint32_t txn_id) {
+    (void)value_count;
     Table* table = find_table_by_name(table_name);
     if (!table) return -1;
+    return insert_row(table, values, txn_id);
+}
+
+static bool row_satisfies(const Table* table, const Value* values,
+                          const BoundPredicate* predicates, int predicate_count) {
+    for (int p = 0; p < predicate_count; p++) {
+        const BoundPredicate* pred = &predicates[p];
+        int cmp = compare_values(table->columns[pred->column].type, &values[pred->column], &pred->literal);
+        bool match = false;
+        if (strcmp(pred->op, "=") == 0) match = cmp == 0;
+        else if (strcmp(pred->op, ">") == 0) match = cmp > 0;
+        else if (strcmp(pred->op, "<") == 0) match = cmp < 0;
+        else if (strcmp(pred->op, ">=") == 0) match = cmp >= 0;
+        else if (strcmp(pred->op, "<=") == 0) match = cmp <= 0;
+        if (!match) return false;
+    }
+    return true;
+}
+
+typedef enum {
+    WHERE_ALL,          // No WHERE clause: every row
+    WHERE_NONE,         // Clause that matches nothing (unknown column or operator)
+    WHERE_PREDICATE     // Rows must satisfy the bound predicate
+} DmlWhere;
+
+/*
+ * Bind the WHERE clause of UPDATE/DELETE ("col op value", value optionally
+ * quoted) once, before the scan. INT columns take =, <, >, <= and >=,
+ * other columns only =. The bound predicate also lets zone maps skip pages.
+ */
+static DmlWhere bind_dml_where(const Table* table, const char* where_clause, BoundPredicate* pred) {
+    if (!where_clause || strlen(where_clause) == 0) return WHERE_ALL;
     
-    int data_page_id = table->table_id;
-    Page* page = get_page(data_page_id, txn_id);
-    if (!page) return -1;
+    char where_col[64], where_val[256];
+    const char* op;
+    if (sscanf(where_clause, "%63s >= '%255[^']'", where_col, where_val) == 2) op = ">=";
+    else if (sscanf(where_clause, "%63s <= '%255[^']'", where_col, where_val) == 2) op = "<=";
+    else if (sscanf(where_clause, "%63s > '%255[^']'", where_col, where_val) == 2) op = ">";
+    else if (sscanf(where_clause, "%63s < '%255[^']'", where_col, where_val) == 2) op = "<";
+    else if (sscanf(where_clause, "%63s = '%255[^']'", where_col, where_val) == 2) op = "=";
+    else if (sscanf(where_clause, "%63s >= %255s", where_col, where_val) == 2) op = ">=";
+    else if (sscanf(where_clause, "%63s <= %255s", where_col, where_val) == 2) op = "<=";
+    else if (sscanf(where_clause, "%63s > %255s", where_col, where_val) == 2) op = ">";
+    else if (sscanf(where_clause, "%63s < %255s", where_col, where_val) == 2) op = "<";
+    else if (sscanf(where_clause, "%63s = %255s", where_col, where_val) == 2) op = "=";
+    else return WHERE_NONE;
+    
+    for (int i = 0; i < table->column_count; i++) {
+        if (strcasecmp(table->columns[i].name, where_col) != 0) continue;
+        memset(pred, 0, sizeof(*pred));
+        pred->column = i;
+        pred->op = op;
+        if (table->columns[i].type == TYPE_INT) {
+            pred->literal.int_val = atoi(where_val);
+        } else if (strcmp(op, "=") == 0 &&
+                   (table->columns[i].type == TYPE_VARCHAR || table->columns[i].type == TYPE_CHAR)) {
+            strncpy(pred->literal.string_val, where_val, MAX_STRING_LEN - 1);
+        } else {
+            return WHERE_NONE;
+        }
+        return WHERE_PREDICATE;
+    }
+    return WHERE_NONE;
+}
+
+/*
+ * MVCC update: each matching row version gets xmax = txn_id (logged as an
+ * UPDATE of the old version) and the new version is appended once the
+ * scan is done, so it is not visited again. Indexes gain entries for the
+ * new version; the old entries stay for snapshots that still see it. The
+ * scan follows the whole page chain: new versions land on later pages
+ * once the first one fills up.
+ */
+int update_record(const char* table_name, const char* column, Value* value, const char* where_clause, uint32_t txn_id) {
+    extern bool transaction_repeatable_read(uint32_t txn_id);
+    extern uint64_t wal_log_update(uint32_t txn_id, int page_id, const char* before, const char* after, int record_size);
+    
+    Table* table = find_table_by_name(table_name);
+    if (!table) return -1;
     
-    DataPage* data_page = (DataPage*)page->data;
     int record_size = calculate_record_size(table->columns, table->column_count);
     int updated_count = 0;
+    int failed = 0;             // Lock failure (e.g. LOCK_DEADLOCK) that stopped the scan
+    const Snapshot* snapshot = transaction_snapshot(txn_id);
+    bool repeatable_read = transaction_repeatable_read(txn_id);
+    bool optimistic = transaction_optimistic(txn_id);
+    char* new_versions = NULL;  // Serialized new versions, appended after the scan
     
     // Find column index
     int col_idx = -1;
@@ -294,178 +667,223 @@ int update_record(const char* table_name, const char* column, Value* value, cons
             break;
         }
     }
+    if (col_idx == -1) return -1;
     
-    if (col_idx == -1) {
-        unpin_page(page);
-        return -1;
-    }
+    BoundPredicate pred;
+    DmlWhere where = bind_dml_where(table, where_clause, &pred);
+    int predicate_count = where == WHERE_PREDICATE ? 1 : 0;
+    int data_page_id = where == WHERE_NONE ? -1 : table->table_id;
     
-    // Process WHERE clause if provided
-    for (int row = 0; row < data_page->record_count; row++) {
-        char* record_ptr = data_page->records + (row * record_size);
-        Value record_values[MAX_COLUMNS];
-        bool deleted;
+    while (data_page_id != -1 && !failed) {
+        int next_page;
+        if (!zone_map_page_may_match(data_page_id, table, &pred, predicate_count, &next_page)) {
+            data_page_id = next_page;
+            continue;
+        }
         
-        deserialize_record(table->columns, table->column_count, record_ptr, record_values, &deleted);
+        Page* page = get_page(data_page_id, txn_id);
+        if (!page) {
+            failed = -1;
+            break;
+        }
+        DataPage* data_page = (DataPage*)page->data;
+        uint64_t first_lsn = 0;     // First WAL record for this page, for its rec_lsn
         
-        if (!deleted) {
-            bool should_update = true;
+        for (int row = 0; row < data_page->record_count; row++) {
+            char* record_ptr = data_page->records + (row * record_size);
+            Value record_values[MAX_COLUMNS];
+            bool deleted;
             
-            // Apply WHERE clause filter if provided
-            if (where_clause && strlen(where_clause) > 0) {
-                should_update = false;
-                // Parse WHERE clause with operators
-                char where_col[64], where_val[256], op[3];
-                if (sscanf(where_clause, "%s >= '%[^']'", where_col, where_val) == 2) { strcpy(op, ">="); }
-                else if (sscanf(where_clause, "%s <= '%[^']'", where_col, where_val) == 2) { strcpy(op, "<="); }
-                else if (sscanf(where_clause, "%s > '%[^']'", where_col, where_val) == 2) { strcpy(op, ">"); }
-                else if (sscanf(where_clause, "%s < '%[^']'", where_col, where_val) == 2) { strcpy(op, "<"); }
-                else if (sscanf(where_clause, "%s = '%[^']'", where_col, where_val) == 2) { strcpy(op, "="); }
-                else if (sscanf(where_clause, "%s >= %s", where_col, where_val) == 2) { strcpy(op, ">="); }
-                else if (sscanf(where_clause, "%s <= %s", where_col, where_val) == 2) { strcpy(op, "<="); }
-                else if (sscanf(where_clause, "%s > %s", where_col, where_val) == 2) { strcpy(op, ">"); }
-                else if (sscanf(where_clause, "%s < %s", where_col, where_val) == 2) { strcpy(op, "<"); }
-                else if (sscanf(where_clause, "%s = %s", where_col, where_val) == 2) { strcpy(op, "="); }
-                else { op[0] = '\0'; }
-                
-                if (op[0] != '\0') {
-                    // Find WHERE column
-                    for (int i = 0; i < table->column_count; i++) {
-                        if (strcasecmp(table->columns[i].name, where_col) == 0) {
-                            if (table->columns[i].type == TYPE_INT) {
-                                int where_int = atoi(where_val);
-                                int row_val = record_values[i].int_val;
-                                if (strcmp(op, "=") == 0) should_update = (row_val == where_int);
-                                else if (strcmp(op, ">") == 0) should_update = (row_val > where_int);
-                                else if (strcmp(op, "<") == 0) should_update = (row_val < where_int);
-                                else if (strcmp(op, ">=") == 0) should_update = (row_val >= where_int);
-                                else if (strcmp(op, "<=") == 0) should_update = (row_val <= where_int);
-                            } else {
-                                if (strcmp(op, "=") == 0) {
-                                    should_update = (strcmp(record_values[i].string_val, where_val) == 0);
-                                }
-                            }
-                            break;
-                        }
-                    }
-                }
+            RowWriteCheck check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_SKIP) continue;
+            deserialize_record(table->columns, table->column_count, record_ptr, record_values, &deleted);
+            if (!row_satisfies(table, record_values, &pred, predicate_count)) continue;
+            
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            
+            RecordId rid = { data_page_id, row };
+            int lock = claim_row_latched(txn_id, table->table_id, rid, optimistic, &page, first_lsn, record_size);
+            if (lock < 0) {
+                if (page) data_page = (DataPage*)page->data;
+                failed = lock;
+                break;
+            }
+            if (lock > 0) {
+                // The row may have changed while we waited: evaluate it again
+                data_page = (DataPage*)page->data;
+                row--;
+                continue;
+            }
+            // Holding the row, no other writer is left: settle the version for good
+            check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            if (check == ROW_SKIP) {
+                // Ended by the writer we waited for: not ours, so neither is its lock
+                release_row_lock(txn_id, table->table_id, rid);
+                continue;
+            }
+            
+            char* grown = realloc(new_versions, (size_t)(updated_count + 1) * record_size);
+            if (!grown) {
+                failed = -1;
+                break;
             }
+            new_versions = grown;
             
-            if (should_update) {
-                // Save before image for WAL
-                char before_image[512];
-                memcpy(before_image, record_ptr, record_size);
-                
-                record_values[col_idx] = *value;
-                serialize_record(table->columns, table->column_count, record_values, record_ptr);
-                
-                // Enable WAL logging for UPDATE operations
-                extern uint64_t wal_log_update(uint32_t txn_id, int page_id, const char* before, const char* after, int record_size);
-                if (record_size > 0 && record_size < 512) {
-                    wal_log_update(txn_id, data_page_id, before_image, record_ptr, record_size);
+            // Save before image for WAL
+            char before_image[PAGE_SIZE];
+            memcpy(before_image, record_ptr, record_size);
+            ROW_VERSION_PTR(record_ptr)->xmax = txn_id;
+            
+            if (record_size > 0) {
+                uint64_t lsn = wal_log_update(txn_id, data_page_id, before_image, record_ptr, record_size);
+                if (lsn == 0) {
+                    memcpy(record_ptr, before_image, record_size);   // Not logged: take the stamp back
+                    failed = -1;
+                    break;
                 }
-                
-                updated_count++;
+                if (first_lsn == 0) first_lsn = lsn;
+                data_page->page_lsn = lsn;
             }
+            
+            record_values[col_idx] = *value;
+            serialize_record(table->columns, table->column_count, record_values,
+                             new_versions + (size_t)updated_count * record_size);
+            updated_count++;
         }
+        
+        if (!page) break;
+        if (first_lsn != 0) mark_dirty_lsn(page, first_lsn);
+        data_page_id = data_page->next_page;
+        unpin_page(page);
     }
     
-    if (updated_count > 0) {
-        mark_dirty(page);
+    // Append the new versions (their row locks come with the insert)
+    for (int i = 0; i < updated_count && !failed; i++) {
+        Value values[MAX_COLUMNS];
+        bool deleted;
+        deserialize_record(table->columns, table->column_count, new_versions + (size_t)i * record_size, values, &deleted);
+        int ret = insert_row(table, values, txn_id);
+        if (ret < 0) failed = ret;
     }
-    unpin_page(page);
+    free(new_versions);
     
-    return updated_count;
+    return failed ? failed : updated_count;
 }
 
+/*
+ * MVCC delete: matching row versions get xmax = txn_id, logged as an
+ * UPDATE of the version. They stay on the page (and in the indexes) for
+ * snapshots that still see them. Like update_record(), walks every page.
+ */
 int delete_record(const char* table_name, const char* where_clause, uint32_t txn_id) {
+    extern bool transaction_repeatable_read(uint32_t txn_id);
+    extern uint64_t wal_log_update(uint32_t txn_id, int page_id, const char* before, const char* after, int record_size);
+    
     Table* table = find_table_by_name(table_name);
     if (!table) return -1;
     
-    int data_page_id = table->table_id;
-    Page* page = get_page(data_page_id, txn_id);
-    if (!page) return -1;
-    
-    DataPage* data_page = (DataPage*)page->data;
     int record_size = calculate_record_size(table->columns, table->column_count);
     int deleted_count = 0;
+    int failed = 0;             // Lock failure (e.g. LOCK_DEADLOCK) that stopped the scan
+    const Snapshot* snapshot = transaction_snapshot(txn_id);
+    bool repeatable_read = transaction_repeatable_read(txn_id);
+    bool optimistic = transaction_optimistic(txn_id);
+    
+    BoundPredicate pred;
+    DmlWhere where = bind_dml_where(table, where_clause, &pred);
+    int predicate_count = where == WHERE_PREDICATE ? 1 : 0;
+    int data_page_id = where == WHERE_NONE ? -1 : table->table_id;
     
-    // Process WHERE clause if provided
-    for (int row = 0; row < data_page->record_count; row++) {
-        char* record_ptr = data_page->records + (row * record_size);
-        if (record_ptr[0] == 0) { // Not already deleted
-            bool should_delete = true;
+    while (data_page_id != -1 && !failed) {
+        int next_page;
+        if (!zone_map_page_may_match(data_page_id, table, &pred, predicate_count, &next_page)) {
+            data_page_id = next_page;
+            continue;
+        }
+        
+        Page* page = get_page(data_page_id, txn_id);
+        if (!page) {
+            failed = -1;
+            break;
+        }
+        DataPage* data_page = (DataPage*)page->data;
+        uint64_t first_lsn = 0;     // First WAL record for this page, for its rec_lsn
+        
+        for (int row = 0; row < data_page->record_count; row++) {
+            char* record_ptr = data_page->records + (row * record_size);
+            RowWriteCheck check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_SKIP) continue;
             
-            // Apply WHERE clause filter if provided
-            if (where_clause && strlen(where_clause) > 0) {
-                should_delete = false;
+            if (where == WHERE_PREDICATE) {
                 Value record_values[MAX_COLUMNS];
                 bool deleted;
-                
                 deserialize_record(table->columns, table->column_count, record_ptr, record_values, &deleted);
-                
-                // Parse WHERE clause with operators
-                char where_col[64], where_val[256], op[3];
-                if (sscanf(where_clause, "%s >= '%[^']'", where_col, where_val) == 2) { strcpy(op, ">="); }
-                else if (sscanf(where_clause, "%s <= '%[^']'", where_col, where_val) == 2) { strcpy(op, "<="); }
-                else if (sscanf(where_clause, "%s > '%[^']'", where_col, where_val) == 2) { strcpy(op, ">"); }
-                else if (sscanf(where_clause, "%s < '%[^']'", where_col, where_val) == 2) { strcpy(op, "<"); }
-                else if (sscanf(where_clause, "%s = '%[^']'", where_col, where_val) == 2) { strcpy(op, "="); }
-                else if (sscanf(where_clause, "%s >= %s", where_col, where_val) == 2) { strcpy(op, ">="); }
-                else if (sscanf(where_clause, "%s <= %s", where_col, where_val) == 2) { strcpy(op, "<="); }
-                else if (sscanf(where_clause, "%s > %s", where_col, where_val) == 2) { strcpy(op, ">"); }
-                else if (sscanf(where_clause, "%s < %s", where_col, where_val) == 2) { strcpy(op, "<"); }
-                else if (sscanf(where_clause, "%s = %s", where_col, where_val) == 2) { strcpy(op, "="); }
-                else { op[0] = '\0'; }
-                
-                if (op[0] != '\0') {
-                    // Find WHERE column
-                    for (int i = 0; i < table->column_count; i++) {
-                        if (strcasecmp(table->columns[i].name, where_col) == 0) {
-                            if (table->columns[i].type == TYPE_INT) {
-                                int where_int = atoi(where_val);
-                                int row_val = record_values[i].int_val;
-                                if (strcmp(op, "=") == 0) should_delete = (row_val == where_int);
-                                else if (strcmp(op, ">") == 0) should_delete = (row_val > where_int);
-                                else if (strcmp(op, "<") == 0) should_delete = (row_val < where_int);
-                                else if (strcmp(op, ">=") == 0) should_delete = (row_val >= where_int);
-                                else if (strcmp(op, "<=") == 0) should_delete = (row_val <= where_int);
-                            } else {
-                                if (strcmp(op, "=") == 0) {
-                                    should_delete = (strcmp(record_values[i].string_val, where_val) == 0);
-                                }
-                            }
-                            break;
-                        }
-                    }
-                }
+                if (!row_satisfies(table, record_values, &pred, predicate_count)) continue;
+            }
+            
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            
+            RecordId rid = { data_page_id, row };
+            int lock = claim_row_latched(txn_id, table->table_id, rid, optimistic, &page, first_lsn, record_size);
+            if (lock < 0) {
+                if (page) data_page = (DataPage*)page->data;
+                failed = lock;
+                break;
+            }
+            if (lock > 0) {
+                // The row may have been changed or deleted while we waited
+                data_page = (DataPage*)page->data;
+                row--;
+                continue;
+            }
+            // Holding the row, no other writer is left: settle the version for good
+            check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            if (check == ROW_SKIP) {
+                // Ended by the writer we waited for: not ours, so neither is its lock
+                release_row_lock(txn_id, table->table_id, rid);
+                continue;
             }
             
-            if (should_delete) {
-                // Save before image for WAL
-                char before_image[512];
-                memcpy(before_image, record_ptr, record_size);
-                
-                // Enable WAL logging for DELETE operations
-                extern uint64_t wal_log_delete(uint32_t txn_id, int page_id, const char* record, int record_size);
-                if (record_size > 0 && record_size < 512) {
-                    wal_log_delete(txn_id, data_page_id, before_image, record_size);
+            // Save before image for WAL
+            char before_image[PAGE_SIZE];
+            memcpy(before_image, record_ptr, record_size);
+            ROW_VERSION_PTR(record_ptr)->xmax = txn_id;
+            
+            if (record_size > 0) {
+                uint64_t lsn = wal_log_update(txn_id, data_page_id, before_image, record_ptr, record_size);
+                if (lsn == 0) {
+                    memcpy(record_ptr, before_image, record_size);   // Not logged: take the stamp back
+                    failed = -1;
+                    break;
                 }
-                
-                record_ptr[0] = 1; // Mark as deleted
-                deleted_count++;
+                if (first_lsn == 0) first_lsn = lsn;
+                data_page->page_lsn = lsn;
             }
+            
+            deleted_count++;
         }
+        
+        if (!page) break;
+        if (first_lsn != 0) mark_dirty_lsn(page, first_lsn);
+        data_page_id = data_page->next_page;
+        unpin_page(page);
     }
     
-    data_page->deleted_count += deleted_count;
-    
-    if (deleted_count > 0) {
-        mark_dirty(page);
-    }
-    unpin_page(page);
-    
-    return deleted_count;
+    return failed ? failed : deleted_count;
 }
 
 int scan_table(const char* table_name, QueryResult* result, uint32_t txn_id) {
@@ -477,18 +895,17 @@ int scan_table(const char* table_name, QueryResult* result, uint32_t txn_id) {
         result->columns[i] = table->columns[i];
     }
     
-    int record_size = calculate_record_size(table->columns, table->column_count);
-    
     // Fix for recovery: always use WAL record size if available
-    extern int g_recovery_record_size;
-    if (g_recovery_record_size > 0) {
-        record_size = g_recovery_record_size;
+    int record_size = table_record_size(table);
+    if (record_size != calculate_record_size(table->columns, table->column_count)) {
         printf("SELECT: Using recovery record_size=%d (calculated=%d)\n", record_size, calculate_record_size(table->columns, table->column_count));
     }
     
     int result_row = 0;
     int current_page_id = table->table_id;
     int page_count = 0;
+    const Snapshot* snapshot = transaction_snapshot(txn_id);
+    bool optimistic = transaction_optimistic(txn_id);
     
     // Scan all pages in the chain
     while (current_page_id != -1 && result_row < MAX_RESULT_ROWS) {
@@ -504,9 +921,64 @@ int scan_table(const char* table_name, QueryResult* result, uint32_t txn_id) {
             const char* record_ptr = data_page->records + (row * record_size);
             bool deleted;
             
+            if (!row_visible(record_ptr, snapshot, txn_id)) continue;
             deserialize_record(table->columns, table->column_count, record_ptr, result->data[result_row], &deleted);
-            
-            if (!deleted) {
+            if (optimistic) record_read(txn_id, current_page_id, row, record_size, record_ptr);
+            result_row++;
+        }
+        
+        current_page_id = data_page->next_page;
+        unpin_page(page);
+    }
+    
+    result->row_count = result_row;
+    printf("scan_table: Found %d rows across %d pages for table %s\n", result_row, page_count, table_name);
+    return result->row_count;
+}
+
+/*
+ * Table scan with AND-ed predicates applied in the scan. Pages whose zone
+ * map rules out every row are skipped without being read; only matching
+ * rows count toward MAX_RESULT_ROWS.
+ */
+int scan_table_where(const char* table_name, const BoundPredicate* predicates, int predicate_count,
+                     QueryResult* result, uint32_t txn_id) {
+    Table* table = find_table_by_name(table_name);
+    if (!table) return -1;
+    
+    result->column_count = table->column_count;
+    for (int i = 0; i < table->column_count; i++) {
+        result->columns[i] = table->columns[i];
+    }
+    
+    int record_size = table_record_size(table);
+    int result_row = 0;
+    int current_page_id = table->table_id;
+    int page_count = 0;
+    int skipped_count = 0;
+    const Snapshot* snapshot = transaction_snapshot(txn_id);
+    bool optimistic = transaction_optimistic(txn_id);
+    
+    while (current_page_id != -1 && result_row < MAX_RESULT_ROWS) {
+        int next_page;
+        page_count++;
+        if (!zone_map_page_may_match(current_page_id, table, predicates, predicate_count, &next_page)) {
+            skipped_count++;
+            current_page_id = next_page;
+            continue;
+        }
+        
+        Page* page = get_page(current_page_id, txn_id);
+        if (!page) break;
+        DataPage* data_page = (DataPage*)page->data;
+        
+        for (int row = 0; row < data_page->record_count && result_row < MAX_RESULT_ROWS; row++) {
+            const char* record_ptr = data_page->records + (row * record_size);
+            bool deleted;
+            if (!row_visible(record_ptr, snapshot, txn_id)) continue;
+            deserialize_record(table->columns, table->column_count, record_ptr, result->data[result_row], &deleted);
+            if (row_satisfies(table, result->data[result_row], predicates, predicate_count)) {
+                if (optimistic) record_read(txn_id, current_page_id, row, record_size, record_ptr);
                 result_row++;
             }
         }
@@ -516,30 +988,242 @@ int scan_table(const char* table_name, QueryResult* result, uint32_t txn_id) {
     }
     
     result->row_count = result_row;
-    printf("scan_table: Found %d rows across %d pages for table %s\n", result_row, page_count, table_name);
+    printf("SCAN: Zone maps skipped %d of %d pages for table %s, %d rows matched\n",
+           skipped_count, page_count, table_name, result_row);
     return result->row_count;
 }
 
-int create_btree_index(const char* index_name, const char* table_name, const char* column_name, uint32_t txn_id) {
+/*
+ * SELECT ... FOR UPDATE: X-lock up to limit (<= 0: MAX_RESULT_ROWS) rows
+ * matching predicates and return them. Rows are chosen like UPDATE
+ * chooses them: the latest committed version, waiting for a writer still
+ * at work. With ROW_LOCK_NOWAIT a row another transaction holds fails the
+ * scan with LOCK_NOT_AVAILABLE; with ROW_LOCK_SKIP_LOCKED it is left out.
+ * A row someone is still writing counts as locked: locking writers hold
+ * its lock, OCC writers have stamped it. Returns the number of rows, or a
+ * negative error (LOCK_DEADLOCK, LOCK_TIMEOUT, SERIALIZATION_FAILURE, ...).
+ */
+int lock_rows_where(const char* table_name, const BoundPredicate* predicates, int predicate_count,
+                    RowLockPolicy policy, int limit, QueryResult* result, uint32_t txn_id) {
+    extern bool transaction_repeatable_read(uint32_t txn_id);
     Table* table = find_table_by_name(table_name);
     if (!table) return -1;
     
-    int root_page_id = allocate_page();
-    Page* page = get_page(root_page_id, txn_id);
+    result->column_count = table->column_count;
+    for (int i = 0; i < table->column_count; i++) {
+        result->columns[i] = table->columns[i];
+    }
+    if (limit <= 0 || limit > MAX_RESULT_ROWS) limit = MAX_RESULT_ROWS;
+    
+    int record_size = table_record_size(table);
+    int result_row = 0;
+    int skipped_rows = 0;
+    int failed = 0;
+    int current_page_id = table->table_id;
+    const Snapshot* snapshot = transaction_snapshot(txn_id);
+    bool repeatable_read = transaction_repeatable_read(txn_id);
+    
+    while (current_page_id != -1 && result_row < limit && !failed) {
+        int next_page;
+        if (!zone_map_page_may_match(current_page_id, table, predicates, predicate_count, &next_page)) {
+            current_page_id = next_page;
+            continue;
+        }
+        
+        Page* page = get_page(current_page_id, txn_id);
+        if (!page) break;
+        DataPage* data_page = (DataPage*)page->data;
+        
+        for (int row = 0; row < data_page->record_count && result_row < limit; row++) {
+            const char* record_ptr = data_page->records + (row * record_size);
+            bool deleted;
+            
+            RowWriteCheck check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_SKIP) continue;
+            deserialize_record(table->columns, table->column_count, record_ptr, result->data[result_row], &deleted);
+            if (!row_satisfies(table, result->data[result_row], predicates, predicate_count)) continue;
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            
+            RecordId rid = { current_page_id, row };
+            if (policy == ROW_LOCK_NOWAIT || policy == ROW_LOCK_SKIP_LOCKED) {
+                // Latched, so a writer cannot take the row between the two checks
+                bool busy = row_writer(record_ptr, txn_id) != 0;
+                if (!busy) {
+                    int lock = acquire_row_lock(txn_id, table->table_id, rid, false);
+                    if (lock < 0) {
+                        failed = lock;
+                        break;
+                    }
+                    busy = lock > 0;
+                }
+                if (busy && policy == ROW_LOCK_NOWAIT) {
+                    printf("LOCK: TXN %u found page %d slot %d locked (NOWAIT)\n", txn_id, rid.page_id, rid.slot);
+                    failed = LOCK_NOT_AVAILABLE;
+                    break;
+                }
+                if (busy) {
+                    skipped_rows++;
+                    continue;
+                }
+            } else {
+                int lock = claim_row_latched(txn_id, table->table_id, rid, false, &page, 0, record_size);
+                if (lock < 0) {
+                    if (page) data_page = (DataPage*)page->data;
+                    failed = lock;
+                    break;
+                }
+                if (lock > 0) {
+                    // The row may have changed while we waited: evaluate it again
+                    data_page = (DataPage*)page->data;
+                    row--;
+                    continue;
+                }
+            }
+            
+            // Holding the row: settle the version as update_record() does
+            check = row_write_check(record_ptr, snapshot, txn_id, repeatable_read);
+            if (check == ROW_CONFLICT) {
+                failed = SERIALIZATION_FAILURE;
+                break;
+            }
+            if (check == ROW_SKIP) {
+                // Gone by the time we held it: leave it to SKIP LOCKED and NOWAIT callers
+                release_row_lock(txn_id, table->table_id, rid);
+                continue;
+            }
+            result_row++;
+        }
+        
+        if (!page) break;
+        current_page_id = data_page->next_page;
+        unpin_page(page);
+    }
+    
+    result->row_count = result_row;
+    printf("LOCK: TXN %u locked %d rows of table %s FOR UPDATE (%d skipped)\n", txn_id, result_row,
+           table_name, skipped_rows);
+    return failed ? failed : result->row_count;
+}
+
+/*
+ * Fetch a single row by record id (used by index scans). Returns 0 when
+ * the row version is visible to txn_id, -1 otherwise. With values NULL
+ * only visibility is checked (index-only scans).
+ */
+int fetch_record(Table* table, RecordId rid, Value* values, uint32_t txn_id) {
+    int record_size = table_record_size(table);
+    
+    Page* page = get_page(rid.page_id, txn_id);
     if (!page) return -1;
     
-    BTreePage* btree_page = (BTreePage*)page->data;
-    btree_page->key_count = 0;
-    btree_page->is_leaf = 1;
-    btree_page->parent = -1;
+    DataPage* data_page = (DataPage*)page->data;
+    int ret = -1;
+    if (rid.slot >= 0 && rid.slot < data_page->record_count) {
+        const char* record_ptr = data_page->records + (rid.slot * record_size);
+        if (row_visible(record_ptr, transaction_snapshot(txn_id), txn_id)) {
+            bool deleted;
+            if (values) deserialize_record(table->columns, table->column_count, record_ptr, values, &deleted);
+            if (transaction_optimistic(txn_id)) record_read(txn_id, rid.page_id, rid.slot, record_size, record_ptr);
+            ret = 0;
+        }
+    }
     
-    mark_dirty(page);
     unpin_page(page);
+    return ret;
+}
+
+// Insert every row version of the table someone may read into a freshly created index
+static int build_index_from_heap(Index* index, Table* table, uint32_t txn_id) {
+    int record_size = table_record_size(table);
+    int current_page_id = table->table_id;
+    int row_count = 0;
     
-    int index_id = create_index_catalog(index_name, table->table_id, column_name, INDEX_BTREE, root_page_id);
+    while (current_page_id != -1) {
+        Page* page = get_page(current_page_id, txn_id);
+        if (!page) return -1;
+        DataPage* data_page = (DataPage*)page->data;
+        
+        for (int row = 0; row < data_page->record_count; row++) {
+            Value values[MAX_COLUMNS];
+            bool deleted;
+            const char* record_ptr = data_page->records + (row * record_size);
+            if (row_version_live(record_ptr)) {
+                deserialize_record(table->columns, table->column_count, record_ptr, values, &deleted);
+                RecordId rid = { current_page_id, row };
+                index_insert_row(table, index, 1, values, rid, txn_id);
+                row_count++;
+            }
+        }
+        
+        int next_page = data_page->next_page;
+        unpin_page(page);
+        current_page_id = next_page;
+    }
+    return row_count;
+}
+
+int create_btree_index(const char* index_name, const char* table_name,
+                       char key_columns[][MAX_NAME_LEN], int key_count,
+                       char include_columns[][MAX_NAME_LEN], int include_count, uint32_t txn_id) {
+    Table* table = find_table_by_name(table_name);
+    if (!table) return -1;
+    Index definition;
+    memset(&definition, 0, sizeof(definition));
+    for (int i = 0; i < key_count && i < MAX_INDEX_COLUMNS; i++) {
+        strcpy(definition.key_columns[i], key_columns[i]);
+    }
+    for (int i = 0; i < include_count && i < MAX_INDEX_COLUMNS; i++) {
+        strcpy(definition.include_columns[i], include_columns[i]);
+    }
+    definition.key_count = key_count;
+    definition.include_count = include_count;
+    if (!btree_entry_fits(&definition, table)) {
+        printf("B-Tree index %s rejected: %d key + %d included columns do not fit a page\n",
+               index_name, key_count, include_count);
+        return -1;
+    }
     
-    printf("B-Tree index %s created with index_id %d, root_page_id %d\n", 
-           index_name, index_id, root_page_id);
+    int root_page_id = btree_create(txn_id);
+    if (root_page_id < 0) return -1;
+    
+    int index_id = create_index_catalog(index_name, table->table_id, key_columns, key_count,
+                                        include_columns, include_count, INDEX_BTREE, root_page_id);
+    if (index_id < 0) return -1;
+    
+    Index* index = find_index_by_name(index_name);
+    int row_count = index ? build_index_from_heap(index, table, txn_id) : 0;
+    
+    printf("B-Tree index %s created with index_id %d, root_page_id %d, %d rows, %d key + %d included columns\n", 
+           index_name, index_id, root_page_id, row_count, key_count, include_count);
+    return index_id;
+}
+
+/*
+ * ART indexes live in memory only: the catalog records the definition (no
+ * root page) and the tree is built from the heap here and at every startup.
+ */
+int create_art_index(const char* index_name, const char* table_name,
+                     char key_columns[][MAX_NAME_LEN], int key_count,
+                     char include_columns[][MAX_NAME_LEN], int include_count, uint32_t txn_id) {
+    Table* table = find_table_by_name(table_name);
+    if (!table) return -1;
+    
+    int index_id = create_index_catalog(index_name, table->table_id, key_columns, key_count,
+                                        include_columns, include_count, INDEX_ART, -1);
+    if (index_id < 0) return -1;
+    
+    Index* index = find_index_by_name(index_name);
+    if (!index || art_reset(index) != 0) {
+        drop_index_catalog(index_name);
+        return -1;
+    }
+    int row_count = build_index_from_heap(index, table, txn_id);
+    
+    printf("ART index %s created with index_id %d, %d rows, %d key + %d included columns\n",
+           index_name, index_id, row_count, key_count, include_count);
     return index_id;
 }
 
@@ -557,14 +1241,101 @@ int create_hash_index(const char* index_name, const char* table_name, const char
     mark_dirty(page);
     unpin_page(page);
     
-    int index_id = create_index_catalog(index_name, table->table_id, column_name, INDEX_HASH, root_page_id);
+    char key_columns[1][MAX_NAME_LEN];
+    strncpy(key_columns[0], column_name, MAX_NAME_LEN - 1);
+    key_columns[0][MAX_NAME_LEN - 1] = '\0';
+    int index_id = create_index_catalog(index_name, table->table_id, key_columns, 1, NULL, 0, INDEX_HASH, root_page_id);
     
     printf("Hash index %s created with index_id %d, root_page_id %d\n", 
            index_name, index_id, root_page_id);
     return index_id;
 }
 
+/*
+ * Rebuild all B-Tree and ART indexes from table data. Index pages are not
+ * WAL-logged and ART trees are memory-only, so this runs at startup once
+ * crash recovery has restored the heap.
+ */
+int rebuild_indexes() {
+    Table* tables = malloc(sizeof(Table) * 100);
+    if (!tables) return -1;
+    int table_count = get_all_tables(tables, 100);
+    int rebuilt = 0;
+    
+    for (int t = 0; t < table_count; t++) {
+        Index indexes[MAX_TABLE_INDEXES];
+        int index_count = get_table_indexes(tables[t].table_id, indexes, MAX_TABLE_INDEXES);
+        
+        for (int i = 0; i < index_count; i++) {
+            if (indexes[i].type == INDEX_BTREE) {
+                if (btree_reset(indexes[i].root_page_id, 1) != 0) continue;
+            } else if (indexes[i].type == INDEX_ART) {
+                if (art_reset(&indexes[i]) != 0) continue;
+            } else {
+                continue;
+            }
+            
+            int rows = build_index_from_heap(&indexes[i], &tables[t], 1);
+            printf("INDEX: Rebuilt %s on %s (%d rows)\n", indexes[i].name, tables[t].name, rows);
+            rebuilt++;
+        }
+    }
+    
+    free(tables);
+    return rebuilt;
+}
+
+/*
+ * Rebuild page zone maps from table data. Like indexes they are not
+ * WAL-logged, so this runs at startup once crash recovery is done.
+ */
+int rebuild_zone_maps() {
+    Table* tables = malloc(sizeof(Table) * 100);
+    if (!tables) return -1;
+    int table_count = get_all_tables(tables, 100);
+    int pages = 0;
+    
+    for (int t = 0; t < table_count; t++) {
+        Table* table = &tables[t];
+        if (table->table_id <= SYS_TYPES_ID) continue;  // Catalog pages use their own layout
+        
+        int record_size = table_record_size(table);
+        int current_page_id = table->table_id;
+        
+        while (current_page_id != -1) {
+            Page* page = get_page(current_page_id, 1);
+            if (!page) break;
+            DataPage* data_page = (DataPage*)page->data;
+            
+            zone_map_reset_page(current_page_id, data_page->next_page);
+            for (int row = 0; row < data_page->record_count; row++) {
+                Value values[MAX_COLUMNS];
+                bool deleted;
+                const char* record_ptr = data_page->records + (row * record_size);
+                if (row_version_live(record_ptr)) {
+                    deserialize_record(table->columns, table->column_count, record_ptr, values, &deleted);
+                    zone_map_add_row(current_page_id, table, values);
+                }
+            }
+            pages++;
+            
+            int next_page = data_page->next_page;
+            unpin_page(page);
+            current_page_id = next_page;
+        }
+    }
+    
+    free(tables);
+    printf("ZONE MAP: Rebuilt zone maps for %d pages\n", pages);
+    return pages;
+}
+
 int drop_index_storage(const char* index_name, uint32_t txn_id) {
+    Index* index = find_index_by_name(index_name);
+    if (index && index->type == INDEX_ART) {
+        art_drop(index->index_id);
+    }
+    
     // In real system would deallocate index pages
     int ret = drop_index_catalog(index_name);
     
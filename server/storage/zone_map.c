@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "../../common/types.h"
+
+/**
+ * MiniDB Zone Maps
+ * ================
+ *
+ * A per-page synopsis of heap data pages that lets WHERE scans skip pages
+ * which cannot contain a matching row.
+ *
+ * ENTRY (one per data page, indexed by page id):
+ * +---------+-------+-----------+-----------+--------------------------------+
+ * | VERSION | VALID | NEXT_PAGE | ROW_COUNT | COLUMN_1 .. COLUMN_n           |
+ * +---------+-------+-----------+-----------+--------------------------------+
+ * COLUMN: [MIN][MAX][BLOOM FILTER (512 bits)]
+ *
+ * - MIN/MAX are exact for INT/BIGINT/FLOAT. For CHAR/VARCHAR only the first
+ *   ZONE_PREFIX_LEN bytes are kept; a literal is outside the range only if
+ *   its own prefix already compares strictly outside.
+ * - The Bloom filter (2 hash probes) answers `col = literal` for any type.
+ * - NEXT_PAGE mirrors the page chain, so a skipped page is never pinned or
+ *   read from disk.
+ *
+ * MAINTENANCE:
+ * - INSERT and UPDATE widen the synopsis of the page they write. DELETE
+ *   leaves it alone: the synopsis may be wider than the live rows, never
+ *   narrower.
+ * - Zone maps live in shared memory and are not WAL-logged. They are rebuilt
+ *   from the heap at startup, after crash recovery (rebuild_zone_maps()).
+ * - Only the first ZONE_MAP_COLUMNS columns and page ids below
+ *   ZONE_MAP_MAX_PAGES are summarized; anything else is always scanned.
+ *
+ * CONCURRENCY:
+ * - Writers update an entry while holding the data page (get_page()), so
+ *   there is one writer per entry. VERSION is odd during an update; readers
+ *   copy the entry and treat a torn copy as "may match".
+ */
+
+#define ZONE_MAP_MAX_PAGES 8192
+#define ZONE_MAP_COLUMNS 8
+#define ZONE_PREFIX_LEN 8
+#define ZONE_BLOOM_BITS 512
+#define ZONE_BLOOM_WORDS (ZONE_BLOOM_BITS / 64)
+
+typedef union {
+    int64_t int_val;                // INT, BIGINT
+    double float_val;               // FLOAT
+    char prefix[ZONE_PREFIX_LEN];   // CHAR, VARCHAR (NUL padded)
+} ZoneBound;
+
+typedef struct {
+    ZoneBound min;
+    ZoneBound max;
+    uint64_t bloom[ZONE_BLOOM_WORDS];
+} ZoneColumn;
+
+typedef struct {
+    uint32_t version;
+    bool valid;
+    int next_page;
+    int row_count;
+    ZoneColumn columns[ZONE_MAP_COLUMNS];
+} ZoneMapEntry;
+
+static ZoneMapEntry* zone_maps = NULL;
+
+int init_zone_maps() {
+    zone_maps = mmap(NULL, sizeof(ZoneMapEntry) * ZONE_MAP_MAX_PAGES,
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (zone_maps == MAP_FAILED) {
+        perror("Zone map mmap failed");
+        zone_maps = NULL;
+        return -1;
+    }
+    printf("Zone maps initialized for %d pages\n", ZONE_MAP_MAX_PAGES);
+    return 0;
+}
+
+void cleanup_zone_maps() {
+    if (zone_maps) {
+        munmap(zone_maps, sizeof(ZoneMapEntry) * ZONE_MAP_MAX_PAGES);
+        zone_maps = NULL;
+    }
+}
+
+static ZoneMapEntry* zone_entry(int page_id) {
+    if (!zone_maps || page_id < 0 || page_id >= ZONE_MAP_MAX_PAGES) return NULL;
+    return &zone_maps[page_id];
+}
+
+static void begin_update(ZoneMapEntry* entry) {
+    __atomic_add_fetch(&entry->version, 1, __ATOMIC_ACQ_REL);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void end_update(ZoneMapEntry* entry) {
+    __atomic_add_fetch(&entry->version, 1, __ATOMIC_RELEASE);
+}
+
+static ZoneBound to_bound(DataType type, const Value* value) {
+    ZoneBound bound;
+    memset(&bound, 0, sizeof(bound));
+    switch (type) {
+        case TYPE_INT:
+            bound.int_val = value->int_val;
+            break;
+        case TYPE_BIGINT:
+            bound.int_val = value->bigint_val;
+            break;
+        case TYPE_FLOAT:
+            bound.float_val = value->float_val;
+            break;
+        case TYPE_CHAR:
+        case TYPE_VARCHAR:
+            // Not NUL-terminated when the string fills the prefix; the rest stays zeroed
+            memcpy(bound.prefix, value->string_val, strnlen(value->string_val, ZONE_PREFIX_LEN));
+            break;
+    }
+    return bound;
+}
+
+/*
+ * Compare a stored bound with a literal. *exact is false when a string bound
+ * shares its whole stored prefix with the literal, in which case the order
+ * is unknown and 0 is returned.
+ */
+static int compare_bound(DataType type, const ZoneBound* bound, const Value* literal, bool* exact) {
+    *exact = true;
+    ZoneBound lit = to_bound(type, literal);
+    switch (type) {
+        case TYPE_INT:
+        case TYPE_BIGINT:
+            return (bound->int_val > lit.int_val) - (bound->int_val < lit.int_val);
+        case TYPE_FLOAT:
+            return (bound->float_val > lit.float_val) - (bound->float_val < lit.float_val);
+        case TYPE_CHAR:
+        case TYPE_VARCHAR:
+        default: {
+            int cmp = strncmp(bound->prefix, literal->string_val, ZONE_PREFIX_LEN);
+            if (cmp != 0) return cmp;
+            // Equal prefixes only decide the order if the bound is a whole string
+            *exact = memchr(bound->prefix, '\0', ZONE_PREFIX_LEN) != NULL;
+            return 0;
+        }
+    }
+}
+
+// FNV-1a over the value's significant bytes
+static uint64_t hash_value(DataType type, const Value* value) {
+    const unsigned char* bytes;
+    size_t len;
+    float f;
+    switch (type) {
+        case TYPE_INT:
+            bytes = (const unsigned char*)&value->int_val;
+            len = sizeof(value->int_val);
+            break;
+        case TYPE_BIGINT:
+            bytes = (const unsigned char*)&value->bigint_val;
+            len = sizeof(value->bigint_val);
+            break;
+        case TYPE_FLOAT:
+            f = value->float_val == 0.0f ? 0.0f : value->float_val;   // -0 equals 0
+            bytes = (const unsigned char*)&f;
+            len = sizeof(f);
+            break;
+        case TYPE_CHAR:
+        case TYPE_VARCHAR:
+        default:
+            bytes = (const unsigned char*)value->string_val;
+            len = strlen(value->string_val);
+            break;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool bloom_may_contain(const ZoneColumn* column, uint64_t hash) {
+    uint32_t a = (uint32_t)hash % ZONE_BLOOM_BITS;
+    uint32_t b = (uint32_t)(hash >> 32) % ZONE_BLOOM_BITS;
+    return (column->bloom[a / 64] >> (a % 64) & 1) && (column->bloom[b / 64] >> (b % 64) & 1);
+}
+
+static void bloom_add(ZoneColumn* column, uint64_t hash) {
+    uint32_t a = (uint32_t)hash % ZONE_BLOOM_BITS;
+    uint32_t b = (uint32_t)(hash >> 32) % ZONE_BLOOM_BITS;
+    column->bloom[a / 64] |= 1ULL << (a % 64);
+    column->bloom[b / 64] |= 1ULL << (b % 64);
+}
+
+// Start an empty synopsis for a fresh (or rescanned) data page
+void zone_map_reset_page(int page_id, int next_page) {
+    ZoneMapEntry* entry = zone_entry(page_id);
+    if (!entry) return;
+    begin_update(entry);
+    entry->valid = true;
+    entry->next_page = next_page;
+    entry->row_count = 0;
+    memset(entry->columns, 0, sizeof(entry->columns));
+    end_update(entry);
+}
+
+void zone_map_set_next(int page_id, int next_page) {
+    ZoneMapEntry* entry = zone_entry(page_id);
+    if (!entry) return;
+    begin_update(entry);
+    entry->next_page = next_page;
+    end_update(entry);
+}
+
+// Widen the page synopsis to cover a row written to it
+void zone_map_add_row(int page_id, const Table* table, const Value* values) {
+    ZoneMapEntry* entry = zone_entry(page_id);
+    if (!entry || !entry->valid) return;
+
+    begin_update(entry);
+    int count = table->column_count < ZONE_MAP_COLUMNS ? table->column_count : ZONE_MAP_COLUMNS;
+    for (int i = 0; i < count; i++) {
+        DataType type = table->columns[i].type;
+        ZoneColumn* column = &entry->columns[i];
+        bool exact;
+        if (entry->row_count == 0 || compare_bound(type, &column->min, &values[i], &exact) > 0) {
+            column->min = to_bound(type, &values[i]);
+        }
+        if (entry->row_count == 0 || compare_bound(type, &column->max, &values[i], &exact) < 0) {
+            column->max = to_bound(type, &values[i]);
+        }
+        bloom_add(column, hash_value(type, &values[i]));
+    }
+    entry->row_count++;
+    end_update(entry);
+}
+
+// True only if no row summarized by the column can satisfy the predicate
+static bool column_excludes(DataType type, const ZoneColumn* column, const BoundPredicate* pred) {
+    bool min_exact, max_exact;
+    int min_cmp = compare_bound(type, &column->min, &pred->literal, &min_exact);
+    int max_cmp = compare_bound(type, &column->max, &pred->literal, &max_exact);
+
+    if (strcmp(pred->op, "=") == 0) {
+        if (min_cmp > 0 || max_cmp < 0) return true;
+        return !bloom_may_contain(column, hash_value(type, &pred->literal));
+    }
+    if (strcmp(pred->op, ">") == 0) return max_cmp < 0 || (max_cmp == 0 && max_exact);
+    if (strcmp(pred->op, ">=") == 0) return max_cmp < 0;
+    if (strcmp(pred->op, "<") == 0) return min_cmp > 0 || (min_cmp == 0 && min_exact);
+    if (strcmp(pred->op, "<=") == 0) return min_cmp > 0;
+    return false;
+}
+
+/*
+ * Consult the synopsis of a page before reading it. Returns true if the page
+ * may hold a row matching all predicates (or has no usable synopsis); when it
+ * returns false, *next_page is the page that follows it in the chain.
+ */
+bool zone_map_page_may_match(int page_id, const Table* table, const BoundPredicate* predicates,
+                             int predicate_count, int* next_page) {
+    ZoneMapEntry* shared = zone_entry(page_id);
+    if (!shared) return true;
+
+    uint32_t version = __atomic_load_n(&shared->version, __ATOMIC_ACQUIRE);
+    if (version & 1) return true;
+    ZoneMapEntry entry;
+    memcpy(&entry, shared, sizeof(entry));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&shared->version, __ATOMIC_RELAXED) != version || !entry.valid) return true;
+
+    bool excluded = entry.row_count == 0;
+    for (int p = 0; p < predicate_count && !excluded; p++) {
+        int col = predicates[p].column;
+        if (col < 0 || col >= ZONE_MAP_COLUMNS || col >= table->column_count) continue;
+        excluded = column_excludes(table->columns[col].type, &entry.columns[col], &predicates[p]);
+    }
+    if (!excluded) return true;
+
+    *next_page = entry.next_page;
+    return false;
+}
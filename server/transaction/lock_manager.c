@@ -0,0 +1,744 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "../../common/types.h"
+
+/**
+ * MiniDB Lock Manager
+ * ===================
+ *
+ * Hierarchical two-phase locks on tables (resource 1 is the system
+ * catalog) and rows, held until the owning transaction releases them all.
+ *
+ * LOCK TABLE:
+ * - A hash table of lock heads, one per locked resource, created on first
+ *   request and freed when its last request goes away. Buckets are guarded
+ *   by LOCK_PARTITIONS mutexes, so unrelated resources do not contend.
+ * - Each head keeps its requests in arrival order (granted and waiting)
+ *   and a count of granted requests per mode.
+ * - Each transaction keeps a list of its own requests, so releasing locks
+ *   costs O(locks held) instead of a walk over the whole table. Lists are
+ *   keyed by transaction table slot, which no other live transaction
+ *   shares, and allocated in chunks as the transaction table grows.
+ *   Transactions outside the table (the system transaction) share one.
+ *
+ * MODES AND COMPATIBILITY (+ = compatible):
+ *            IS   IX   S    SIX  X
+ *     IS     +    +    +    +    -
+ *     IX     +    +    -    -    -
+ *     S      +    -    +    -    -
+ *     SIX    +    -    -    -    -
+ *     X      -    -    -    -    -
+ *
+ * GRANTING:
+ * - A new request is granted when it is compatible with every lock other
+ *   transactions hold and nobody is queued ahead of it (FIFO, so a stream
+ *   of readers cannot starve a writer).
+ * - A transaction that already holds the resource converts its lock to the
+ *   least mode covering both (e.g. S + IX = SIX). Conversions only wait for
+ *   conflicting holders, not for the queue.
+ * - Waiters sleep on the head's condition variable and are woken whenever
+ *   a lock on the resource is released.
+ * - lock_try_acquire() never waits, so callers holding a page latch can
+ *   back off, drop the latch and wait with lock_acquire() instead.
+ * - A wait longer than the transaction's lock_timeout (SET lock_timeout,
+ *   per session; 0 waits indefinitely) is withdrawn and lock_acquire()
+ *   returns LOCK_TIMEOUT. Only the statement fails; the transaction keeps
+ *   the locks it already holds.
+ *
+ * ROW LOCKS AND ESCALATION:
+ * - A row lock (tag with a TID) requires the matching intention lock on
+ *   its table (IS for S, IX for X), which the transaction must already
+ *   hold. A table lock that covers the row (X, or S/SIX for a shared row
+ *   lock) makes the row lock unnecessary.
+ * - The table-level request counts the transaction's row locks on that
+ *   table. Once the count reaches the escalation threshold (SET
+ *   lock_escalation_threshold, LOCK_ESCALATION_THRESHOLD by default), the
+ *   table lock is converted to S or X and the row locks are released.
+ *
+ * DEADLOCK DETECTION:
+ * - A waiter that has slept DEADLOCK_TIMEOUT_MS without being granted
+ *   builds the wait-for graph from the wait queues: an edge T1 -> T2 for
+ *   every lock T2 holds (or is queued for ahead of T1) in a mode that
+ *   conflicts with the one T1 waits for. Detection runs only when someone
+ *   has waited that long, so uncontended locking never pays for it.
+ * - If the graph has a cycle through the waiter, the transaction on the
+ *   cycle holding the fewest locks (the youngest on a tie) is the victim:
+ *   its request is withdrawn and lock_acquire() returns LOCK_DEADLOCK, so
+ *   the caller aborts it. Every other transaction keeps its locks.
+ */
+
+#define LOCK_HASH_SIZE 4096     // Lock head buckets
+#define LOCK_PARTITIONS 16      // Bucket mutexes (bucket % LOCK_PARTITIONS)
+#ifndef LOCK_ESCALATION_THRESHOLD
+#define LOCK_ESCALATION_THRESHOLD 1000  // Row locks per table before escalating to a table lock
+#endif
+#ifndef DEADLOCK_TIMEOUT_MS
+#define DEADLOCK_TIMEOUT_MS 1000        // Lock wait before looking for a deadlock
+#endif
+
+struct LockHead;
+
+typedef struct LockRequest {
+    uint32_t txn_id;
+    LockMode mode;
+    bool granted;
+    bool waiting;                      // Queued for wait_mode (a conversion if also granted)
+    bool deadlock_victim;              // Chosen to break a deadlock; the waiter gives up
+    LockMode wait_mode;
+    int row_locks;                     // Table locks: rows of the table this transaction has locked
+    struct LockHead* head;
+    struct LockRequest* queue_next;    // Head's queue, in arrival order
+    struct LockRequest* txn_next;      // Owner's lock list
+} LockRequest;
+
+typedef struct LockHead {
+    LockTag tag;
+    int granted_count[LOCK_MODE_COUNT];
+    LockRequest* queue;
+    LockRequest* queue_tail;
+    pthread_cond_t wait_cond;
+    struct LockHead* next;             // Bucket chain
+} LockHead;
+
+typedef struct {
+    LockRequest* locks;                // Requests granted to the slot's transaction
+    pthread_mutex_t mutex;
+} LockOwner;
+
+static LockHead* lock_table[LOCK_HASH_SIZE];
+static pthread_mutex_t partition_mutex[LOCK_PARTITIONS];
+static LockOwner* owner_chunks[TXN_TABLE_CHUNKS];  // Lock lists by transaction table slot
+static LockOwner unlisted_owner;    // Transactions without a slot
+static pthread_once_t lock_manager_once = PTHREAD_ONCE_INIT;
+static int escalation_threshold = LOCK_ESCALATION_THRESHOLD;
+
+// Modes each mode conflicts with, as bit masks over LockMode
+#define MODE_BIT(mode) (1 << (mode))
+static const int lock_conflicts[LOCK_MODE_COUNT] = {
+    [LOCK_IS]  = MODE_BIT(LOCK_X),
+    [LOCK_IX]  = MODE_BIT(LOCK_S) | MODE_BIT(LOCK_SIX) | MODE_BIT(LOCK_X),
+    [LOCK_S]   = MODE_BIT(LOCK_IX) | MODE_BIT(LOCK_SIX) | MODE_BIT(LOCK_X),
+    [LOCK_SIX] = MODE_BIT(LOCK_IX) | MODE_BIT(LOCK_S) | MODE_BIT(LOCK_SIX) | MODE_BIT(LOCK_X),
+    [LOCK_X]   = MODE_BIT(LOCK_IS) | MODE_BIT(LOCK_IX) | MODE_BIT(LOCK_S) | MODE_BIT(LOCK_SIX) | MODE_BIT(LOCK_X),
+};
+
+// Least mode at least as strong as both (lock conversion)
+static const LockMode lock_supremum[LOCK_MODE_COUNT][LOCK_MODE_COUNT] = {
+    /* IS  */ { LOCK_IS,  LOCK_IX,  LOCK_S,   LOCK_SIX, LOCK_X },
+    /* IX  */ { LOCK_IX,  LOCK_IX,  LOCK_SIX, LOCK_SIX, LOCK_X },
+    /* S   */ { LOCK_S,   LOCK_SIX, LOCK_S,   LOCK_SIX, LOCK_X },
+    /* SIX */ { LOCK_SIX, LOCK_SIX, LOCK_SIX, LOCK_SIX, LOCK_X },
+    /* X   */ { LOCK_X,   LOCK_X,   LOCK_X,   LOCK_X,   LOCK_X },
+};
+
+const char* lock_mode_name(LockMode mode) {
+    static const char* names[LOCK_MODE_COUNT] = { "IS", "IX", "S", "SIX", "X" };
+    return mode < LOCK_MODE_COUNT ? names[mode] : "?";
+}
+
+static void init_lock_manager() {
+    for (int i = 0; i < LOCK_PARTITIONS; i++) {
+        pthread_mutex_init(&partition_mutex[i], NULL);
+    }
+    pthread_mutex_init(&unlisted_owner.mutex, NULL);
+}
+
+static int lock_bucket(LockTag tag) {
+    uint32_t hash = (uint32_t)tag.table_id * 2654435761u;
+    hash = (hash ^ (uint32_t)tag.page_id) * 2654435761u;
+    hash = (hash ^ (uint32_t)tag.slot) * 2654435761u;
+    return hash % LOCK_HASH_SIZE;
+}
+
+static bool tag_equal(LockTag a, LockTag b) {
+    return a.table_id == b.table_id && a.page_id == b.page_id && a.slot == b.slot;
+}
+
+static LockTag table_tag(int table_id) {
+    LockTag tag = { table_id, -1, -1 };
+    return tag;
+}
+
+/*
+ * Lock list of txn_id, by its transaction table slot. With create, adds
+ * the slot's chunk on first use (a racing thread may have added it
+ * already); NULL if that fails, or without create if the chunk was never
+ * needed, in which case the transaction holds no locks.
+ */
+static LockOwner* lock_owner(uint32_t txn_id, bool create) {
+    extern int transaction_slot(uint32_t txn_id);
+    int slot = transaction_slot(txn_id);
+    if (slot < 0) return &unlisted_owner;
+    
+    LockOwner** chunk_ref = &owner_chunks[slot / TXN_SLOTS_PER_CHUNK];
+    LockOwner* chunk = __atomic_load_n(chunk_ref, __ATOMIC_ACQUIRE);
+    if (!chunk && create) {
+        LockOwner* fresh = calloc(TXN_SLOTS_PER_CHUNK, sizeof(LockOwner));
+        if (!fresh) {
+            printf("LOCK: Cannot allocate lock lists for TXN %u\n", txn_id);
+            return NULL;
+        }
+        for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+            pthread_mutex_init(&fresh[i].mutex, NULL);
+        }
+        if (__atomic_compare_exchange_n(chunk_ref, &chunk, fresh, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            chunk = fresh;
+        } else {
+            for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+                pthread_mutex_destroy(&fresh[i].mutex);
+            }
+            free(fresh);
+        }
+    }
+    return chunk ? &chunk[slot % TXN_SLOTS_PER_CHUNK] : NULL;
+}
+
+// Modes granted to transactions other than txn_id, as a bit mask
+static int granted_to_others(LockHead* head, uint32_t txn_id) {
+    int count[LOCK_MODE_COUNT];
+    memcpy(count, head->granted_count, sizeof(count));
+    for (LockRequest* req = head->queue; req; req = req->queue_next) {
+        if (req->granted && req->txn_id == txn_id) count[req->mode]--;
+    }
+    int mask = 0;
+    for (int mode = 0; mode < LOCK_MODE_COUNT; mode++) {
+        if (count[mode] > 0) mask |= MODE_BIT(mode);
+    }
+    return mask;
+}
+
+// Can request (queued on its head) be granted mode now? Caller holds the partition mutex.
+static bool lock_grantable(LockRequest* request, LockMode mode, bool conversion) {
+    LockHead* head = request->head;
+    if (granted_to_others(head, request->txn_id) & lock_conflicts[mode]) return false;
+    if (conversion) return true;
+    for (LockRequest* req = head->queue; req && req != request; req = req->queue_next) {
+        if (!req->granted) return false;   // FIFO: someone is waiting ahead of us
+    }
+    return true;
+}
+
+// Find (or, with create, add) the head for tag. Caller holds its partition mutex.
+static LockHead* find_head(LockTag tag, int bucket, bool create) {
+    LockHead* head = lock_table[bucket];
+    while (head && !tag_equal(head->tag, tag)) head = head->next;
+    if (!head && create) {
+        head = calloc(1, sizeof(LockHead));
+        if (!head) return NULL;
+        head->tag = tag;
+        pthread_cond_init(&head->wait_cond, NULL);
+        head->next = lock_table[bucket];
+        lock_table[bucket] = head;
+    }
+    return head;
+}
+
+// Granted request of txn_id on head, if any. Caller holds the partition mutex.
+static LockRequest* held_request(LockHead* head, uint32_t txn_id) {
+    LockRequest* request = head->queue;
+    while (request && !(request->txn_id == txn_id && request->granted)) request = request->queue_next;
+    return request;
+}
+
+// Free a head without requests. Caller holds its partition mutex.
+static void drop_head(LockHead* head, int bucket) {
+    LockHead** chain = &lock_table[bucket];
+    while (*chain != head) chain = &(*chain)->next;
+    *chain = head->next;
+    pthread_cond_destroy(&head->wait_cond);
+    free(head);
+}
+
+// Unlink a request from its head and free it (and the head once unused). Caller holds the partition mutex.
+static void remove_request(LockRequest* request, int bucket) {
+    LockHead* head = request->head;
+    LockRequest* prev = NULL;
+    for (LockRequest* req = head->queue; req != request; req = req->queue_next) prev = req;
+    if (prev) {
+        prev->queue_next = request->queue_next;
+    } else {
+        head->queue = request->queue_next;
+    }
+    if (head->queue_tail == request) head->queue_tail = prev;
+    if (request->granted) head->granted_count[request->mode]--;
+    free(request);
+    
+    if (head->queue) {
+        pthread_cond_broadcast(&head->wait_cond);
+    } else {
+        drop_head(head, bucket);
+    }
+}
+
+typedef struct {
+    uint32_t waiter;
+    uint32_t holder;
+} WaitEdge;
+
+typedef struct {
+    WaitEdge* edges;
+    int count;
+    int capacity;
+} WaitForGraph;
+
+static void add_edge(WaitForGraph* graph, uint32_t waiter, uint32_t holder) {
+    for (int i = 0; i < graph->count; i++) {
+        if (graph->edges[i].waiter == waiter && graph->edges[i].holder == holder) return;
+    }
+    if (graph->count == graph->capacity) {
+        int capacity = graph->capacity ? graph->capacity * 2 : 64;
+        WaitEdge* edges = realloc(graph->edges, capacity * sizeof(WaitEdge));
+        if (!edges) return;
+        graph->edges = edges;
+        graph->capacity = capacity;
+    }
+    graph->edges[graph->count].waiter = waiter;
+    graph->edges[graph->count].holder = holder;
+    graph->count++;
+}
+
+// Wait-for edges of every queued request. Caller holds all partition mutexes.
+static void build_wait_for_graph(WaitForGraph* graph) {
+    for (int bucket = 0; bucket < LOCK_HASH_SIZE; bucket++) {
+        for (LockHead* head = lock_table[bucket]; head; head = head->next) {
+            for (LockRequest* waiter = head->queue; waiter; waiter = waiter->queue_next) {
+                if (!waiter->waiting || waiter->deadlock_victim) continue;   // Victims are leaving
+                int conflicts = lock_conflicts[waiter->wait_mode];
+                bool ahead = true;
+                for (LockRequest* req = head->queue; req; req = req->queue_next) {
+                    if (req == waiter) {
+                        ahead = false;
+                        continue;
+                    }
+                    if (req->txn_id == waiter->txn_id) continue;
+                    // Conversions wait only for holders; new requests also for the queue ahead
+                    bool blocks = req->granted ? (conflicts & MODE_BIT(req->mode)) != 0
+                                               : ahead && !waiter->granted && (conflicts & MODE_BIT(req->wait_mode));
+                    if (blocks) add_edge(graph, waiter->txn_id, req->txn_id);
+                }
+            }
+        }
+    }
+}
+
+// Depth-first search for a path from txn_id back to target. Returns the cycle length in path, 0 if none.
+static int find_cycle(WaitForGraph* graph, uint32_t txn_id, uint32_t target,
+                      uint32_t* path, int depth, int max_depth) {
+    if (depth >= max_depth) return 0;
+    for (int i = 0; i < depth; i++) {
+        if (path[i] == txn_id) return 0;   // Cycle not through target
+    }
+    path[depth] = txn_id;
+    for (int i = 0; i < graph->count; i++) {
+        if (graph->edges[i].waiter != txn_id) continue;
+        uint32_t holder = graph->edges[i].holder;
+        if (holder == target) return depth + 1;
+        int length = find_cycle(graph, holder, target, path, depth + 1, max_depth);
+        if (length) return length;
+    }
+    return 0;
+}
+
+// Locks (granted requests) txn_id holds. Caller holds all partition mutexes.
+static int locks_held(uint32_t txn_id) {
+    int count = 0;
+    for (int bucket = 0; bucket < LOCK_HASH_SIZE; bucket++) {
+        for (LockHead* head = lock_table[bucket]; head; head = head->next) {
+            for (LockRequest* req = head->queue; req; req = req->queue_next) {
+                if (req->granted && req->txn_id == txn_id) count++;
+            }
+        }
+    }
+    return count;
+}
+
+/*
+ * Look for a deadlock involving txn_id (which is waiting) and, if there is
+ * one, mark the victim's waiting request and wake it.
+ */
+static void detect_deadlock(uint32_t txn_id) {
+    for (int i = 0; i < LOCK_PARTITIONS; i++) pthread_mutex_lock(&partition_mutex[i]);
+    
+    WaitForGraph graph = { NULL, 0, 0 };
+    build_wait_for_graph(&graph);
+    
+    int max_depth = graph.count + 1;
+    uint32_t* path = calloc(max_depth, sizeof(uint32_t));
+    int length = path ? find_cycle(&graph, txn_id, txn_id, path, 0, max_depth) : 0;
+    if (length > 0) {
+        uint32_t victim = path[0];
+        int victim_locks = locks_held(victim);
+        for (int i = 1; i < length; i++) {
+            int locks = locks_held(path[i]);
+            if (locks < victim_locks || (locks == victim_locks && path[i] > victim)) {
+                victim = path[i];
+                victim_locks = locks;
+            }
+        }
+        
+        char cycle[256];
+        int pos = 0;
+        for (int i = 0; i < length && pos < (int)sizeof(cycle) - 24; i++) {
+            pos += snprintf(cycle + pos, sizeof(cycle) - pos, "%u -> ", path[i]);
+        }
+        snprintf(cycle + pos, sizeof(cycle) - pos, "%u", path[0]);
+        printf("LOCK: Deadlock detected (TXN %s), aborting TXN %u holding %d locks\n",
+               cycle, victim, victim_locks);
+        
+        for (int bucket = 0; bucket < LOCK_HASH_SIZE; bucket++) {
+            for (LockHead* head = lock_table[bucket]; head; head = head->next) {
+                for (LockRequest* req = head->queue; req; req = req->queue_next) {
+                    if (req->waiting && req->txn_id == victim) {
+                        req->deadlock_victim = true;
+                        pthread_cond_broadcast(&head->wait_cond);
+                    }
+                }
+            }
+        }
+    }
+    free(path);
+    free(graph.edges);
+    
+    for (int i = LOCK_PARTITIONS - 1; i >= 0; i--) pthread_mutex_unlock(&partition_mutex[i]);
+}
+
+// Absolute time timeout_ms from now
+static void wait_deadline(struct timespec* deadline, int timeout_ms) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool deadline_before(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/*
+ * Sleep until request can be granted mode, looking for a deadlock each
+ * time a wait of DEADLOCK_TIMEOUT_MS passes. Returns 0 once grantable,
+ * LOCK_DEADLOCK if the request was chosen as a deadlock victim,
+ * LOCK_TIMEOUT once the transaction's lock_timeout has passed. Caller
+ * holds mutex, the request's partition mutex.
+ */
+static int lock_wait(LockRequest* request, LockMode mode, bool conversion, pthread_mutex_t* mutex) {
+    extern int transaction_lock_timeout(uint32_t txn_id);
+    LockHead* head = request->head;
+    int ret = 0;
+    request->waiting = true;
+    request->wait_mode = mode;
+    
+    int timeout_ms = transaction_lock_timeout(request->txn_id);
+    struct timespec deadline, timeout;
+    wait_deadline(&deadline, DEADLOCK_TIMEOUT_MS);
+    if (timeout_ms > 0) wait_deadline(&timeout, timeout_ms);
+    
+    while (!lock_grantable(request, mode, conversion)) {
+        if (request->deadlock_victim) {
+            ret = LOCK_DEADLOCK;
+            break;
+        }
+        bool timeout_first = timeout_ms > 0 && deadline_before(&timeout, &deadline);
+        if (pthread_cond_timedwait(&head->wait_cond, mutex, timeout_first ? &timeout : &deadline) != ETIMEDOUT) {
+            continue;
+        }
+        if (timeout_first) {
+            printf("LOCK: TXN %u gave up waiting after lock_timeout = %d ms\n", request->txn_id, timeout_ms);
+            ret = LOCK_TIMEOUT;
+            break;
+        }
+        pthread_mutex_unlock(mutex);
+        detect_deadlock(request->txn_id);
+        pthread_mutex_lock(mutex);
+        wait_deadline(&deadline, DEADLOCK_TIMEOUT_MS);
+    }
+    request->waiting = false;
+    request->deadlock_victim = false;
+    return ret;
+}
+
+/*
+ * Lock one resource. Returns 0 once granted, 1 if wait is false and the
+ * lock cannot be granted right away (nothing is queued), LOCK_DEADLOCK if
+ * the transaction was chosen as a deadlock victim, LOCK_TIMEOUT if it
+ * waited longer than its lock_timeout, -1 on failure.
+ */
+static int lock_resource(uint32_t txn_id, LockTag tag, LockMode mode, bool wait) {
+    LockOwner* owner = lock_owner(txn_id, true);
+    if (!owner) return -1;
+    int bucket = lock_bucket(tag);
+    pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+    pthread_mutex_lock(mutex);
+    
+    LockHead* head = find_head(tag, bucket, true);
+    if (!head) {
+        pthread_mutex_unlock(mutex);
+        return -1;
+    }
+    
+    // Already held: convert to the least mode covering both
+    LockRequest* request = held_request(head, txn_id);
+    if (request) {
+        LockMode target = lock_supremum[request->mode][mode];
+        if (target != request->mode) {
+            if (!lock_grantable(request, target, true)) {
+                if (!wait) {
+                    pthread_mutex_unlock(mutex);
+                    return 1;
+                }
+                int ret = lock_wait(request, target, true, mutex);
+                if (ret != 0) {
+                    pthread_mutex_unlock(mutex);
+                    return ret;
+                }
+            }
+            head->granted_count[request->mode]--;
+            head->granted_count[target]++;
+            request->mode = target;
+        }
+        pthread_mutex_unlock(mutex);
+        return 0;
+    }
+    
+    request = calloc(1, sizeof(LockRequest));
+    if (!request) {
+        if (!head->queue) drop_head(head, bucket);
+        pthread_mutex_unlock(mutex);
+        return -1;
+    }
+    request->txn_id = txn_id;
+    request->mode = mode;
+    request->head = head;
+    if (head->queue_tail) {
+        head->queue_tail->queue_next = request;
+    } else {
+        head->queue = request;
+    }
+    head->queue_tail = request;
+    
+    if (!lock_grantable(request, mode, false)) {
+        if (!wait) {
+            remove_request(request, bucket);
+            pthread_mutex_unlock(mutex);
+            return 1;
+        }
+        int ret = lock_wait(request, mode, false, mutex);
+        if (ret != 0) {
+            remove_request(request, bucket);
+            pthread_mutex_unlock(mutex);
+            return ret;
+        }
+    }
+    request->granted = true;
+    head->granted_count[mode]++;
+    pthread_mutex_unlock(mutex);
+    
+    pthread_mutex_lock(&owner->mutex);
+    request->txn_next = owner->locks;
+    owner->locks = request;
+    pthread_mutex_unlock(&owner->mutex);
+    return 0;
+}
+
+// Release txn_id's row locks on table_id (after escalation)
+static void release_row_locks(uint32_t txn_id, int table_id) {
+    LockOwner* owner = lock_owner(txn_id, false);
+    if (!owner) return;
+    pthread_mutex_lock(&owner->mutex);
+    LockRequest** link = &owner->locks;
+    while (*link) {
+        LockRequest* request = *link;
+        LockTag tag = request->head->tag;
+        if (request->txn_id != txn_id || tag.table_id != table_id || tag.page_id < 0) {
+            link = &request->txn_next;
+            continue;
+        }
+        *link = request->txn_next;
+        int bucket = lock_bucket(tag);
+        pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+        pthread_mutex_lock(mutex);
+        remove_request(request, bucket);
+        pthread_mutex_unlock(mutex);
+    }
+    pthread_mutex_unlock(&owner->mutex);
+}
+
+/*
+ * Lock a row, given the intention lock on its table. Skips the row lock
+ * when the table lock already covers it, and escalates to a table lock
+ * once the transaction holds escalation_threshold row locks on the table.
+ */
+static int lock_row(uint32_t txn_id, LockTag tag, LockMode mode, bool wait) {
+    LockTag parent = table_tag(tag.table_id);
+    int bucket = lock_bucket(parent);
+    pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+    
+    pthread_mutex_lock(mutex);
+    LockHead* head = find_head(parent, bucket, false);
+    LockRequest* table_lock = head ? held_request(head, txn_id) : NULL;
+    if (!table_lock) {
+        pthread_mutex_unlock(mutex);
+        printf("LOCK: TXN %u locks a row of table %d without an intention lock\n", txn_id, tag.table_id);
+        return -1;
+    }
+    LockMode table_mode = table_lock->mode;
+    bool escalate = table_lock->row_locks >= escalation_threshold;
+    pthread_mutex_unlock(mutex);
+    
+    if (table_mode == LOCK_X || (mode == LOCK_S && (table_mode == LOCK_S || table_mode == LOCK_SIX))) {
+        return 0;   // Covered by the table lock
+    }
+    
+    if (escalate) {
+        int ret = lock_resource(txn_id, parent, mode == LOCK_X ? LOCK_X : LOCK_S, wait);
+        if (ret != 0) return ret;
+        release_row_locks(txn_id, tag.table_id);
+        printf("LOCK: TXN %u escalated to a table %s lock on table %d\n", txn_id,
+               mode == LOCK_X ? "X" : "S", tag.table_id);
+        return 0;
+    }
+    
+    // Count new row locks on the table request (re-requests do not add one)
+    int row_bucket = lock_bucket(tag);
+    pthread_mutex_t* row_mutex = &partition_mutex[row_bucket % LOCK_PARTITIONS];
+    pthread_mutex_lock(row_mutex);
+    LockHead* row_head = find_head(tag, row_bucket, false);
+    bool held = row_head && held_request(row_head, txn_id);
+    pthread_mutex_unlock(row_mutex);
+    
+    int ret = lock_resource(txn_id, tag, mode, wait);
+    if (ret == 0 && !held) {
+        pthread_mutex_lock(mutex);
+        head = find_head(parent, bucket, false);
+        table_lock = head ? held_request(head, txn_id) : NULL;
+        if (table_lock) table_lock->row_locks++;
+        pthread_mutex_unlock(mutex);
+    }
+    return ret;
+}
+
+/*
+ * Acquire a lock for txn_id, waiting until it can be granted. Re-requesting
+ * a held resource converts the lock (never weakens it). Returns 0 once
+ * granted, LOCK_DEADLOCK if waiting would deadlock and this transaction
+ * was chosen as the victim, LOCK_TIMEOUT after lock_timeout, -1 on failure.
+ */
+int lock_acquire(uint32_t txn_id, LockTag tag, LockMode mode) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    return tag.page_id < 0 ? lock_resource(txn_id, tag, mode, true) : lock_row(txn_id, tag, mode, true);
+}
+
+// Like lock_acquire(), but returns 1 instead of waiting
+int lock_try_acquire(uint32_t txn_id, LockTag tag, LockMode mode) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    return tag.page_id < 0 ? lock_resource(txn_id, tag, mode, false) : lock_row(txn_id, tag, mode, false);
+}
+
+/*
+ * Does a transaction other than txn_id hold tag in a mode that conflicts
+ * with mode? Only a probe: nothing is queued and nothing waits.
+ */
+bool lock_held_by_other(uint32_t txn_id, LockTag tag, LockMode mode) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    int bucket = lock_bucket(tag);
+    pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+    pthread_mutex_lock(mutex);
+    LockHead* head = find_head(tag, bucket, false);
+    bool held = head && (granted_to_others(head, txn_id) & lock_conflicts[mode]) != 0;
+    pthread_mutex_unlock(mutex);
+    return held;
+}
+
+// SET lock_escalation_threshold: row locks per table before escalating; -1 if out of range
+int lock_set_escalation_threshold(int threshold) {
+    if (threshold < 1) return -1;
+    __atomic_store_n(&escalation_threshold, threshold, __ATOMIC_RELAXED);
+    printf("LOCK: Escalation threshold set to %d row locks\n", threshold);
+    return 0;
+}
+
+// Release every lock txn_id holds and wake the transactions waiting for them
+void lock_release_all(uint32_t txn_id) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    
+    LockOwner* owner = lock_owner(txn_id, false);
+    if (!owner) return;
+    pthread_mutex_lock(&owner->mutex);
+    LockRequest** link = &owner->locks;
+    while (*link) {
+        LockRequest* request = *link;
+        if (request->txn_id != txn_id) {     // Only the unlisted list is shared
+            link = &request->txn_next;
+            continue;
+        }
+        *link = request->txn_next;
+        int bucket = lock_bucket(request->head->tag);
+        pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+        pthread_mutex_lock(mutex);
+        remove_request(request, bucket);
+        pthread_mutex_unlock(mutex);
+    }
+    pthread_mutex_unlock(&owner->mutex);
+}
+
+/*
+ * Release one lock txn_id holds on tag before the transaction ends, for a
+ * resource it turned out not to need (e.g. a row slot an insert gave up).
+ * A released row lock no longer counts toward escalation. A row covered by
+ * the table lock has no lock of its own: nothing to do.
+ */
+void lock_release(uint32_t txn_id, LockTag tag) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    
+    LockOwner* owner = lock_owner(txn_id, false);
+    if (!owner) return;
+    bool released = false;
+    pthread_mutex_lock(&owner->mutex);
+    for (LockRequest** link = &owner->locks; *link; link = &(*link)->txn_next) {
+        LockRequest* request = *link;
+        if (request->txn_id != txn_id || !tag_equal(request->head->tag, tag)) continue;
+        *link = request->txn_next;
+        int bucket = lock_bucket(tag);
+        pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+        pthread_mutex_lock(mutex);
+        remove_request(request, bucket);
+        pthread_mutex_unlock(mutex);
+        released = true;
+        break;
+    }
+    pthread_mutex_unlock(&owner->mutex);
+    
+    if (released && tag.page_id >= 0) {
+        LockTag parent = table_tag(tag.table_id);
+        int bucket = lock_bucket(parent);
+        pthread_mutex_t* mutex = &partition_mutex[bucket % LOCK_PARTITIONS];
+        pthread_mutex_lock(mutex);
+        LockHead* head = find_head(parent, bucket, false);
+        LockRequest* table_lock = head ? held_request(head, txn_id) : NULL;
+        if (table_lock && table_lock->row_locks > 0) table_lock->row_locks--;
+        pthread_mutex_unlock(mutex);
+    }
+}
+
+// Number of locks txn_id holds
+int lock_count(uint32_t txn_id) {
+    pthread_once(&lock_manager_once, init_lock_manager);
+    
+    LockOwner* owner = lock_owner(txn_id, false);
+    if (!owner) return 0;
+    int count = 0;
+    pthread_mutex_lock(&owner->mutex);
+    for (LockRequest* request = owner->locks; request; request = request->txn_next) {
+        if (request->txn_id == txn_id) count++;
+    }
+    pthread_mutex_unlock(&owner->mutex);
+    return count;
+}
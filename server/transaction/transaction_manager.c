@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 #include "../../common/types.h"
 #include "../../common/wal_types.h"
 
@@ -15,12 +16,26 @@
  * - Isolation: Concurrent transactions don't interfere with each other
  * - Durability: Committed changes survive system failures
  * 
- * ISOLATION LEVELS SUPPORTED:
+ * ISOLATION LEVELS SUPPORTED (MVCC, SET transaction_isolation):
  * 1. READ COMMITTED (default):
- *    - Prevents dirty reads (reading uncommitted data)
- *    - Allows non-repeatable reads and phantom reads
- *    - Uses shared locks for reads, exclusive locks for writes
- *    - Locks released immediately after operation
+ *    - Each statement reads from a snapshot taken when it first reads
+ *    - Prevents dirty reads; allows non-repeatable reads and phantoms
+ * 2. REPEATABLE READ:
+ *    - One snapshot for the whole transaction
+ *    - Updating or deleting a row another transaction changed after the
+ *      snapshot fails with SERIALIZATION_FAILURE (first updater wins)
+ * 
+ * MULTI-VERSION CONCURRENCY CONTROL:
+ * - Data rows carry the ids of the transactions that created (xmin) and
+ *   deleted or replaced (xmax) them; see common/row_format.h
+ * - A snapshot lists the transactions running when it was taken; a row
+ *   version is visible if its xmin committed before the snapshot (or is
+ *   the reader itself) and its xmax did not
+ * - The commit log records each transaction's outcome this run, so
+ *   aborted changes stay invisible. Transactions from before startup all
+ *   count as committed: recovery has already rolled the losers back
+ * - Readers take only an IS table lock and never wait for writers;
+ *   writers lock rows, so they wait only for each other
  * 
  * LOCKING PROTOCOL:
  * - Two-Phase Locking (2PL) for serializability
@@ -28,54 +43,250 @@
  * - Shrinking phase: Release all locks at commit/abort
  * - Read locks: Multiple transactions can hold simultaneously
  * - Write locks: Exclusive access, blocks all other transactions
+ * - Locks live in the lock manager (lock_manager.c). DML takes IX on the
+ *   table and X on each row it writes, so writers of disjoint rows run
+ *   concurrently; reads take IS and DDL X table locks
+ * - SELECT ... FOR UPDATE takes the same row locks as UPDATE without
+ *   changing the rows. NOWAIT fails at the first row locked by someone
+ *   else, SKIP LOCKED leaves such rows out; with LIMIT, queue consumers
+ *   each claim different rows instead of queueing behind each other
+ * - SET lock_timeout bounds every single lock wait of the session's
+ *   transactions: past it the statement fails, the transaction does not
+ * 
+ * TRANSACTION BLOCKS:
+ * - Outside BEGIN ... COMMIT every statement is its own transaction and
+ *   commits (one WAL flush) when it succeeds
+ * - Inside a block DML defers to COMMIT, so a batch of writes shares one
+ *   commit record and one flush; ROLLBACK aborts the whole block
+ * - DDL cannot be rolled back: inside a block it commits the block with it
+ * - A failing statement in a block rolls back only its own changes
+ *   (statement-level atomicity); SAVEPOINT / ROLLBACK TO SAVEPOINT do the
+ *   same for a group of statements. Deadlock victims and serialization
+ *   failures still abort the whole transaction
  * 
  * COMMIT PROTOCOL:
  * 1. Write all changes to WAL (Write-Ahead Logging)
- * 2. Force WAL to disk (durability guarantee)
+ * 2. Force WAL to disk (durability guarantee), unless the session runs
+ *    with synchronous_commit = off: then the WAL writer flushes the
+ *    commit record within wal_writer_delay
  * 3. Mark transaction as committed
  * 4. Release all locks
  * 5. Apply changes to data pages (can be deferred)
  * 
  * ROLLBACK PROTOCOL:
- * 1. Undo all changes using WAL records (reverse order)
- * 2. Mark transaction as aborted
+ * 1. Undo all changes using WAL records (reverse order), following the
+ *    transaction's prev_lsn chain and logging a CLR for each undone change
+ * 2. Log an ABORT record and mark the transaction aborted
  * 3. Release all locks
  * 4. Clean up transaction state
  * 
+ * OPTIMISTIC CONCURRENCY CONTROL (SET concurrency_control = occ):
+ * - For short transactions that rarely conflict: writers take no row
+ *   locks and never wait for each other. Table locks are unchanged
+ * - Write set: the versions the transaction creates or stamps with its
+ *   xmax. A running transaction's xmax already marks a version as taken,
+ *   so a writer that finds a version another transaction is still writing
+ *   fails at once (write-write conflict, first writer wins)
+ * - Read set: every row version the transaction reads. At commit each
+ *   must still be current: not replaced or deleted by anyone else,
+ *   committed or running. Otherwise the transaction aborts with a
+ *   serialization failure. Its own writes stay marked until it ends, so
+ *   two transactions that read what the other wrote cannot both pass.
+ *   A transaction that wrote nothing and read one snapshot skips validation
+ * - Predicates are not validated: a row inserted into a range the
+ *   transaction scanned does not fail it (phantoms)
+ * - A row another transaction has locked (SELECT ... FOR UPDATE) counts
+ *   as taken too: writing it is a write-write conflict
+ * - A transaction takes one lock, on its own id, at its first write.
+ *   Locking writers that reach a version an OCC transaction is writing
+ *   wait on that lock, so deadlocks between the two modes are detected
+ * - Outside a block, a statement that fails with a conflict is retried
+ *   (see server.c). SHOW CONCURRENCY reports commits, conflicts and
+ *   retries per mode, to tell whether OCC pays off for a workload
+ * 
+ * TRANSACTION TABLE:
+ * - Ids come from an atomic counter; BEGIN claims a free slot with a
+ *   compare-and-swap and takes no global lock
+ * - The table grows by chunks of TXN_SLOTS_PER_CHUNK slots that are
+ *   published atomically and never move or shrink, so a slot pointer
+ *   stays valid and no live transaction is ever overwritten
+ * - A slot holds its transaction's id while it runs (0 = free). A snapshot
+ *   reads the id counter, then the slots: a slot claimed but not yet given
+ *   its id is waited for, so no transaction that started before the
+ *   snapshot can be missed
+ * - Each thread remembers the transaction it began, so per-transaction
+ *   calls by the owner find their slot without a search; finished
+ *   transactions are answered from the commit log
+ * 
  * DEADLOCK HANDLING:
- * - Currently: Simple timeout-based detection
- * - Future: Wait-for graph analysis and victim selection
+ * - A lock wait longer than DEADLOCK_TIMEOUT_MS builds the wait-for graph
+ *   from the lock manager's queues and looks for a cycle
+ * - The transaction on the cycle holding the fewest locks (youngest on a
+ *   tie) is the victim: its lock request fails with LOCK_DEADLOCK and the
+ *   statement reports "Deadlock detected" and releases its locks
+ */
+
+#define TXN_SLOT_RESERVED UINT32_MAX  // Claimed by BEGIN, id not assigned yet
+#define CLOG_TXNS_PER_PAGE 16384    // Commit log: one status byte per transaction
+#define CLOG_PAGES 4096
+#define TXN_LOCK_TABLE (-1)         // Lock tag table_id of transaction locks (slot = txn id)
+#define OCC_READ_SET_INITIAL 64
+
+static Transaction* txn_chunks[TXN_TABLE_CHUNKS];
+static int txn_chunk_count = 0;
+static uint32_t txn_slot_hint = 0;  // Where the next free-slot search starts
+static __thread Transaction* current_txn = NULL;   // Last transaction this thread began
+static uint32_t next_txn_id = 2;    // 1 is the system transaction (startup, catalog)
+static uint32_t clog_base = 2;      // First id of this run; older ones have finished
+static uint8_t* clog[CLOG_PAGES];
+static ConcurrencyStats cc_stats[CC_MODE_COUNT];
+
+extern int lock_acquire(uint32_t txn_id, LockTag tag, LockMode mode);
+extern int lock_try_acquire(uint32_t txn_id, LockTag tag, LockMode mode);
+extern bool lock_held_by_other(uint32_t txn_id, LockTag tag, LockMode mode);
+extern void lock_release(uint32_t txn_id, LockTag tag);
+extern void lock_release_all(uint32_t txn_id);
+int abort_transaction(uint32_t txn_id);
+
+/*
+ * Commit log entry for txn_id, or NULL if it is older than this run,
+ * beyond the log, or its page does not exist yet. BEGIN creates the page
+ * (create = true) before the id is used; racing creators keep one page.
  */
+static uint8_t* clog_entry(uint32_t txn_id, bool create) {
+    if (txn_id < clog_base) return NULL;
+    uint32_t offset = txn_id - clog_base;
+    if (offset / CLOG_TXNS_PER_PAGE >= CLOG_PAGES) return NULL;
+    uint8_t** slot = &clog[offset / CLOG_TXNS_PER_PAGE];
+    uint8_t* page = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (!page && create) {
+        uint8_t* fresh = calloc(CLOG_TXNS_PER_PAGE, 1);   // zero = TXN_ACTIVE
+        if (!fresh) {
+            printf("Transaction %u: commit log page allocation failed\n", txn_id);
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(slot, &page, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            page = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return page ? &page[offset % CLOG_TXNS_PER_PAGE] : NULL;
+}
+
+static void clog_set(uint32_t txn_id, TransactionState state) {
+    uint8_t* entry = clog_entry(txn_id, false);
+    if (entry) __atomic_store_n(entry, (uint8_t)state, __ATOMIC_RELEASE);
+}
+
+// Outcome of any transaction, including ones whose slot has been reused
+TransactionState transaction_status(uint32_t txn_id) {
+    if (txn_id < clog_base) return TXN_COMMITTED;   // Before startup; losers were undone
+    uint8_t* entry = clog_entry(txn_id, false);
+    if (!entry) {
+        // Past the end of the commit log nothing is tracked; otherwise the
+        // transaction has not finished BEGIN yet
+        bool tracked = (txn_id - clog_base) / CLOG_TXNS_PER_PAGE < CLOG_PAGES;
+        return !tracked && txn_id < __atomic_load_n(&next_txn_id, __ATOMIC_ACQUIRE) ? TXN_COMMITTED : TXN_ACTIVE;
+    }
+    return (TransactionState)__atomic_load_n(entry, __ATOMIC_ACQUIRE);
+}
 
-#define MAX_TRANSACTIONS 1000
+/*
+ * Start numbering after every transaction recovery found in the log, so
+ * row versions from before the restart are never mistaken for new work.
+ * Called once at startup, before any session begins a transaction.
+ */
+void transaction_set_next_id(uint32_t txn_id) {
+    uint32_t next = __atomic_load_n(&next_txn_id, __ATOMIC_ACQUIRE);
+    if (txn_id > next) next = txn_id;
+    __atomic_store_n(&clog_base, next, __ATOMIC_RELEASE);
+    __atomic_store_n(&next_txn_id, next, __ATOMIC_RELEASE);
+    printf("Transaction ids start at %u\n", next);
+}
 
-static Transaction transactions[MAX_TRANSACTIONS];
-static uint32_t next_txn_id = 1;
-static pthread_mutex_t txn_manager_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t transaction_next_id() {
+    return __atomic_load_n(&next_txn_id, __ATOMIC_ACQUIRE);
+}
 
-// Read-write lock table for read committed isolation
-typedef struct {
-    int resource_id;
-    pthread_rwlock_t rwlock;
-    int readers;
-    int writers;
-} ResourceLock;
+// Add a chunk of free slots (a racing thread may have added it already)
+static void grow_transaction_table(int chunks) {
+    Transaction* chunk = calloc(TXN_SLOTS_PER_CHUNK, sizeof(Transaction));
+    if (!chunk) {
+        printf("Transaction table: chunk allocation failed\n");
+        sched_yield();
+        return;
+    }
+    for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+        chunk[i].slot = chunks * TXN_SLOTS_PER_CHUNK + i;
+        pthread_mutex_init(&chunk[i].txn_mutex, NULL);
+    }
+    Transaction* expected = NULL;
+    if (!__atomic_compare_exchange_n(&txn_chunks[chunks], &expected, chunk, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+            pthread_mutex_destroy(&chunk[i].txn_mutex);
+        }
+        free(chunk);
+    }
+    // The chunk is in the directory before the count covers it
+    __atomic_compare_exchange_n(&txn_chunk_count, &chunks, chunks + 1, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
 
-static ResourceLock resource_locks[10000];
-static pthread_mutex_t lock_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Claim a free slot (id 0 -> TXN_SLOT_RESERVED), searching from a rotating
+ * hint so concurrent BEGINs spread out. With every slot taken the table
+ * grows; once it is at its limit, BEGIN waits for a transaction to end.
+ */
+static Transaction* claim_slot() {
+    for (;;) {
+        int chunks = __atomic_load_n(&txn_chunk_count, __ATOMIC_SEQ_CST);
+        uint32_t slots = (uint32_t)chunks * TXN_SLOTS_PER_CHUNK;
+        uint32_t start = slots ? __atomic_fetch_add(&txn_slot_hint, 1, __ATOMIC_RELAXED) % slots : 0;
+        for (uint32_t n = 0; n < slots; n++) {
+            uint32_t s = (start + n) % slots;
+            Transaction* txn = &__atomic_load_n(&txn_chunks[s / TXN_SLOTS_PER_CHUNK], __ATOMIC_ACQUIRE)
+                                   [s % TXN_SLOTS_PER_CHUNK];
+            uint32_t expected = 0;
+            if (__atomic_load_n(&txn->txn_id, __ATOMIC_RELAXED) == 0 &&
+                __atomic_compare_exchange_n(&txn->txn_id, &expected, TXN_SLOT_RESERVED, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                return txn;
+            }
+        }
+        if (chunks < TXN_TABLE_CHUNKS) {
+            grow_transaction_table(chunks);
+        } else {
+            sched_yield();
+        }
+    }
+}
 
+/*
+ * BEGIN: claim a slot, then take the next id and publish it in the slot.
+ * Claiming first (see TRANSACTION TABLE above) is what lets a concurrent
+ * snapshot wait for an id it would otherwise miss.
+ */
 uint32_t begin_transaction(IsolationLevel isolation) {
-    pthread_mutex_lock(&txn_manager_mutex);
+    Transaction* txn = claim_slot();
+    txn->state = TXN_ACTIVE;
+    txn->isolation = isolation;
+    txn->async_commit = false;
+    txn->has_snapshot = false;
+    txn->explicit_block = false;
+    txn->lock_timeout_ms = 0;
+    txn->snapshot_count = 0;
+    txn->concurrency = CC_LOCKING;
+    txn->read_set = NULL;
+    txn->read_count = 0;
+    txn->read_capacity = 0;
+    txn->write_count = 0;
     
-    uint32_t txn_id = next_txn_id++;
-    int idx = txn_id % MAX_TRANSACTIONS;
-    
-    transactions[idx].txn_id = txn_id;
-    transactions[idx].state = TXN_ACTIVE;
-    transactions[idx].isolation = isolation;
-    pthread_mutex_init(&transactions[idx].txn_mutex, NULL);
-    
-    pthread_mutex_unlock(&txn_manager_mutex);
+    uint32_t txn_id = __atomic_fetch_add(&next_txn_id, 1, __ATOMIC_SEQ_CST);
+    clog_entry(txn_id, true);
+    __atomic_store_n(&txn->txn_id, txn_id, __ATOMIC_SEQ_CST);
+    current_txn = txn;
     
     // Skip WAL logging for debugging
     // extern uint64_t wal_begin_transaction(uint32_t txn_id);
@@ -85,73 +296,287 @@ uint32_t begin_transaction(IsolationLevel isolation) {
     return txn_id;
 }
 
-int acquire_read_lock(uint32_t txn_id, int resource_id) {
-    pthread_mutex_lock(&lock_table_mutex);
-    
-    int hash_key = resource_id % 10000;
-    ResourceLock* lock = &resource_locks[hash_key];
+// Slot of a running transaction, or NULL once it has finished
+static Transaction* find_transaction(uint32_t txn_id) {
+    Transaction* txn = current_txn;
+    if (txn && __atomic_load_n(&txn->txn_id, __ATOMIC_ACQUIRE) == txn_id) return txn;
     
-    if (lock->resource_id == 0) {
-        lock->resource_id = resource_id;
-        pthread_rwlock_init(&lock->rwlock, NULL);
-    }
-    
-    pthread_mutex_unlock(&lock_table_mutex);
-    
-    int result = pthread_rwlock_rdlock(&lock->rwlock);
-    if (result == 0) {
-        lock->readers++;
+    int chunks = __atomic_load_n(&txn_chunk_count, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < chunks; c++) {
+        Transaction* chunk = __atomic_load_n(&txn_chunks[c], __ATOMIC_ACQUIRE);
+        for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+            if (__atomic_load_n(&chunk[i].txn_id, __ATOMIC_ACQUIRE) == txn_id) return &chunk[i];
+        }
     }
-    
-    return result;
+    return NULL;
 }
 
-int acquire_write_lock(uint32_t txn_id, int resource_id) {
-    pthread_mutex_lock(&lock_table_mutex);
-    
-    int hash_key = resource_id % 10000;
-    ResourceLock* lock = &resource_locks[hash_key];
+/*
+ * Table slot of txn_id until it ends (lock_release_all() runs before the
+ * slot is freed), or -1 for ids outside the table (the system transaction).
+ * The lock manager keys each transaction's lock list by it.
+ */
+int transaction_slot(uint32_t txn_id) {
+    Transaction* txn = find_transaction(txn_id);
+    return txn ? txn->slot : -1;
+}
+
+// Give the slot back once the transaction has ended
+static void release_slot(Transaction* txn) {
+    __atomic_store_n(&txn->txn_id, 0, __ATOMIC_RELEASE);
+}
+
+static Transaction* active_transaction(uint32_t txn_id) {
+    Transaction* txn = find_transaction(txn_id);
+    return txn && txn->state == TXN_ACTIVE ? txn : NULL;
+}
+
+static void drop_snapshot(Transaction* txn) {
+    if (!txn->has_snapshot) return;
+    free(txn->snapshot.active);
+    txn->snapshot.active = NULL;
+    txn->has_snapshot = false;
+}
+
+static void drop_read_set(Transaction* txn) {
+    free(txn->read_set);
+    txn->read_set = NULL;
+    txn->read_count = 0;
+    txn->read_capacity = 0;
+}
+
+/*
+ * The snapshot txn_id reads with, taken on first use: by the transaction
+ * for REPEATABLE READ, by the statement for READ COMMITTED. NULL for ids
+ * that are not an active transaction (e.g. the system transaction), which
+ * read the latest committed state.
+ */
+const Snapshot* transaction_snapshot(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    if (!txn) return NULL;
+    if (txn->has_snapshot) return &txn->snapshot;
     
-    if (lock->resource_id == 0) {
-        lock->resource_id = resource_id;
-        pthread_rwlock_init(&lock->rwlock, NULL);
+    // The id counter first, then the chunk count: any transaction with a
+    // smaller id has claimed its slot in a chunk the count covers
+    Snapshot* snapshot = &txn->snapshot;
+    snapshot->xmax = __atomic_load_n(&next_txn_id, __ATOMIC_SEQ_CST);
+    snapshot->xmin = snapshot->xmax;
+    snapshot->active_count = 0;
+    int chunks = __atomic_load_n(&txn_chunk_count, __ATOMIC_SEQ_CST);
+    uint32_t* active = malloc((size_t)chunks * TXN_SLOTS_PER_CHUNK * sizeof(uint32_t));
+    if (!active) return NULL;
+    for (int c = 0; c < chunks; c++) {
+        Transaction* chunk = __atomic_load_n(&txn_chunks[c], __ATOMIC_ACQUIRE);
+        for (int i = 0; i < TXN_SLOTS_PER_CHUNK; i++) {
+            uint32_t xid = __atomic_load_n(&chunk[i].txn_id, __ATOMIC_SEQ_CST);
+            while (xid == TXN_SLOT_RESERVED) {
+                sched_yield();
+                xid = __atomic_load_n(&chunk[i].txn_id, __ATOMIC_SEQ_CST);
+            }
+            if (xid == 0 || xid == txn_id || xid >= snapshot->xmax) continue;
+            active[snapshot->active_count++] = xid;
+            if (xid < snapshot->xmin) snapshot->xmin = xid;
+        }
     }
-    
-    pthread_mutex_unlock(&lock_table_mutex);
-    
-    int result = pthread_rwlock_wrlock(&lock->rwlock);
-    if (result == 0) {
-        lock->writers++;
+    snapshot->active = active;
+    txn->has_snapshot = true;
+    txn->snapshot_count++;
+    return snapshot;
+}
+
+bool transaction_repeatable_read(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    return txn && txn->isolation == ISOLATION_REPEATABLE_READ;
+}
+
+// A new statement of txn_id begins: READ COMMITTED takes a fresh snapshot
+void transaction_new_statement(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    if (txn && txn->isolation == ISOLATION_READ_COMMITTED) drop_snapshot(txn);
+}
+
+/*
+ * Are the changes of transaction xid visible to reader txn_id through
+ * snapshot? Without a snapshot, committed changes are.
+ */
+bool transaction_visible(const Snapshot* snapshot, uint32_t txn_id, uint32_t xid) {
+    if (xid == txn_id) return true;
+    if (snapshot) {
+        if (xid >= snapshot->xmax) return false;
+        if (xid >= snapshot->xmin) {
+            for (int i = 0; i < snapshot->active_count; i++) {
+                if (snapshot->active[i] == xid) return false;
+            }
+        }
     }
-    
-    return result;
+    return transaction_status(xid) == TXN_COMMITTED;
 }
 
+// Table-level lock in any mode; intention modes (IS/IX) precede row locks
+int acquire_table_lock(uint32_t txn_id, int table_id, LockMode mode) {
+    LockTag tag = { table_id, -1, -1 };
+    return lock_acquire(txn_id, tag, mode);
+}
+
+// Table-level shared lock for reads (resource 1 = system catalog)
+int acquire_read_lock(uint32_t txn_id, int resource_id) {
+    return acquire_table_lock(txn_id, resource_id, LOCK_S);
+}
+
+// Table-level exclusive lock for DDL
+int acquire_write_lock(uint32_t txn_id, int resource_id) {
+    return acquire_table_lock(txn_id, resource_id, LOCK_X);
+}
+
+/*
+ * Exclusive lock on one row, under an IX lock on its table. Without wait,
+ * returns 1 instead of blocking, so callers holding a page latch can drop
+ * it first. May escalate to a table lock (see lock_manager.c). Returns
+ * LOCK_DEADLOCK if waiting would deadlock and this transaction is the victim,
+ * LOCK_TIMEOUT if it waited longer than its lock_timeout.
+ */
+int acquire_row_lock(uint32_t txn_id, int table_id, RecordId rid, bool wait) {
+    LockTag tag = { table_id, rid.page_id, rid.slot };
+    return wait ? lock_acquire(txn_id, tag, LOCK_X) : lock_try_acquire(txn_id, tag, LOCK_X);
+}
+
+// Give back a row lock the transaction did not use (see insert_row())
+void release_row_lock(uint32_t txn_id, int table_id, RecordId rid) {
+    LockTag tag = { table_id, rid.page_id, rid.slot };
+    lock_release(txn_id, tag);
+}
+
+// Does another transaction hold a lock on the row (FOR UPDATE or a writer)? Never waits
+bool row_locked_by_other(uint32_t txn_id, int table_id, RecordId rid) {
+    LockTag tag = { table_id, rid.page_id, rid.slot };
+    return lock_held_by_other(txn_id, tag, LOCK_X);
+}
+
+// Release every lock the transaction holds (O(locks held), see lock_manager.c)
 void release_locks(uint32_t txn_id) {
-    pthread_mutex_lock(&lock_table_mutex);
-    
-    for (int i = 0; i < 10000; i++) {
-        if (resource_locks[i].resource_id != 0) {
-            pthread_rwlock_unlock(&resource_locks[i].rwlock);
-            resource_locks[i].readers = 0;
-            resource_locks[i].writers = 0;
+    lock_release_all(txn_id);
+}
+
+// Lock on a transaction's own id: held by OCC writers, waited on by locking writers
+static LockTag transaction_lock_tag(uint32_t txn_id) {
+    LockTag tag = { TXN_LOCK_TABLE, -1, (int)txn_id };
+    return tag;
+}
+
+// Concurrency control for the transaction, set right after BEGIN
+void set_concurrency_control(uint32_t txn_id, ConcurrencyControl mode) {
+    Transaction* txn = active_transaction(txn_id);
+    if (txn) txn->concurrency = mode;
+}
+
+bool transaction_optimistic(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    return txn && txn->concurrency == CC_OPTIMISTIC;
+}
+
+/*
+ * OCC: add a row version txn_id read to its read set. If the set cannot
+ * grow, it is dropped and validation fails (read_capacity = -1).
+ */
+void transaction_record_read(uint32_t txn_id, int page_id, int slot, int record_size, uint32_t xmin) {
+    Transaction* txn = active_transaction(txn_id);
+    if (!txn || txn->concurrency != CC_OPTIMISTIC || txn->read_capacity < 0) return;
+    if (txn->read_count == txn->read_capacity) {
+        int capacity = txn->read_capacity ? txn->read_capacity * 2 : OCC_READ_SET_INITIAL;
+        OccRead* grown = realloc(txn->read_set, (size_t)capacity * sizeof(OccRead));
+        if (!grown) {
+            printf("OCC: Transaction %u read set allocation failed\n", txn_id);
+            drop_read_set(txn);
+            txn->read_capacity = -1;
+            return;
         }
+        txn->read_set = grown;
+        txn->read_capacity = capacity;
     }
-    
-    pthread_mutex_unlock(&lock_table_mutex);
+    OccRead* read = &txn->read_set[txn->read_count++];
+    read->page_id = page_id;
+    read->slot = slot;
+    read->record_size = record_size;
+    read->xmin = xmin;
+}
+
+/*
+ * OCC: txn_id creates or stamps a row version. The first write takes the
+ * lock on its own id, which locking writers wait on (it is never
+ * contended then, so this does not wait).
+ */
+int transaction_record_write(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    if (!txn || txn->concurrency != CC_OPTIMISTIC) return 0;
+    if (txn->write_count++ > 0) return 0;
+    return lock_acquire(txn_id, transaction_lock_tag(txn_id), LOCK_X);
+}
+
+/*
+ * Wait until OCC transaction xid, which is writing a row txn_id wants,
+ * has ended. Returns 0, or LOCK_DEADLOCK if txn_id is a deadlock victim.
+ */
+int transaction_wait(uint32_t txn_id, uint32_t xid) {
+    printf("LOCK: TXN %u waits for transaction %u\n", txn_id, xid);
+    return lock_acquire(txn_id, transaction_lock_tag(xid), LOCK_S);
+}
+
+// OCC validation (see OPTIMISTIC CONCURRENCY CONTROL above)
+static bool validate_read_set(Transaction* txn, uint32_t txn_id) {
+    extern bool row_version_current(const OccRead* read, uint32_t txn_id);
+    if (txn->read_capacity < 0) return false;
+    if (txn->write_count == 0 && txn->snapshot_count <= 1) return true;
+    for (int i = 0; i < txn->read_count; i++) {
+        if (!row_version_current(&txn->read_set[i], txn_id)) {
+            printf("OCC: Transaction %u failed validation: page %d slot %d changed\n", txn_id,
+                   txn->read_set[i].page_id, txn->read_set[i].slot);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Abort txn_id after a deadlock or serialization failure and count the
+ * conflict against its concurrency control mode.
+ */
+int abort_conflicted_transaction(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    if (!txn) return -1;
+    __atomic_fetch_add(&cc_stats[txn->concurrency].conflicts, 1, __ATOMIC_RELAXED);
+    return abort_transaction(txn_id);
+}
+
+// An OCC statement runs again after a conflict
+void transaction_count_retry() {
+    __atomic_fetch_add(&cc_stats[CC_OPTIMISTIC].retries, 1, __ATOMIC_RELAXED);
+}
+
+void transaction_concurrency_stats(ConcurrencyControl mode, ConcurrencyStats* stats) {
+    stats->commits = __atomic_load_n(&cc_stats[mode].commits, __ATOMIC_RELAXED);
+    stats->conflicts = __atomic_load_n(&cc_stats[mode].conflicts, __ATOMIC_RELAXED);
+    stats->validation_failures = __atomic_load_n(&cc_stats[mode].validation_failures, __ATOMIC_RELAXED);
+    stats->retries = __atomic_load_n(&cc_stats[mode].retries, __ATOMIC_RELAXED);
 }
 
 /**
  * Commit Transaction - Two-Phase Commit Protocol
  * 
  * COMMIT PHASES:
+ * 0. VALIDATE (OCC only): the versions read must still be current, or the
+ *    transaction aborts and SERIALIZATION_FAILURE is returned
  * 1. PREPARE: Write all changes to WAL, ensure durability
  * 2. COMMIT: Mark transaction committed, release locks
  * 
  * DURABILITY GUARANTEE:
  * - All changes written to WAL before commit
  * - WAL forced to disk synchronously
- * - Commit record written last (atomic commit point)
+ * - Commit record written last (atomic commit point); a transaction that
+ *   logged nothing (read-only) needs no commit record
+ * 
+ * VISIBILITY:
+ * - The commit log says committed before the locks go, so a writer that
+ *   waited for one of our rows sees our change as committed
  * 
  * LOCK RELEASE:
  * - All locks released after commit point
@@ -159,52 +584,152 @@ void release_locks(uint32_t txn_id) {
  * - Maintains serializability
  */
 int commit_transaction(uint32_t txn_id) {
-    int idx = txn_id % MAX_TRANSACTIONS;
+    Transaction* txn = find_transaction(txn_id);
+    if (!txn) return -1;
     
-    pthread_mutex_lock(&transactions[idx].txn_mutex);
+    pthread_mutex_lock(&txn->txn_mutex);
     
-    if (transactions[idx].state != TXN_ACTIVE) {
-        pthread_mutex_unlock(&transactions[idx].txn_mutex);
+    if (__atomic_load_n(&txn->txn_id, __ATOMIC_ACQUIRE) != txn_id || txn->state != TXN_ACTIVE) {
+        pthread_mutex_unlock(&txn->txn_mutex);
         return -1;
     }
     
+    if (txn->concurrency == CC_OPTIMISTIC && !validate_read_set(txn, txn_id)) {
+        pthread_mutex_unlock(&txn->txn_mutex);
+        __atomic_fetch_add(&cc_stats[CC_OPTIMISTIC].validation_failures, 1, __ATOMIC_RELAXED);
+        abort_conflicted_transaction(txn_id);
+        return SERIALIZATION_FAILURE;
+    }
+    
     // Phase 1: Write WAL commit record and flush to disk
+    extern bool wal_transaction_logged(uint32_t txn_id);
     extern uint64_t wal_commit_transaction(uint32_t txn_id);
-    wal_commit_transaction(txn_id);
-    
-    // Force WAL to disk synchronously (durability)
-    extern void flush_wal();
-    flush_wal();
+    bool logged = wal_transaction_logged(txn_id);
+    if (logged) {
+        uint64_t commit_lsn = wal_commit_transaction(txn_id);
+        
+        // Wait for the commit record to be durable (shares fsyncs with concurrent committers)
+        extern int wal_flush_to(uint64_t lsn);
+        extern void wal_commit_async(uint64_t lsn);
+        if (txn->async_commit) {
+            wal_commit_async(commit_lsn);
+        } else {
+            wal_flush_to(commit_lsn);
+        }
+    }
     
-    // Phase 2: Mark committed and release locks
-    transactions[idx].state = TXN_COMMITTED;
+    // Phase 2: Mark committed and release locks. The commit log says so
+    // before the slot is freed, so snapshots never miss the commit
+    clog_set(txn_id, TXN_COMMITTED);
+    txn->state = TXN_COMMITTED;
+    drop_snapshot(txn);
+    drop_read_set(txn);
     release_locks(txn_id);
+    if (logged) __atomic_fetch_add(&cc_stats[txn->concurrency].commits, 1, __ATOMIC_RELAXED);
     
-    pthread_mutex_unlock(&transactions[idx].txn_mutex);
+    pthread_mutex_unlock(&txn->txn_mutex);
+    release_slot(txn);
     
     printf("Transaction %u committed\n", txn_id);
     return 0;
 }
 
 int abort_transaction(uint32_t txn_id) {
-    int idx = txn_id % MAX_TRANSACTIONS;
+    Transaction* txn = find_transaction(txn_id);
+    if (!txn) return -1;
     
-    pthread_mutex_lock(&transactions[idx].txn_mutex);
+    pthread_mutex_lock(&txn->txn_mutex);
     
-    // Skip WAL logging for debugging
-    // extern uint64_t wal_abort_transaction(uint32_t txn_id);
-    // wal_abort_transaction(txn_id);
+    if (__atomic_load_n(&txn->txn_id, __ATOMIC_ACQUIRE) != txn_id || txn->state != TXN_ACTIVE) {
+        pthread_mutex_unlock(&txn->txn_mutex);
+        return -1;
+    }
     
-    transactions[idx].state = TXN_ABORTED;
+    // Roll the changes back through the transaction's own log records
+    // (each undo logged as a CLR) while its row locks are still held, then
+    // retire it with an ABORT record. Nothing waits for the flush: a crash
+    // before it reaches disk just finishes the rollback during recovery
+    extern bool wal_transaction_logged(uint32_t txn_id);
+    if (wal_transaction_logged(txn_id)) {
+        extern int rollback_transaction(uint32_t txn_id, uint64_t stop_lsn);
+        extern uint64_t wal_abort_transaction(uint32_t txn_id);
+        rollback_transaction(txn_id, 0);
+        wal_abort_transaction(txn_id);
+    }
+    
+    clog_set(txn_id, TXN_ABORTED);
+    txn->state = TXN_ABORTED;
+    drop_snapshot(txn);
+    drop_read_set(txn);
     release_locks(txn_id);
     
-    pthread_mutex_unlock(&transactions[idx].txn_mutex);
+    pthread_mutex_unlock(&txn->txn_mutex);
+    release_slot(txn);
     
     printf("Transaction %u aborted\n", txn_id);
     return 0;
 }
 
+// Commit durability for the transaction's next commits (synchronous_commit)
+void set_synchronous_commit(uint32_t txn_id, bool on) {
+    Transaction* txn = active_transaction(txn_id);
+    if (txn) txn->async_commit = !on;
+}
+
+bool transaction_synchronous_commit(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    return !txn || !txn->async_commit;
+}
+
+// Longest wait for a single lock in ms (SET lock_timeout; 0 = no limit)
+void set_lock_timeout(uint32_t txn_id, int timeout_ms) {
+    Transaction* txn = active_transaction(txn_id);
+    if (txn) txn->lock_timeout_ms = timeout_ms;
+}
+
+int transaction_lock_timeout(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    return txn ? txn->lock_timeout_ms : 0;
+}
+
+// BEGIN: the transaction spans statements and ends at COMMIT or ROLLBACK
+void transaction_begin_block(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    if (txn) txn->explicit_block = true;
+}
+
+bool transaction_in_block(uint32_t txn_id) {
+    Transaction* txn = active_transaction(txn_id);
+    return txn && txn->explicit_block;
+}
+
+/*
+ * Savepoints are positions in the transaction's prev_lsn chain: rolling
+ * back to one undoes (with CLRs) every change logged after it and leaves
+ * the transaction running. Locks taken since are kept until it ends.
+ */
+uint64_t transaction_savepoint(uint32_t txn_id) {
+    extern uint64_t wal_transaction_last_lsn(uint32_t txn_id);
+    return wal_transaction_last_lsn(txn_id);
+}
+
+int transaction_rollback_to(uint32_t txn_id, uint64_t savepoint) {
+    extern int rollback_transaction(uint32_t txn_id, uint64_t stop_lsn);
+    Transaction* txn = find_transaction(txn_id);
+    if (!txn) return -1;
+    
+    pthread_mutex_lock(&txn->txn_mutex);
+    if (__atomic_load_n(&txn->txn_id, __ATOMIC_ACQUIRE) != txn_id || txn->state != TXN_ACTIVE) {
+        pthread_mutex_unlock(&txn->txn_mutex);
+        return -1;
+    }
+    int undone = rollback_transaction(txn_id, savepoint);
+    pthread_mutex_unlock(&txn->txn_mutex);
+    return undone;
+}
+
+// Running transactions report their slot's state, finished ones the commit log's
 TransactionState get_transaction_state(uint32_t txn_id) {
-    int idx = txn_id % MAX_TRANSACTIONS;
-    return transactions[idx].state;
+    Transaction* txn = find_transaction(txn_id);
+    return txn ? txn->state : transaction_status(txn_id);
 }
\ No newline at end of file
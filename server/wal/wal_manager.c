@@ -3,127 +3,665 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <pthread.h>
+#include <time.h>
 #include "../../common/wal_types.h"
 
+/**
+ * MiniDB Write-Ahead Log
+ * ======================
+ *
+ * RECORD FORMAT (see wal_types.h):
+ * +--------+----------+-----+----------+--------+---------+------+------------+-----------+---------+
+ * | LENGTH | CHECKSUM | LSN | PREV_LSN | TXN_ID | PAGE_ID | TYPE | BEFORE_LEN | AFTER_LEN | PAYLOAD |
+ * +--------+----------+-----+----------+--------+---------+------+------------+-----------+---------+
+ * - Records are variable length: a 37-byte header plus the before/after
+ *   images actually supplied (up to WAL_MAX_IMAGE_SIZE each). Images are
+ *   never truncated; write_wal_record() rejects anything larger.
+ * - The LSN is the record's byte position in the log. Readers need no
+ *   index: the next record starts at lsn + length (wal_reader_open() /
+ *   wal_reader_next_ref()).
+ * - Readers mmap one segment file at a time and return records in place,
+ *   validated but not copied; wal_reader_read_ref() does the same for a
+ *   random LSN, which UNDO uses to walk prev_lsn chains backwards.
+ * - CHECKSUM is a CRC32C (crc32c.c) of the whole record. A record whose
+ *   length, LSN or checksum does not validate ends the log.
+ *
+ * SEGMENTS:
+ * - The log is split into WAL_SEGMENT_SIZE files, <wal>.000000000000,
+ *   <wal>.000000000001, ... each starting with a WALSegmentHeader.
+ * - A record that does not fit in the rest of a segment goes to the start
+ *   of the next one; the previous segment is fsync'd before that, so a
+ *   reader that hits the unused end of a segment continues in the next
+ *   segment only if its first record validates.
+ * - After a checkpoint, wal_recycle_segments() drops the segments wholly
+ *   below the checkpoint's redo point and the first record of every
+ *   transaction still active: up to WAL_RECYCLE_SEGMENTS are
+ *   renamed to future segment numbers and overwritten in place when the
+ *   log reaches them, the rest are removed. Stale records in a recycled
+ *   segment never validate because their LSNs belong to its old position.
+ * - Every WAL_CHECKPOINT_SEGMENTS new segments, or WAL_CHECKPOINT_INTERVAL
+ *   seconds after the last checkpoint if anything was logged since,
+ *   wal_checkpoint_due() asks the server to take a checkpoint.
+ *
+ * CHECKPOINTS:
+ * - Checkpoints are fuzzy: they log the active transaction table and the
+ *   buffer pool's dirty page table (see wal_types.h) instead of flushing
+ *   every page. wal_checkpoint_complete() then records the checkpoint in
+ *   the control file <wal>.control, which recovery reads to start at the
+ *   checkpoint instead of scanning the whole log.
+ * - The WAL keeps the active transaction table itself: every record is
+ *   chained to its transaction's previous one through prev_lsn, and
+ *   COMMIT/ABORT drop the transaction from the table. The table grows
+ *   with the number of open transactions; a record whose transaction
+ *   cannot be tracked is refused rather than logged with a broken chain.
+ *
+ * TORN TAILS:
+ * - A crash can leave a partially written last record (or zero-filled
+ *   space) after the last complete one. init_wal_manager() walks the log,
+ *   and if anything follows the last valid record it truncates the segment
+ *   there before new records are appended, so recovery and later readers
+ *   never see the torn bytes.
+ *
+ * GROUP COMMIT:
+ * - write_wal_record() only appends the record to wal_mgr.buffer; the
+ *   buffer is handed to write() when it fills or when someone needs it
+ *   durable.
+ * - wal_flush_to(lsn) makes every record up to lsn durable. The first
+ *   caller to find no flush running becomes the leader: it writes out the
+ *   whole buffer and fsyncs with the WAL mutex released. Committers that
+ *   arrive meanwhile append their commit records and wait on flush_cond;
+ *   the next leader covers all of them with a single fsync.
+ * - Callers whose record already lies below flushed_lsn return at once.
+ *
+ * ASYNCHRONOUS COMMIT:
+ * - With synchronous_commit off, a commit returns once its record is in the
+ *   buffer and only reports the LSN through wal_commit_async().
+ * - The WAL writer thread wakes every writer_delay_ms (SET wal_writer_delay,
+ *   WAL_WRITER_DELAY_MS by default) and flushes up to the latest such
+ *   commit, so a crash loses at most about one interval of commits.
+ * - A lost commit leaves its transaction without a COMMIT record, and
+ *   recovery rolls it back like any other unfinished transaction. The
+ *   write-ahead rule still holds, so the database stays consistent.
+ *
+ * WRITE-AHEAD RULE:
+ * - The buffer manager calls flush_wal() before writing a dirty page, so a
+ *   page never reaches disk ahead of the log records that describe it.
+ */
+
 static WALManager wal_mgr;
 
+extern uint32_t crc32c(uint32_t crc, const void* data, size_t len);
+extern const char* crc32c_implementation();
+
+// CRC32C over header + payload, skipping the checksum field itself
 uint32_t calculate_checksum(const WALRecord* record) {
-    WALRecord temp_record = *record;
-    temp_record.checksum = 0;  // Always zero checksum field for calculation
+    const char* data = (const char*)record;
+    size_t skip_end = offsetof(WALRecord, checksum) + sizeof(record->checksum);
+    uint32_t crc = crc32c(0, data, offsetof(WALRecord, checksum));
+    return crc32c(crc, data + skip_end, record->length - skip_end);
+}
+
+const char* wal_record_type_name(int type) {
+    switch (type) {
+        case WAL_BEGIN: return "BEGIN";
+        case WAL_COMMIT: return "COMMIT";
+        case WAL_ABORT: return "ABORT";
+        case WAL_INSERT: return "INSERT";
+        case WAL_UPDATE: return "UPDATE";
+        case WAL_DELETE: return "DELETE";
+        case WAL_DDL: return "DDL";
+        case WAL_CHECKPOINT: return "CHECKPOINT";
+        case WAL_CLR: return "CLR";
+        default: return "UNKNOWN";
+    }
+}
+
+static void segment_path(uint64_t segment, char* path, size_t size) {
+    snprintf(path, size, "%s.%012llu", wal_mgr.base_path, (unsigned long long)segment);
+}
+
+static int write_segment_header(int fd, uint64_t segment) {
+    WALSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WAL_MAGIC, sizeof(WAL_MAGIC));
+    header.version = WAL_FORMAT_VERSION;
+    header.segment = segment;
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) return -1;
+    return 0;
+}
+
+static bool segment_header_valid(int fd, uint64_t segment) {
+    WALSegmentHeader header;
+    return pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+           memcmp(header.magic, WAL_MAGIC, sizeof(WAL_MAGIC)) == 0 &&
+           header.version == WAL_FORMAT_VERSION && header.segment == segment;
+}
+
+/*
+ * Open a segment for appending: a recycled spare or a new file. The header
+ * is (re)written; whatever follows it is stale and is overwritten in place.
+ */
+static int open_segment_for_write(uint64_t segment) {
+    char path[300];
+    segment_path(segment, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        perror("Failed to open WAL segment");
+        return -1;
+    }
+    if (write_segment_header(fd, segment) != 0) {
+        perror("Failed to write WAL segment header");
+        close(fd);
+        return -1;
+    }
+    if (segment > wal_mgr.last_segment) wal_mgr.last_segment = segment;
+    return fd;
+}
+
+// Split base_path into its directory and the file name prefix
+static const char* wal_directory(char* dir, size_t size) {
+    const char* slash = strrchr(wal_mgr.base_path, '/');
+    if (!slash) {
+        snprintf(dir, size, ".");
+        return wal_mgr.base_path;
+    }
+    snprintf(dir, size, "%.*s", (int)(slash - wal_mgr.base_path), wal_mgr.base_path);
+    if (dir[0] == '\0') snprintf(dir, size, "/");
+    return slash + 1;
+}
+
+// Find the range of segment files already on disk; returns the number found
+static int find_segments(uint64_t* oldest, uint64_t* last) {
+    char dir[256];
+    const char* name = wal_directory(dir, sizeof(dir));
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+
+    int found = 0;
+    size_t name_len = strlen(name);
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char* suffix = entry->d_name + name_len;
+        if (strncmp(entry->d_name, name, name_len) != 0 || suffix[0] != '.' ||
+            strlen(suffix + 1) != 12 || strspn(suffix + 1, "0123456789") != 12) {
+            continue;
+        }
+        uint64_t segment = strtoull(suffix + 1, NULL, 10);
+        if (found == 0 || segment < *oldest) *oldest = segment;
+        if (found == 0 || segment > *last) *last = segment;
+        found++;
+    }
+    closedir(d);
+    return found;
+}
+
+static void reader_unmap(WALReader* reader) {
+    if (reader->map) munmap((void*)reader->map, reader->map_size);
+    reader->map = NULL;
+    reader->map_size = 0;
+}
+
+/*
+ * Map a segment file read-only, covering at least end_offset bytes. The
+ * whole file is mapped at once; a later record past the mapped size (the
+ * segment being appended to grew) remaps it.
+ */
+static const char* reader_map(WALReader* reader, uint64_t segment, uint64_t end_offset) {
+    if (reader->map && reader->map_segment == segment && end_offset <= reader->map_size) {
+        return reader->map;
+    }
+    reader_unmap(reader);
+    
+    char path[300];
+    segment_path(segment, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < end_offset) {
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
     
-    uint32_t checksum = 0;
-    const char* data = (const char*)&temp_record;
-    size_t size = sizeof(WALRecord);
-    for (size_t i = 0; i < size; i++) {
-        checksum += (unsigned char)data[i];
+    reader->map = map;
+    reader->map_size = st.st_size;
+    reader->map_segment = segment;
+    return reader->map;
+}
+
+/*
+ * Locate the record that starts at lsn in the reader's mapping, without
+ * copying it. Returns -1 if no complete, valid record starts there.
+ */
+static int reader_ref(WALReader* reader, uint64_t lsn, const WALRecord** out, bool report) {
+    uint64_t segment = WAL_SEGMENT_OF(lsn);
+    uint64_t offset = lsn - WAL_SEGMENT_START(segment);
+    if (offset < sizeof(WALSegmentHeader) || lsn + WAL_HEADER_SIZE > reader->end_lsn) return -1;
+
+    const char* map = reader_map(reader, segment, offset + WAL_HEADER_SIZE);
+    if (!map) return -1;
+    const WALRecord* record = (const WALRecord*)(map + offset);
+    if (record->lsn != lsn || record->before_len > WAL_MAX_IMAGE_SIZE ||
+        record->after_len > WAL_MAX_IMAGE_SIZE ||
+        record->length != (uint32_t)(WAL_HEADER_SIZE + record->before_len + record->after_len) ||
+        offset + record->length > WAL_SEGMENT_SIZE || lsn + record->length > reader->end_lsn) {
+        return -1;
+    }
+    if (offset + record->length > reader->map_size) {
+        map = reader_map(reader, segment, offset + record->length);
+        if (!map) return -1;
+        record = (const WALRecord*)(map + offset);
+    }
+
+    // Verify checksum
+    uint32_t actual_checksum = calculate_checksum(record);
+    if (actual_checksum != record->checksum) {
+        if (report) {
+#ifdef MACOS
+            printf("WAL: Checksum mismatch for LSN %llu (expected=%u, actual=%u)\n", (unsigned long long)lsn, record->checksum, actual_checksum);
+#else
+            printf("WAL: Checksum mismatch for LSN %lu (expected=%u, actual=%u)\n", (unsigned long)lsn, record->checksum, actual_checksum);
+#endif
+        }
+        return -1;
     }
-    return checksum;
+    *out = record;
+    return 0;
 }
 
+/*
+ * Advance the reader to the next valid record. A failed read may just be
+ * the unused end of a segment, so the first record of the next segment is
+ * tried before declaring the end of the log.
+ */
+static int reader_advance(WALReader* reader, const WALRecord** record, bool report) {
+    if (reader->next_lsn >= reader->end_lsn) return 0;
+    if (reader_ref(reader, reader->next_lsn, record, report) != 0) {
+        uint64_t next_first = WAL_FIRST_RECORD_LSN(WAL_SEGMENT_OF(reader->next_lsn) + 1);
+        if (next_first >= reader->end_lsn || reader_ref(reader, next_first, record, false) != 0) {
+            reader->end_lsn = reader->next_lsn;
+            return -1;
+        }
+    }
+    reader->next_lsn = (*record)->lsn + (*record)->length;
+    return 1;
+}
+
+static uint32_t control_checksum(WALControlFile control) {
+    control.checksum = 0;
+    return crc32c(0, &control, sizeof(control));
+}
+
+/*
+ * Read the control file. Returns 0 and the last checkpoint's location, or
+ * -1 if there is no valid control file.
+ */
+int wal_read_control(uint64_t* checkpoint_lsn, uint64_t* redo_lsn) {
+    char path[300];
+    snprintf(path, sizeof(path), "%s.control", wal_mgr.base_path);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+    
+    WALControlFile control;
+    ssize_t n = pread(fd, &control, sizeof(control), 0);
+    close(fd);
+    if (n != sizeof(control) || memcmp(control.magic, WAL_CONTROL_MAGIC, sizeof(WAL_CONTROL_MAGIC)) != 0 ||
+        control.version != WAL_FORMAT_VERSION || control.checksum != control_checksum(control)) {
+        printf("WAL: Ignoring invalid control file %s\n", path);
+        return -1;
+    }
+    *checkpoint_lsn = control.checkpoint_lsn;
+    *redo_lsn = control.redo_lsn;
+    return 0;
+}
+
+// Replace the control file atomically: temp file, fsync, rename, fsync directory
+static int write_control(uint64_t checkpoint_lsn, uint64_t redo_lsn) {
+    WALControlFile control;
+    memset(&control, 0, sizeof(control));
+    memcpy(control.magic, WAL_CONTROL_MAGIC, sizeof(WAL_CONTROL_MAGIC));
+    control.version = WAL_FORMAT_VERSION;
+    control.checkpoint_lsn = checkpoint_lsn;
+    control.redo_lsn = redo_lsn;
+    control.checksum = control_checksum(control);
+    
+    char path[300], temp_path[310];
+    snprintf(path, sizeof(path), "%s.control", wal_mgr.base_path);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror("Failed to create WAL control file");
+        return -1;
+    }
+    if (pwrite(fd, &control, sizeof(control), 0) != sizeof(control) || fsync(fd) != 0) {
+        perror("Failed to write WAL control file");
+        close(fd);
+        unlink(temp_path);
+        return -1;
+    }
+    close(fd);
+    if (rename(temp_path, path) != 0) {
+        perror("Failed to install WAL control file");
+        unlink(temp_path);
+        return -1;
+    }
+    
+    char dir[256];
+    wal_directory(dir, sizeof(dir));
+    int dir_fd = open(dir, O_RDONLY);
+    if (dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
+}
+
+static void* wal_writer_main(void* arg);
+
 int init_wal_manager(const char* wal_file) {
     printf("WAL: Initializing mutex...\n");
     if (pthread_mutex_init(&wal_mgr.wal_mutex, NULL) != 0) {
         perror("Failed to initialize WAL mutex");
         return -1;
     }
-    
-    printf("WAL: Opening file %s...\n", wal_file);
-    wal_mgr.wal_fd = open(wal_file, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (pthread_cond_init(&wal_mgr.flush_cond, NULL) != 0) {
+        perror("Failed to initialize WAL flush condition");
+        pthread_mutex_destroy(&wal_mgr.wal_mutex);
+        return -1;
+    }
+    snprintf(wal_mgr.base_path, sizeof(wal_mgr.base_path), "%s", wal_file);
+    wal_mgr.buffer_pos = 0;
+    wal_mgr.checkpoint_lsn = 0;
+    wal_mgr.redo_lsn = 0;
+    wal_mgr.checkpoint_time = time(NULL);
+    wal_mgr.checkpoint_requested = false;
+    free(wal_mgr.active_txns);
+    wal_mgr.active_txns = NULL;
+    wal_mgr.active_txn_count = 0;
+    wal_mgr.active_txn_capacity = 0;
+    wal_mgr.flush_in_progress = false;
+    wal_mgr.flush_waiters = 0;
+    wal_mgr.fsync_count = 0;
+    wal_mgr.async_commit_lsn = 0;
+    wal_mgr.writer_delay_ms = WAL_WRITER_DELAY_MS;
+    wal_mgr.writer_running = false;
+    printf("WAL: Record checksums use CRC32C (%s)\n", crc32c_implementation());
+
+    printf("WAL: Opening segments %s.*...\n", wal_file);
+    uint64_t oldest = 0, last = 0;
+    int segment_count = find_segments(&oldest, &last);
+    wal_mgr.oldest_segment = oldest;
+    wal_mgr.last_segment = last;
+    wal_mgr.redo_lsn = WAL_SEGMENT_START(oldest);
+    uint64_t end_lsn = WAL_FIRST_RECORD_LSN(oldest);
+    wal_mgr.current_lsn = 0;
+
+    if (segment_count > 0) {
+        // An existing log must carry our header
+        char path[300];
+        segment_path(oldest, path, sizeof(path));
+        int fd = open(path, O_RDONLY);
+        bool valid = fd != -1 && segment_header_valid(fd, oldest);
+        if (fd != -1) close(fd);
+        if (!valid) {
+            printf("WAL: %s is not a version %d MiniDB log segment\n", path, WAL_FORMAT_VERSION);
+            pthread_cond_destroy(&wal_mgr.flush_cond);
+            pthread_mutex_destroy(&wal_mgr.wal_mutex);
+            return -1;
+        }
+
+        // Torn-tail detection: the log ends at the last record that validates
+        const WALRecord* record;
+        WALReader reader = { end_lsn, WAL_SEGMENT_START(last + 1), NULL, 0, 0 };
+        while (reader_advance(&reader, &record, false) > 0) {
+            wal_mgr.current_lsn = record->lsn;
+        }
+        reader_unmap(&reader);
+        if (wal_mgr.current_lsn != 0) end_lsn = reader.next_lsn;
+    }
+
+    // Append in the segment holding the end of the log
+    wal_mgr.segment = WAL_SEGMENT_OF(end_lsn - 1);
+    wal_mgr.wal_fd = open_segment_for_write(wal_mgr.segment);
     if (wal_mgr.wal_fd == -1) {
-        perror("Failed to open WAL file");
+        pthread_cond_destroy(&wal_mgr.flush_cond);
         pthread_mutex_destroy(&wal_mgr.wal_mutex);
         return -1;
     }
-    
-    // Get current LSN from file size
-    printf("WAL: Getting file size...\n");
-    off_t file_size = lseek(wal_mgr.wal_fd, 0, SEEK_END);
-    if (file_size >= 0) {
-        wal_mgr.current_lsn = file_size / WAL_RECORD_SIZE;
-    #ifdef MACOS
-        printf("WAL: File size: %lld, LSN: %llu\n", (long long)file_size, (unsigned long long)wal_mgr.current_lsn);
+    off_t segment_size = lseek(wal_mgr.wal_fd, 0, SEEK_END);
+    uint64_t end_offset = end_lsn - WAL_SEGMENT_START(wal_mgr.segment);
+    if (segment_size > (off_t)end_offset) {
+#ifdef MACOS
+        printf("WAL: Torn tail at LSN %llu, discarding %lld bytes\n",
+               (unsigned long long)end_lsn, (long long)(segment_size - end_offset));
 #else
-        printf("WAL: File size: %ld, LSN: %lu\n", (long)file_size, (unsigned long)wal_mgr.current_lsn);
+        printf("WAL: Torn tail at LSN %lu, discarding %ld bytes\n",
+               (unsigned long)end_lsn, (long)(segment_size - end_offset));
 #endif
-    } else {
-        perror("WAL: Failed to get file size");
-        wal_mgr.current_lsn = 0;
+        if (ftruncate(wal_mgr.wal_fd, end_offset) != 0) {
+            perror("Failed to truncate torn WAL tail");
+        }
     }
-    wal_mgr.checkpoint_lsn = 0;
-    wal_mgr.buffer_pos = 0;
+    if (fsync(wal_mgr.wal_fd) != 0) {
+        perror("Failed to fsync WAL segment");
+    }
+    wal_mgr.insert_lsn = end_lsn;
+    wal_mgr.written_lsn = end_lsn;
+    wal_mgr.flushed_lsn = end_lsn;
+    wal_mgr.checkpoint_end_lsn = end_lsn;
     memset(wal_mgr.buffer, 0, sizeof(wal_mgr.buffer));
     
+    // The control file locates the last checkpoint, if it is still in the log
+    uint64_t checkpoint_lsn, redo_lsn;
+    if (segment_count > 0 && wal_read_control(&checkpoint_lsn, &redo_lsn) == 0 &&
+        checkpoint_lsn >= WAL_FIRST_RECORD_LSN(wal_mgr.oldest_segment) && checkpoint_lsn < end_lsn) {
+        wal_mgr.checkpoint_lsn = checkpoint_lsn;
+        wal_mgr.redo_lsn = redo_lsn;
 #ifdef MACOS
-    printf("WAL manager initialized, file: %s, current LSN: %llu\n", 
-           wal_file, (unsigned long long)wal_mgr.current_lsn);
+        printf("WAL: Last checkpoint at LSN %llu, redo point %llu\n",
+               (unsigned long long)checkpoint_lsn, (unsigned long long)redo_lsn);
 #else
-    printf("WAL manager initialized, file: %s, current LSN: %lu\n", 
-           wal_file, (unsigned long)wal_mgr.current_lsn);
+        printf("WAL: Last checkpoint at LSN %lu, redo point %lu\n",
+               (unsigned long)checkpoint_lsn, (unsigned long)redo_lsn);
+#endif
+    }
+
+    if (pthread_cond_init(&wal_mgr.writer_cond, NULL) == 0) {
+        wal_mgr.writer_running = true;
+        if (pthread_create(&wal_mgr.writer_thread, NULL, wal_writer_main, NULL) != 0) {
+            printf("WAL: Could not start the WAL writer, asynchronous commits will flush synchronously\n");
+            wal_mgr.writer_running = false;
+            pthread_cond_destroy(&wal_mgr.writer_cond);
+        }
+    }
+
+#ifdef MACOS
+    printf("WAL manager initialized, file: %s, segments %llu-%llu, end of log: %llu\n", wal_file,
+           (unsigned long long)wal_mgr.oldest_segment, (unsigned long long)wal_mgr.segment,
+           (unsigned long long)wal_mgr.insert_lsn);
+#else
+    printf("WAL manager initialized, file: %s, segments %lu-%lu, end of log: %lu\n", wal_file,
+           (unsigned long)wal_mgr.oldest_segment, (unsigned long)wal_mgr.segment,
+           (unsigned long)wal_mgr.insert_lsn);
 #endif
     return 0;
 }
 
-uint64_t write_wal_record(WALRecordType type, uint32_t txn_id, int page_id, 
-                         const char* before_image, const char* after_image, int record_size) {
-    pthread_mutex_lock(&wal_mgr.wal_mutex);
+// Hand the buffered records to the OS. Caller holds wal_mutex.
+static int write_buffer_locked() {
+    int written = 0;
+    uint64_t offset = wal_mgr.written_lsn - WAL_SEGMENT_START(wal_mgr.segment);
+    while (written < wal_mgr.buffer_pos) {
+        ssize_t n = pwrite(wal_mgr.wal_fd, wal_mgr.buffer + written, wal_mgr.buffer_pos - written,
+                           offset + written);
+        if (n <= 0) {
+            perror("Failed to write WAL buffer");
+            // Keep the unwritten tail buffered for the next attempt
+            memmove(wal_mgr.buffer, wal_mgr.buffer + written, wal_mgr.buffer_pos - written);
+            wal_mgr.buffer_pos -= written;
+            wal_mgr.written_lsn += written;
+            return -1;
+        }
+        written += n;
+    }
+    wal_mgr.buffer_pos = 0;
+    wal_mgr.written_lsn = wal_mgr.insert_lsn;
+    return 0;
+}
+
+/*
+ * Move appends to the next segment. The current one is written out and
+ * fsync'd first, so no byte of the new segment is durable before all of
+ * the old one. Caller holds wal_mutex and no flush is in progress.
+ */
+static int switch_segment_locked() {
+    if (write_buffer_locked() != 0) return -1;
+    if (fsync(wal_mgr.wal_fd) != 0) {
+        perror("Failed to fsync WAL segment");
+        return -1;
+    }
+    wal_mgr.flushed_lsn = wal_mgr.written_lsn;
+
+    int fd = open_segment_for_write(wal_mgr.segment + 1);
+    if (fd == -1) return -1;
+    close(wal_mgr.wal_fd);
+    wal_mgr.wal_fd = fd;
+    wal_mgr.segment++;
+    wal_mgr.insert_lsn = WAL_FIRST_RECORD_LSN(wal_mgr.segment);
+    wal_mgr.written_lsn = wal_mgr.insert_lsn;
+
+    if (wal_mgr.segment - WAL_SEGMENT_OF(wal_mgr.checkpoint_lsn) >= WAL_CHECKPOINT_SEGMENTS) {
+        wal_mgr.checkpoint_requested = true;
+    }
+#ifdef MACOS
+    printf("WAL: Switched to segment %llu\n", (unsigned long long)wal_mgr.segment);
+#else
+    printf("WAL: Switched to segment %lu\n", (unsigned long)wal_mgr.segment);
+#endif
+    return 0;
+}
+
+/*
+ * Chain the record to its transaction's previous record and keep the active
+ * transaction table current. Caller holds wal_mutex and has assigned the LSN.
+ * A CLR arrives with its undo-next LSN in prev_lsn and keeps it. Returns -1,
+ * with nothing changed, if the table cannot grow for a new transaction.
+ */
+static int track_transaction_locked(WALRecord* record) {
+    if (record->type != WAL_CLR) record->prev_lsn = 0;
+    if (record->txn_id == 0) return 0;   // Checkpoints belong to no transaction
     
-    WALRecord record = {0};
+    int i;
+    for (i = 0; i < wal_mgr.active_txn_count; i++) {
+        if (wal_mgr.active_txns[i].txn_id == record->txn_id) break;
+    }
+    if (i < wal_mgr.active_txn_count && record->type != WAL_CLR) {
+        record->prev_lsn = wal_mgr.active_txns[i].last_lsn;
+    }
+    
+    if (record->type == WAL_COMMIT || record->type == WAL_ABORT) {
+        if (i < wal_mgr.active_txn_count) {
+            wal_mgr.active_txns[i] = wal_mgr.active_txns[--wal_mgr.active_txn_count];
+        }
+        return 0;
+    }
+    if (i == wal_mgr.active_txn_count) {
+        if (wal_mgr.active_txn_count == wal_mgr.active_txn_capacity) {
+            int capacity = wal_mgr.active_txn_capacity ? wal_mgr.active_txn_capacity * 2 : WAL_ACTIVE_TXNS_INITIAL;
+            WALCheckpointTxn* grown = realloc(wal_mgr.active_txns, (size_t)capacity * sizeof(WALCheckpointTxn));
+            if (!grown) {
+                printf("WAL: Cannot grow the active transaction table for TXN %u\n", record->txn_id);
+                return -1;
+            }
+            wal_mgr.active_txns = grown;
+            wal_mgr.active_txn_capacity = capacity;
+        }
+        wal_mgr.active_txns[i].txn_id = record->txn_id;
+        wal_mgr.active_txns[i].first_lsn = record->lsn;
+        wal_mgr.active_txn_count++;
+    }
+    wal_mgr.active_txns[i].last_lsn = record->lsn;
+    return 0;
+}
+
+static uint64_t append_wal_record(WALRecordType type, uint32_t txn_id, int page_id,
+                                  const char* before_image, const char* after_image, int record_size,
+                                  uint64_t undo_next_lsn) {
+    if (record_size < 0 || record_size > WAL_MAX_IMAGE_SIZE) {
+        printf("WAL: Refusing %s record with %d-byte image (max %d)\n",
+               wal_record_type_name(type), record_size, WAL_MAX_IMAGE_SIZE);
+        return 0;
+    }
+
+    WALRecord record;
     record.type = type;
     record.txn_id = txn_id;
-    record.lsn = ++wal_mgr.current_lsn;
-    record.prev_lsn = 0; // Simplified - would track per transaction
     record.page_id = page_id;
-    record.record_size = record_size;
-    
-    if (before_image && record_size > 0) {
-        int copy_size = (record_size < 256) ? record_size : 256;
-        memcpy(record.before_image, before_image, copy_size);
+    record.prev_lsn = undo_next_lsn;
+    record.before_len = before_image ? record_size : 0;
+    record.after_len = after_image ? record_size : 0;
+    if (before_image) memcpy(record.payload, before_image, record.before_len);
+    if (after_image) memcpy(record.payload + record.before_len, after_image, record.after_len);
+    record.length = WAL_HEADER_SIZE + record.before_len + record.after_len;
+
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+
+    // Records never span segments: move on when this one is full. A leader
+    // may be fsyncing the current segment without the mutex; let it finish.
+    while (wal_mgr.insert_lsn - WAL_SEGMENT_START(wal_mgr.segment) + record.length > WAL_SEGMENT_SIZE) {
+        if (wal_mgr.flush_in_progress) {
+            pthread_cond_wait(&wal_mgr.flush_cond, &wal_mgr.wal_mutex);
+            continue;
+        }
+        if (switch_segment_locked() != 0) {
+            pthread_mutex_unlock(&wal_mgr.wal_mutex);
+            return 0;
+        }
     }
-    if (after_image && record_size > 0) {
-        int copy_size = (record_size < 256) ? record_size : 256;
-        memcpy(record.after_image, after_image, copy_size);
+
+    // Append to the WAL buffer; durability is provided by wal_flush_to()
+    if (wal_mgr.buffer_pos + (int)record.length > WAL_BUFFER_SIZE &&
+        write_buffer_locked() != 0) {
+        pthread_mutex_unlock(&wal_mgr.wal_mutex);
+        return 0;
     }
-    
-    record.checksum = calculate_checksum(&record);
-    
-    // Write to WAL file immediately (force durability)
-    if (write(wal_mgr.wal_fd, &record, sizeof(WALRecord)) != sizeof(WALRecord)) {
-        perror("Failed to write WAL record");
+    record.lsn = wal_mgr.insert_lsn;
+    if (track_transaction_locked(&record) != 0) {
         pthread_mutex_unlock(&wal_mgr.wal_mutex);
         return 0;
     }
-    
-    fsync(wal_mgr.wal_fd); // Force to disk
-    
+    record.checksum = calculate_checksum(&record);
+    memcpy(wal_mgr.buffer + wal_mgr.buffer_pos, &record, record.length);
+    wal_mgr.buffer_pos += record.length;
+    wal_mgr.insert_lsn += record.length;
+    wal_mgr.current_lsn = record.lsn;
+
     uint64_t lsn = record.lsn;
     pthread_mutex_unlock(&wal_mgr.wal_mutex);
-    
+
 #ifdef MACOS
-    printf("WAL: Wrote %s record, LSN: %llu, TXN: %u\n", 
-           type == WAL_BEGIN ? "BEGIN" :
-           type == WAL_COMMIT ? "COMMIT" :
-           type == WAL_ABORT ? "ABORT" :
-           type == WAL_INSERT ? "INSERT" :
-           type == WAL_UPDATE ? "UPDATE" :
-           type == WAL_DELETE ? "DELETE" :
-           type == WAL_DDL ? "DDL" : "CHECKPOINT",
-           (unsigned long long)lsn, txn_id);
+    printf("WAL: Appended %s record, LSN: %llu, TXN: %u, %u bytes\n",
+           wal_record_type_name(type), (unsigned long long)lsn, txn_id, record.length);
 #else
-    printf("WAL: Wrote %s record, LSN: %lu, TXN: %u\n", 
-           type == WAL_BEGIN ? "BEGIN" :
-           type == WAL_COMMIT ? "COMMIT" :
-           type == WAL_ABORT ? "ABORT" :
-           type == WAL_INSERT ? "INSERT" :
-           type == WAL_UPDATE ? "UPDATE" :
-           type == WAL_DELETE ? "DELETE" :
-           type == WAL_DDL ? "DDL" : "CHECKPOINT",
-           (unsigned long)lsn, txn_id);
+    printf("WAL: Appended %s record, LSN: %lu, TXN: %u, %u bytes\n",
+           wal_record_type_name(type), (unsigned long)lsn, txn_id, record.length);
 #endif
-    
+
     return lsn;
 }
 
+uint64_t write_wal_record(WALRecordType type, uint32_t txn_id, int page_id,
+                         const char* before_image, const char* after_image, int record_size) {
+    return append_wal_record(type, txn_id, page_id, before_image, after_image, record_size, 0);
+}
+
 uint64_t wal_begin_transaction(uint32_t txn_id) {
     return write_wal_record(WAL_BEGIN, txn_id, -1, NULL, NULL, 0);
 }
@@ -148,6 +686,12 @@ uint64_t wal_log_delete(uint32_t txn_id, int page_id, const char* record, int re
     return write_wal_record(WAL_DELETE, txn_id, page_id, record, NULL, record_size);
 }
 
+// Compensate a rolled-back change: before = row as it was changed, after = row restored
+uint64_t wal_log_clr(uint32_t txn_id, int page_id, const char* before, const char* after, int record_size,
+                     uint64_t undo_next_lsn) {
+    return append_wal_record(WAL_CLR, txn_id, page_id, before, after, record_size, undo_next_lsn);
+}
+
 uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_name) {
     // Store DDL info in after_image field
     char ddl_info[256];
@@ -155,60 +699,324 @@ uint64_t wal_log_ddl(uint32_t txn_id, const char* ddl_type, const char* object_n
     return write_wal_record(WAL_DDL, txn_id, -1, NULL, ddl_info, strlen(ddl_info));
 }
 
+// Has txn_id logged records that still need a COMMIT or ABORT?
+bool wal_transaction_logged(uint32_t txn_id) {
+    bool logged = false;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    for (int i = 0; i < wal_mgr.active_txn_count && !logged; i++) {
+        logged = wal_mgr.active_txns[i].txn_id == txn_id;
+    }
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return logged;
+}
+
+// Head of txn_id's prev_lsn chain (0 if it has logged nothing)
+uint64_t wal_transaction_last_lsn(uint32_t txn_id) {
+    uint64_t last_lsn = 0;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    for (int i = 0; i < wal_mgr.active_txn_count; i++) {
+        if (wal_mgr.active_txns[i].txn_id == txn_id) {
+            last_lsn = wal_mgr.active_txns[i].last_lsn;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return last_lsn;
+}
+
 uint64_t wal_log_commit(uint32_t txn_id) {
     return write_wal_record(WAL_COMMIT, txn_id, -1, NULL, NULL, 0);
 }
 
+// Iterate the log from start_lsn (0 = oldest record kept) to its current end
+void wal_reader_open(WALReader* reader, uint64_t start_lsn) {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    write_buffer_locked();
+    reader->end_lsn = wal_mgr.written_lsn;
+    uint64_t first_lsn = WAL_FIRST_RECORD_LSN(wal_mgr.oldest_segment);
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    reader->next_lsn = start_lsn > first_lsn ? start_lsn : first_lsn;
+    reader->map = NULL;
+    reader->map_size = 0;
+    reader->map_segment = 0;
+}
+
+/*
+ * Zero-copy iteration: return 1 and point *record into the mapped log, 0
+ * at the end of the log, or -1 if the log ends in a record that cannot be
+ * read (iteration stops there). *record stays valid until the next call on
+ * this reader or wal_reader_close().
+ */
+int wal_reader_next_ref(WALReader* reader, const WALRecord** record) {
+    int ret = reader_advance(reader, record, true);
+    if (ret < 0) {
+#ifdef MACOS
+        printf("WAL: Unreadable record at LSN %llu, treating it as the end of the log\n", (unsigned long long)reader->next_lsn);
+#else
+        printf("WAL: Unreadable record at LSN %lu, treating it as the end of the log\n", (unsigned long)reader->next_lsn);
+#endif
+    }
+    return ret;
+}
+
+// Like wal_reader_next_ref(), copying the record out
+int wal_reader_next(WALReader* reader, WALRecord* record) {
+    const WALRecord* ref;
+    int ret = wal_reader_next_ref(reader, &ref);
+    if (ret > 0) memcpy(record, ref, ref->length);
+    return ret;
+}
+
+/*
+ * Zero-copy random access through an open reader, e.g. to follow prev_lsn
+ * chains. Returns -1 if no complete, valid record starts at lsn; the
+ * reader's position is unchanged.
+ */
+int wal_reader_read_ref(WALReader* reader, uint64_t lsn, const WALRecord** record) {
+    return reader_ref(reader, lsn, record, true);
+}
+
+void wal_reader_close(WALReader* reader) {
+    reader_unmap(reader);
+}
+
+/*
+ * Read the record that starts at lsn. Returns -1 if no complete, valid
+ * record starts there (past the end of the log, torn or corrupt).
+ */
 int read_wal_record(uint64_t lsn, WALRecord* record) {
+    WALReader reader;
+    const WALRecord* ref;
+    wal_reader_open(&reader, 0);
+    int ret = reader_ref(&reader, lsn, &ref, true);
+    if (ret == 0) memcpy(record, ref, ref->length);
+    wal_reader_close(&reader);
+    return ret;
+}
+
+uint64_t get_current_lsn() {
+    return wal_mgr.current_lsn;
+}
+
+// LSN the next record will get
+uint64_t wal_end_lsn() {
     pthread_mutex_lock(&wal_mgr.wal_mutex);
-    
-    off_t offset = (lsn - 1) * sizeof(WALRecord);  // LSN starts at 1, offset starts at 0
-    if (lseek(wal_mgr.wal_fd, offset, SEEK_SET) == -1) {
-        pthread_mutex_unlock(&wal_mgr.wal_mutex);
-        return -1;
+    uint64_t lsn = wal_mgr.insert_lsn;
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return lsn;
+}
+
+// True once enough WAL (or time with new WAL) has accumulated since the last checkpoint
+bool wal_checkpoint_due() {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    bool due = wal_mgr.checkpoint_requested ||
+               (wal_mgr.insert_lsn > wal_mgr.checkpoint_end_lsn &&
+                time(NULL) - wal_mgr.checkpoint_time >= WAL_CHECKPOINT_INTERVAL);
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return due;
+}
+
+uint64_t wal_last_checkpoint_lsn() {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    uint64_t lsn = wal_mgr.checkpoint_lsn;
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return lsn;
+}
+
+/*
+ * Snapshot the active transaction table for a checkpoint; the caller frees
+ * *txns. Returns the number of entries.
+ */
+int wal_collect_active_txns(WALCheckpointTxn** txns) {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    int count = wal_mgr.active_txn_count;
+    *txns = malloc((count > 0 ? count : 1) * sizeof(WALCheckpointTxn));
+    if (*txns) {
+        if (count > 0) memcpy(*txns, wal_mgr.active_txns, count * sizeof(WALCheckpointTxn));
+    } else {
+        count = -1;
     }
-    
-    int bytes_read = read(wal_mgr.wal_fd, record, sizeof(WALRecord));
     pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return count;
+}
+
+/*
+ * Record a checkpoint whose records (flushed) start at checkpoint_lsn:
+ * point the control file at it and restart the checkpoint triggers.
+ */
+int wal_checkpoint_complete(uint64_t checkpoint_lsn, uint64_t redo_lsn) {
+    if (write_control(checkpoint_lsn, redo_lsn) != 0) return -1;
     
-    if (bytes_read != sizeof(WALRecord)) {
-        return -1;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    wal_mgr.checkpoint_lsn = checkpoint_lsn;
+    wal_mgr.checkpoint_end_lsn = wal_mgr.insert_lsn;
+    wal_mgr.redo_lsn = redo_lsn;
+    wal_mgr.checkpoint_time = time(NULL);
+    wal_mgr.checkpoint_requested = false;
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return 0;
+}
+
+/*
+ * Called after a checkpoint: segments wholly below keep_lsn (its redo
+ * point, or the first record of an older active transaction) are no longer
+ * needed for recovery. Keep up to WAL_RECYCLE_SEGMENTS of them as spares
+ * for future segment numbers and remove the rest.
+ */
+void wal_recycle_segments(uint64_t keep_lsn) {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    uint64_t keep_from = WAL_SEGMENT_OF(keep_lsn);
+    if (keep_from > wal_mgr.segment) keep_from = wal_mgr.segment;
+    int recycled = 0, removed = 0;
+    while (wal_mgr.oldest_segment < keep_from) {
+        char old_path[300], new_path[300];
+        segment_path(wal_mgr.oldest_segment, old_path, sizeof(old_path));
+        segment_path(wal_mgr.last_segment + 1, new_path, sizeof(new_path));
+        if (wal_mgr.last_segment - wal_mgr.segment < WAL_RECYCLE_SEGMENTS &&
+            rename(old_path, new_path) == 0) {
+            wal_mgr.last_segment++;
+            recycled++;
+        } else if (unlink(old_path) == 0) {
+            removed++;
+        } else {
+            perror("Failed to remove WAL segment");
+        }
+        wal_mgr.oldest_segment++;
     }
-    
-    // Verify checksum
-    uint32_t expected_checksum = record->checksum;
-    uint32_t actual_checksum = calculate_checksum(record);
-    
-    if (actual_checksum != expected_checksum) {
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+
+    if (recycled || removed) {
+        printf("WAL: Recycled %d and removed %d segment(s) no longer needed for recovery\n", recycled, removed);
+    }
+}
+
+/*
+ * Make every WAL record up to and including the one at lsn durable (group
+ * commit). Returns 0 once flushed_lsn > lsn, -1 if the write or fsync failed.
+ */
+int wal_flush_to(uint64_t lsn) {
+    int ret = 0;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    if (lsn > wal_mgr.current_lsn) lsn = wal_mgr.current_lsn;
+
+    wal_mgr.flush_waiters++;
+    // flushed_lsn is an end offset: the record at lsn is durable once it is past lsn
+    while (wal_mgr.flushed_lsn <= lsn) {
+        if (wal_mgr.flush_in_progress) {
+            // Follower: the running fsync (or the next one) covers our LSN
+            pthread_cond_wait(&wal_mgr.flush_cond, &wal_mgr.wal_mutex);
+            continue;
+        }
+
+        // Leader: write out everything appended so far, for all waiters
+        wal_mgr.flush_in_progress = true;
+        int group_size = wal_mgr.flush_waiters;
+        ret = write_buffer_locked();
+        uint64_t target = wal_mgr.written_lsn;
+        int fd = wal_mgr.wal_fd;
+
+        // fsync without the mutex so other sessions keep appending
+        pthread_mutex_unlock(&wal_mgr.wal_mutex);
+        if (ret == 0 && fsync(fd) != 0) {
+            perror("Failed to fsync WAL");
+            ret = -1;
+        }
+        pthread_mutex_lock(&wal_mgr.wal_mutex);
+
+        wal_mgr.flush_in_progress = false;
+        if (ret == 0) {
+            if (target > wal_mgr.flushed_lsn) wal_mgr.flushed_lsn = target;
+            wal_mgr.fsync_count++;
 #ifdef MACOS
-        printf("WAL: Checksum mismatch for LSN %llu (expected=%u, actual=%u) - IGNORING\n", (unsigned long long)lsn, expected_checksum, actual_checksum);
+            printf("WAL: Group flush to LSN %llu (%d waiting, fsync #%llu)\n",
+                   (unsigned long long)target, group_size, (unsigned long long)wal_mgr.fsync_count);
 #else
-        printf("WAL: Checksum mismatch for LSN %lu (expected=%u, actual=%u) - IGNORING\n", (unsigned long)lsn, expected_checksum, actual_checksum);
+            printf("WAL: Group flush to LSN %lu (%d waiting, fsync #%lu)\n",
+                   (unsigned long)target, group_size, (unsigned long)wal_mgr.fsync_count);
 #endif
-        // Temporarily disable checksum verification for recovery
-        // return -1;
+        }
+        pthread_cond_broadcast(&wal_mgr.flush_cond);
+        if (ret != 0) break;
     }
-    
-    return 0;
+    wal_mgr.flush_waiters--;
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return ret;
 }
 
-uint64_t get_current_lsn() {
-    return wal_mgr.current_lsn;
+// Flush everything appended so far
+void flush_wal() {
+    wal_flush_to(UINT64_MAX);
 }
 
-void flush_wal() {
+/*
+ * WAL writer: every writer_delay_ms, make the latest asynchronous commit
+ * durable. Runs until close_wal_manager().
+ */
+static void* wal_writer_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    while (wal_mgr.writer_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wal_mgr.writer_delay_ms / 1000;
+        deadline.tv_nsec += (long)(wal_mgr.writer_delay_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&wal_mgr.writer_cond, &wal_mgr.wal_mutex, &deadline);
+        
+        uint64_t lsn = wal_mgr.async_commit_lsn;
+        if (lsn == 0 || wal_mgr.flushed_lsn > lsn) continue;
+        pthread_mutex_unlock(&wal_mgr.wal_mutex);
+        wal_flush_to(lsn);
+        pthread_mutex_lock(&wal_mgr.wal_mutex);
+    }
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    return NULL;
+}
+
+/*
+ * Asynchronous commit: the commit record at lsn is buffered and the caller
+ * does not wait for it; the WAL writer makes it durable. Without a running
+ * writer the record is flushed here instead.
+ */
+void wal_commit_async(uint64_t lsn) {
     pthread_mutex_lock(&wal_mgr.wal_mutex);
-    fsync(wal_mgr.wal_fd);
+    bool writer = wal_mgr.writer_running;
+    if (writer && lsn > wal_mgr.async_commit_lsn) wal_mgr.async_commit_lsn = lsn;
     pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    if (!writer) wal_flush_to(lsn);
+}
+
+// SET wal_writer_delay: WAL writer interval in milliseconds; returns -1 if out of range
+int wal_set_writer_delay(int delay_ms) {
+    if (delay_ms < 1 || delay_ms > WAL_WRITER_MAX_DELAY_MS) return -1;
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    wal_mgr.writer_delay_ms = delay_ms;
+    if (wal_mgr.writer_running) pthread_cond_signal(&wal_mgr.writer_cond);
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    printf("WAL: Writer delay set to %d ms\n", delay_ms);
+    return 0;
 }
 
 void close_wal_manager() {
+    pthread_mutex_lock(&wal_mgr.wal_mutex);
+    bool writer = wal_mgr.writer_running;
+    wal_mgr.writer_running = false;
+    if (writer) pthread_cond_signal(&wal_mgr.writer_cond);
+    pthread_mutex_unlock(&wal_mgr.wal_mutex);
+    if (writer) {
+        pthread_join(wal_mgr.writer_thread, NULL);
+        pthread_cond_destroy(&wal_mgr.writer_cond);
+    }
+    
+    flush_wal();
     pthread_mutex_lock(&wal_mgr.wal_mutex);
     if (wal_mgr.wal_fd != -1) {
-        fsync(wal_mgr.wal_fd);
         close(wal_mgr.wal_fd);
         wal_mgr.wal_fd = -1;
     }
     pthread_mutex_unlock(&wal_mgr.wal_mutex);
     printf("WAL manager closed\n");
-}
\ No newline at end of file
+}
@@ -0,0 +1,14 @@
+@a create table acct (id int, owner varchar(20), balance int);
+@a insert into acct values (1, 'Alice', 100);
+@a insert into acct values (2, 'Bob', 200);
+@a begin;
+@a update acct set owner = 'Alicia' where id = 1;
+@b begin;
+@b update acct set owner = 'Robert' where id = 2;
+@b insert into acct values (3, 'Carol', 300);
+@b select * from acct;
+@a select * from acct;
+@b commit;
+@a update acct set owner = 'Ali' where id = 1;
+@a commit;
+@b select * from acct;
@@ -0,0 +1,14 @@
+@a create table acct (id int, owner varchar(20), balance int);
+@a insert into acct values (1, 'Alice', 100);
+@a insert into acct values (2, 'Bob', 200);
+@a begin;
+@a update acct set owner = 'Alicia' where id = 1;
+@b begin;
+@b update acct set owner = 'Robert' where id = 2;
+@a update acct set owner = 'Roberta' where id = 2;
+@b update acct set owner = 'Al' where id = 1;
+@sleep 2
+@b select * from acct;
+@b rollback;
+@a commit;
+@b select * from acct;
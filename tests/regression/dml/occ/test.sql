@@ -0,0 +1,16 @@
+create table stock (id int, name varchar(20), qty int);
+set concurrency_control = occ;
+insert into stock values (1, 'bolt', 10);
+insert into stock values (2, 'nut', 20);
+update stock set name = 'screw' where id = 1;
+begin;
+select * from stock where id = 2;
+update stock set name = 'washer' where id = 2;
+delete from stock where id = 1;
+commit;
+select * from stock;
+set concurrency_control = 2pl;
+insert into stock values (3, 'gear', 30);
+set concurrency_control = optimistic_locking;
+show concurrency;
+shutdown;
@@ -0,0 +1,19 @@
+@a create table stock (id int, name varchar(20), qty int);
+@a insert into stock values (1, 'bolt', 10);
+@a insert into stock values (2, 'nut', 20);
+@a set concurrency_control = occ;
+@b set concurrency_control = occ;
+@a begin;
+@a update stock set name = 'screw' where id = 1;
+@b begin;
+@b update stock set name = 'rivet' where id = 1;
+@b rollback;
+@b update stock set name = 'pin' where id = 1;
+@a commit;
+@b begin;
+@b select * from stock where id = 2;
+@a update stock set name = 'washer' where id = 2;
+@b update stock set name = 'stud' where id = 1;
+@b commit;
+@b select * from stock;
+@b show concurrency;
@@ -0,0 +1,20 @@
+create table item (id int, name varchar(20), qty int);
+begin;
+insert into item values (1, 'bolt', 10);
+savepoint chunk1;
+insert into item values (2, 'nut', 20);
+update item set name = 'screw' where id = 1;
+select * from item;
+rollback to savepoint chunk1;
+select * from item;
+savepoint chunk2;
+insert into item values (3, 'washer', 30);
+release savepoint chunk2;
+rollback to chunk2;
+insert into missing values (4, 'gear', 40);
+delete from item where id = 1;
+select * from item;
+commit;
+select * from item;
+savepoint outside;
+shutdown;
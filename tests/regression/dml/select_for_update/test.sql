@@ -0,0 +1,17 @@
+create table jobs (id int, state varchar(10));
+insert into jobs values (1, 'ready');
+insert into jobs values (2, 'ready');
+insert into jobs values (3, 'ready');
+insert into jobs values (4, 'done');
+set lock_timeout = 500;
+set lock_timeout = 99999999;
+begin;
+select id from jobs where state = 'ready' limit 2 for update skip locked;
+select * from jobs where id = 1 for update nowait;
+update jobs set state = 'taken' where id = 1;
+select * from jobs limit 1 for update later;
+commit;
+select * from jobs where state = 'ready' for update;
+select * from jobs limit 2;
+set lock_timeout = 0;
+shutdown;
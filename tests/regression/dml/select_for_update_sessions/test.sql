@@ -0,0 +1,25 @@
+@a create table jobs (id int, state varchar(10));
+@a insert into jobs values (1, 'ready');
+@a insert into jobs values (2, 'ready');
+@a insert into jobs values (3, 'ready');
+@a begin;
+@a select id from jobs where state = 'ready' limit 1 for update;
+@b begin;
+@b select * from jobs where id = 1 for update nowait;
+@b select id from jobs where state = 'ready' limit 1 for update skip locked;
+@b set lock_timeout = 100;
+@b update jobs set state = 'taken' where id = 1;
+@b update jobs set state = 'taken' where id = 2;
+@b commit;
+@a update jobs set state = 'taken' where id = 1;
+@a commit;
+@b select * from jobs;
+@a begin;
+@a update jobs set state = 'done' where id = 3;
+@b set lock_timeout = 0;
+@b begin;
+@b select * from jobs where id = 3 for update;
+@a commit;
+@b update jobs set state = 'archived' where id = 3;
+@b commit;
+@a select * from jobs;
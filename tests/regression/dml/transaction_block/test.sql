@@ -0,0 +1,20 @@
+create table acct (id int, owner varchar(20), balance int);
+begin;
+insert into acct values (1, 'Alice', 100);
+insert into acct values (2, 'Bob', 200);
+select * from acct;
+commit;
+begin;
+update acct set owner = 'Robert' where id = 2;
+delete from acct where id = 1;
+select * from acct;
+rollback;
+select * from acct;
+begin;
+insert into acct values (3, 'Carol', 300);
+select * from missing;
+select * from acct;
+commit;
+select * from acct;
+commit;
+shutdown;
@@ -0,0 +1,34 @@
+set transaction_isolation = 'repeatable read';
+create table acct (id int, owner varchar(20), balance int);
+insert into acct values (1, 'Alice', 100);
+insert into acct values (2, 'Bob', 200);
+insert into acct values (3, 'Carol', 300);
+update acct set owner = 'Alicia' where id = 1;
+update acct set owner = 'Ali' where id = 1;
+select * from acct;
+delete from acct where id = 2;
+delete from acct where id = 2;
+select * from acct where balance > 100;
+set transaction_isolation = 'read committed';
+update acct set owner = 'Caroline' where id = 3;
+select * from acct;
+create table wide (id int, a varchar(250), b varchar(250), c varchar(250), d varchar(250));
+insert into wide values (1, 'a', 'b', 'c', 'd');
+insert into wide values (2, 'a', 'b', 'c', 'd');
+update wide set a = 'v1' where id = 1;
+update wide set a = 'v2' where id = 1;
+update wide set a = 'v3' where id = 1;
+update wide set a = 'v4' where id = 1;
+update wide set a = 'v5' where id = 1;
+update wide set a = 'v6' where id = 1;
+update wide set a = 'v7' where id = 1;
+update wide set a = 'v8' where id = 1;
+update wide set a = 'v9' where id = 1;
+update wide set a = 'v10' where id = 1;
+update wide set a = 'v11' where id = 1;
+update wide set a = 'v12' where id = 1;
+select id, a from wide;
+delete from wide where id = 1;
+update wide set a = 'last' where id = 2;
+select id, a from wide;
+shutdown;
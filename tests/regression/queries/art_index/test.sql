@@ -0,0 +1,19 @@
+create table sessions (user_name varchar(20), started int, device varchar(10), duration int);
+insert into sessions values ('alice', 100, 'phone', 12);
+insert into sessions values ('alina', 150, 'laptop', 45);
+insert into sessions values ('alice', 200, 'laptop', 30);
+insert into sessions values ('bob', 120, 'tablet', 8);
+insert into sessions values ('alice', 300, 'phone', 22);
+insert into sessions values ('albert', 180, 'phone', 15);
+insert into sessions values ('bob', 250, 'laptop', 60);
+create index idx_user_started on sessions (user_name, started) include (device) using art;
+select user_name, started, device from sessions where user_name = 'alice' and started > 100;
+select started from sessions where user_name = 'alice' and started >= 200 and started < 300;
+select * from sessions where user_name = 'bob';
+select user_name, started from sessions where user_name >= 'alb' and user_name < 'alj';
+select duration from sessions where started = 180;
+delete from sessions where duration = 12;
+select started, device from sessions where user_name = 'alice';
+drop index idx_user_started;
+select user_name, started from sessions where user_name = 'alice';
+shutdown;
@@ -0,0 +1,18 @@
+create table events (tenant int, ts int, kind varchar(10), payload int);
+insert into events values (1, 100, 'login', 10);
+insert into events values (2, 150, 'login', 20);
+insert into events values (1, 200, 'click', 30);
+insert into events values (1, 300, 'logout', 40);
+insert into events values (2, 250, 'click', 50);
+insert into events values (3, 120, 'login', 60);
+insert into events values (1, 400, 'click', 70);
+create index idx_tenant_ts on events (tenant, ts) include (kind) using btree;
+select tenant, ts, kind from events where tenant = 1 and ts > 150;
+select ts from events where tenant = 1 and ts >= 200 and ts < 400;
+select * from events where tenant = 2;
+select tenant, ts from events where ts > 200;
+select * from events where tenant = 1 and kind = 'click';
+select payload from events where ts = 300;
+delete from events where payload = 30;
+select ts, kind from events where tenant = 1 and ts > 100;
+shutdown;
@@ -0,0 +1,17 @@
+create table orders (id int, customer varchar(20), amount int, status varchar(10));
+insert into orders values (1, 'Alice', 100, 'open');
+insert into orders values (2, 'Bob', 250, 'closed');
+insert into orders values (3, 'Carol', 300, 'open');
+insert into orders values (4, 'Dave', 450, 'open');
+insert into orders values (5, 'Eve', 500, 'closed');
+create index idx_amount on orders (amount) include (customer) using btree;
+select customer, amount from orders where amount >= 300;
+select amount from orders where customer = 'Bob';
+select * from orders where amount < 300;
+select id, status from orders where amount = 450;
+update orders set customer = 'Eva' where id = 5;
+delete from orders where id = 1;
+select customer, amount from orders where amount > 200;
+drop index idx_amount;
+select customer from orders where amount > 400;
+shutdown;
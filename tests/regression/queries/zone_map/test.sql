@@ -0,0 +1,71 @@
+create table readings (sensor int, ts int, note varchar(200));
+insert into readings values (1, 1, 'n1');
+insert into readings values (2, 2, 'n2');
+insert into readings values (0, 3, 'n3');
+insert into readings values (1, 4, 'n4');
+insert into readings values (2, 5, 'n5');
+insert into readings values (0, 6, 'n6');
+insert into readings values (1, 7, 'n7');
+insert into readings values (2, 8, 'n8');
+insert into readings values (0, 9, 'n9');
+insert into readings values (1, 10, 'n10');
+insert into readings values (2, 11, 'n11');
+insert into readings values (0, 12, 'n12');
+insert into readings values (1, 13, 'n13');
+insert into readings values (2, 14, 'n14');
+insert into readings values (0, 15, 'n15');
+insert into readings values (1, 16, 'n16');
+insert into readings values (2, 17, 'n17');
+insert into readings values (0, 18, 'n18');
+insert into readings values (1, 19, 'n19');
+insert into readings values (2, 20, 'n20');
+insert into readings values (0, 21, 'n21');
+insert into readings values (1, 22, 'n22');
+insert into readings values (2, 23, 'n23');
+insert into readings values (0, 24, 'n24');
+insert into readings values (1, 25, 'n25');
+insert into readings values (2, 26, 'n26');
+insert into readings values (0, 27, 'n27');
+insert into readings values (1, 28, 'n28');
+insert into readings values (2, 29, 'n29');
+insert into readings values (0, 30, 'n30');
+insert into readings values (1, 31, 'n31');
+insert into readings values (2, 32, 'n32');
+insert into readings values (0, 33, 'n33');
+insert into readings values (1, 34, 'n34');
+insert into readings values (2, 35, 'n35');
+insert into readings values (0, 36, 'n36');
+insert into readings values (1, 37, 'n37');
+insert into readings values (2, 38, 'n38');
+insert into readings values (0, 39, 'n39');
+insert into readings values (1, 40, 'n40');
+insert into readings values (2, 41, 'n41');
+insert into readings values (0, 42, 'n42');
+insert into readings values (1, 43, 'n43');
+insert into readings values (2, 44, 'n44');
+insert into readings values (0, 45, 'n45');
+insert into readings values (1, 46, 'n46');
+insert into readings values (2, 47, 'n47');
+insert into readings values (0, 48, 'n48');
+insert into readings values (1, 49, 'n49');
+insert into readings values (2, 50, 'n50');
+insert into readings values (0, 51, 'n51');
+insert into readings values (1, 52, 'n52');
+insert into readings values (2, 53, 'n53');
+insert into readings values (0, 54, 'n54');
+insert into readings values (1, 55, 'n55');
+insert into readings values (2, 56, 'n56');
+insert into readings values (0, 57, 'n57');
+insert into readings values (1, 58, 'n58');
+insert into readings values (2, 59, 'n59');
+insert into readings values (0, 60, 'n60');
+select ts from readings where ts >= 25 and ts <= 28;
+select sensor, ts from readings where ts > 58;
+select ts, note from readings where note = 'n42';
+select * from readings where ts < 0;
+select ts from readings where sensor = 2 and ts > 50;
+update readings set note = 'late' where ts = 5;
+select sensor, ts from readings where note = 'late';
+insert into readings values (1, 1000, 'tail');
+select * from readings where ts > 999;
+shutdown;
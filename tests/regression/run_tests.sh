@@ -15,6 +15,7 @@ MINIDB_SERVER="../../server/minidb_server"
 MINIDB_CLIENT="../../client/minidb_client"
 TEST_PORT=7000
 TIMEOUT=5
+SESSION_STEP=0.3    # Pause after each statement of a multi-session test
 
 # Colors for output
 GREEN='\033[0;32m'
@@ -50,6 +51,9 @@ cleanup_test() {
     
     # Clean up test data
     rm -f "$db_file" "$db_file-"* "$test_dir/minidb.wal"* "$output" "$output.normalized" "$test_dir/expected.out.normalized" "$test_dir/server.log" "$test_dir/test.dif"
+    rm -f "$test_dir"/session_*.fifo "$test_dir"/session_*.out
+    # The server writes its WAL into the working directory; start each test with a fresh log
+    rm -f minidb.wal*
     # Also clean up any old output.out files for backward compatibility
     rm -f "$test_dir/output.out" "$test_dir/output.out.normalized"
     return 0
@@ -80,6 +84,65 @@ cleanup_all_tests() {
     echo -e "${GREEN}All test files cleaned up${NC}"
 }
 
+# Function to run a multi-session test: each "@<session> <statement>" line
+# goes to that session's client, "@sleep <seconds>" pauses. Statements are
+# fed one at a time, SESSION_STEP apart, so a statement that blocks on a lock
+# holds up only its own session. The output is each session's transcript, in
+# order of first use.
+run_sessions() {
+    local test_sql=$1
+    local output=$2
+    local test_port=$3
+    local test_dir=$4
+    local -A session_fd=()
+    local sessions=()
+    local client_pids=()
+    local line name statement fd wait_step
+    
+    while IFS= read -r line || [ -n "$line" ]; do
+        [[ "$line" =~ ^@([A-Za-z0-9_]+)[[:space:]]+(.*)$ ]] || continue
+        name=${BASH_REMATCH[1]}
+        statement=${BASH_REMATCH[2]}
+        if [ "$name" = "sleep" ]; then
+            sleep "$statement"
+            continue
+        fi
+        
+        if [ -z "${session_fd[$name]}" ]; then
+            mkfifo "$test_dir/session_$name.fifo"
+            # The client must not inherit the other sessions' FIFOs, or they never see EOF
+            (
+                for fd in "${session_fd[@]}"; do eval "exec $fd>&-"; done
+                exec $MINIDB_CLIENT 127.0.0.1 $test_port < "$test_dir/session_$name.fifo" > "$test_dir/session_$name.out" 2>&1
+            ) &
+            client_pids+=($!)
+            exec {fd}>"$test_dir/session_$name.fifo"
+            session_fd[$name]=$fd
+            sessions+=("$name")
+            # Statements of a session still connecting would run late
+            for ((wait_step = 0; wait_step < TIMEOUT * 10; wait_step++)); do
+                grep -q "^Connected to MiniDB Server" "$test_dir/session_$name.out" 2>/dev/null && break
+                sleep 0.1
+            done
+        fi
+        echo "$statement" >&"${session_fd[$name]}"
+        sleep $SESSION_STEP
+    done < "$test_sql"
+    
+    sleep $SESSION_STEP
+    for name in "${sessions[@]}"; do
+        eval "exec ${session_fd[$name]}>&-"
+    done
+    wait "${client_pids[@]}" 2>/dev/null
+    
+    : > "$output"
+    for name in "${sessions[@]}"; do
+        echo "== session $name ==" >> "$output"
+        cat "$test_dir/session_$name.out" >> "$output"
+        rm -f "$test_dir/session_$name.fifo" "$test_dir/session_$name.out"
+    done
+}
+
 # Function to run a single test
 run_test() {
     local module=$1
@@ -112,7 +175,11 @@ run_test() {
     sleep 1
     
     # Run test
-    cat "$test_sql" | $MINIDB_CLIENT 127.0.0.1 $test_port > "$output" 2>&1
+    if grep -q '^@' "$test_sql"; then
+        run_sessions "$test_sql" "$output" $test_port "$test_dir"
+    else
+        cat "$test_sql" | $MINIDB_CLIENT 127.0.0.1 $test_port > "$output" 2>&1
+    fi
     
     # Shutdown server
     kill $SERVER_PID 2>/dev/null
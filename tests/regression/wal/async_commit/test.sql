@@ -0,0 +1,11 @@
+create table test (id int, name varchar(20), value int);
+set synchronous_commit = off;
+insert into test values (1, 'Alice', 100);
+insert into test values (2, 'Bob', 200);
+set local synchronous_commit = on;
+insert into test values (3, 'Charlie', 300);
+set synchronous_commit = maybe;
+set wal_writer_delay = 50;
+update test set name = 'Updated' where id = 2;
+select * from test;
+shutdown;
\ No newline at end of file